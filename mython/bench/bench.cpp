@@ -0,0 +1,156 @@
+#include "bench.h"
+
+#include "../lexer.h"
+#include "../parse.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+using namespace std;
+
+namespace bench {
+
+	namespace {
+		// Возвращает значение поля key из строки JSON-объекта, выведенной WriteJson
+		string_view FindField(string_view line, string_view key) {
+			const string pattern = "\""s + string(key) + "\":"s;
+			size_t pos = line.find(pattern);
+			if (pos == string_view::npos) {
+				throw invalid_argument("Field "s + string(key) + " not found in "s + string(line));
+			}
+			line.remove_prefix(pos + pattern.size());
+			if (!line.empty() && line.front() == '"') {
+				line.remove_prefix(1);
+				return line.substr(0, line.find('"'));
+			}
+			return line.substr(0, line.find_first_of(",}"sv));
+		}
+
+		double ToDouble(string_view value) {
+			return stod(string(value));
+		}
+
+		string FormatChange(double base, double current) {
+			if (base == 0) {
+				return current == 0 ? "0%"s : "new"s;
+			}
+			ostringstream out;
+			out << showpos << fixed << setprecision(1) << (current - base) / base * 100 << '%';
+			return out.str();
+		}
+	}  // namespace
+
+	uint64_t GetObjectsAllocated() {
+		uint64_t total = 0;
+		for (uint64_t count : runtime::Stats::Get().objects_allocated) {
+			total += count;
+		}
+		return total;
+	}
+
+	PreparedProgram::PreparedProgram(const string& source, bool expression) {
+		istringstream input(source);
+		parse::Lexer lexer(input);
+		program_ = ParseProgram(lexer);
+
+		vector<ast::Statement*> statements;
+		program_->ForEachChild([&statements](ast::Statement& statement) {
+			statements.push_back(&statement);
+			});
+		if (statements.empty()) {
+			throw invalid_argument("Nothing to measure in an empty program"s);
+		}
+		for (size_t i = 0; i + 1 < statements.size(); ++i) {
+			statements[i]->Execute(closure_, context_);
+		}
+
+		operation_ = statements.back();
+		if (expression) {
+			// Операндом присваивания "_ = выражение" является само выражение
+			operation_->ForEachChild([this](ast::Statement& value) {
+				operation_ = &value;
+				});
+		}
+	}
+
+	void WriteJson(ostream& out, vector<Result> results) {
+		sort(results.begin(), results.end(), [](const Result& lhs, const Result& rhs) {
+			return lhs.name < rhs.name;
+			});
+		out << "{\"benchmarks\":[\n"sv;
+		for (size_t i = 0; i < results.size(); ++i) {
+			const Result& result = results[i];
+			out << "{\"name\":"sv;
+			runtime::WriteJsonString(out, result.name);
+			out << fixed << setprecision(2)
+				<< ",\"ns_per_op\":"sv << result.ns_per_op
+				<< ",\"allocs_per_op\":"sv << result.allocs_per_op
+				<< ",\"objects_per_op\":"sv << result.objects_per_op
+				<< ",\"iterations\":"sv << result.iterations << '}'
+				<< (i + 1 < results.size() ? ",\n"sv : "\n"sv);
+		}
+		out << "]}\n"sv;
+	}
+
+	vector<Result> ReadJson(istream& input) {
+		vector<Result> results;
+		string line;
+		while (getline(input, line)) {
+			if (line.rfind("{\"name\":"sv, 0) != 0) {
+				continue;
+			}
+			Result result;
+			result.name = string(FindField(line, "name"sv));
+			result.ns_per_op = ToDouble(FindField(line, "ns_per_op"sv));
+			result.allocs_per_op = ToDouble(FindField(line, "allocs_per_op"sv));
+			result.objects_per_op = ToDouble(FindField(line, "objects_per_op"sv));
+			result.iterations = stoull(string(FindField(line, "iterations"sv)));
+			results.push_back(move(result));
+		}
+		return results;
+	}
+
+	vector<Result> ReadJsonFile(const string& path) {
+		ifstream input(path);
+		if (!input) {
+			throw runtime_error("Cannot open file "s + path);
+		}
+		return ReadJson(input);
+	}
+
+	void WriteComparison(ostream& out, const vector<Result>& base, const vector<Result>& current) {
+		map<string_view, const Result*> base_by_name;
+		for (const Result& result : base) {
+			base_by_name[result.name] = &result;
+		}
+
+		out << left << setw(32) << "benchmark"sv << right << setw(12) << "base ns"sv << setw(12) << "new ns"sv
+			<< setw(10) << "time"sv << setw(12) << "base alloc"sv << setw(12) << "new alloc"sv << '\n';
+		out << fixed << setprecision(2);
+		for (const Result& result : current) {
+			auto it = base_by_name.find(result.name);
+			if (it == base_by_name.end()) {
+				out << left << setw(32) << result.name << right << setw(12) << "-"sv << setw(12) << result.ns_per_op
+					<< setw(10) << "new"sv << setw(12) << "-"sv << setw(12) << result.allocs_per_op << '\n';
+				continue;
+			}
+			const Result& old = *it->second;
+			out << left << setw(32) << result.name << right << setw(12) << old.ns_per_op << setw(12) << result.ns_per_op
+				<< setw(10) << FormatChange(old.ns_per_op, result.ns_per_op)
+				<< setw(12) << old.allocs_per_op << setw(12) << result.allocs_per_op << '\n';
+			base_by_name.erase(it);
+		}
+		for (const auto& [name, old] : base_by_name) {
+			out << left << setw(32) << name << right << setw(12) << old->ns_per_op << setw(12) << "-"sv
+				<< setw(10) << "removed"sv << '\n';
+		}
+	}
+
+}  // namespace bench
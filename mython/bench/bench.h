@@ -0,0 +1,112 @@
+#pragma once
+
+#include "harness.h"
+
+#include "../runtime.h"
+#include "../statement.h"
+#include "../stats.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    // Результат замера одной операции
+    struct Result {
+        std::string name;
+        uint64_t iterations = 0;
+        double ns_per_op = 0;
+        // Выделения динамической памяти на одну операцию
+        double allocs_per_op = 0;
+        // Объекты Mython, созданные за одну операцию
+        double objects_per_op = 0;
+    };
+
+    struct MeasureOptions {
+        // Минимальная длительность одного замера
+        std::chrono::nanoseconds min_time = std::chrono::milliseconds{ 200 };
+        // Количество замеров, из которых выбирается самый быстрый
+        int repetitions = 3;
+    };
+
+    // Возвращает количество объектов Mython, созданных с последнего runtime::Stats::Reset
+    [[nodiscard]] uint64_t GetObjectsAllocated();
+
+    /*
+     * Замеряет операцию op: количество итераций удваивается, пока замер не продлится дольше
+     * options.min_time, после чего замер повторяется options.repetitions раз и выбирается самый быстрый.
+     * op - функциональный объект без параметров, его вызов встраивается в цикл замера.
+     */
+    template <typename Op>
+    Result Measure(std::string name, Op op, const MeasureOptions& options) {
+        using Clock = std::chrono::steady_clock;
+
+        uint64_t iterations = 1;
+        while (true) {
+            const auto start = Clock::now();
+            for (uint64_t i = 0; i < iterations; ++i) {
+                op();
+            }
+            if (Clock::now() - start >= options.min_time) {
+                break;
+            }
+            iterations *= 2;
+        }
+
+        Result result;
+        result.name = std::move(name);
+        result.iterations = iterations;
+        for (int repetition = 0; repetition < options.repetitions; ++repetition) {
+            const uint64_t allocs_before = GetHeapAllocationCount();
+            const uint64_t objects_before = GetObjectsAllocated();
+            const auto start = Clock::now();
+            for (uint64_t i = 0; i < iterations; ++i) {
+                op();
+            }
+            const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+            const double ns_per_op = elapsed.count() / static_cast<double>(iterations);
+            if (repetition == 0 || ns_per_op < result.ns_per_op) {
+                result.ns_per_op = ns_per_op;
+            }
+            result.allocs_per_op = static_cast<double>(GetHeapAllocationCount() - allocs_before) / static_cast<double>(iterations);
+            result.objects_per_op = static_cast<double>(GetObjectsAllocated() - objects_before) / static_cast<double>(iterations);
+        }
+        return result;
+    }
+
+    // Выводит результаты в JSON: по одному результату в строке, в порядке имён
+    void WriteJson(std::ostream& out, std::vector<Result> results);
+    // Читает результаты, выведенные WriteJson
+    [[nodiscard]] std::vector<Result> ReadJson(std::istream& input);
+    // Читает результаты из файла path
+    [[nodiscard]] std::vector<Result> ReadJsonFile(const std::string& path);
+
+    // Выводит таблицу изменения времени и выделений памяти между замерами base и current
+    void WriteComparison(std::ostream& out, const std::vector<Result>& base, const std::vector<Result>& current);
+
+    /*
+     * Программа, подготовленная к замеру её последней инструкции: все предыдущие инструкции
+     * исполняются при создании. Если expression истинно, последняя инструкция должна иметь вид
+     * "_ = выражение", и замеряется вычисление выражения без присваивания.
+     */
+    class PreparedProgram {
+    public:
+        PreparedProgram(const std::string& source, bool expression);
+
+        // Исполняет замеряемую инструкцию
+        void operator()() {
+            operation_->Execute(closure_, context_);
+        }
+
+    private:
+        std::unique_ptr<ast::Statement> program_;
+        runtime::Closure closure_;
+        NullContext context_;
+        ast::Statement* operation_ = nullptr;
+    };
+
+}  // namespace bench
@@ -0,0 +1,58 @@
+#include "harness.h"
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace {
+    uint64_t heap_allocations = 0;
+    size_t heap_bytes = 0;
+    size_t peak_heap_bytes = 0;
+}  // namespace
+
+// Замена глобальных операторов выделения памяти, считающая выделения и занятый объём.
+// Формы new[] и nothrow по умолчанию вызывают эти операторы
+void* operator new(size_t size) {
+    ++heap_allocations;
+    if (void* ptr = malloc(size == 0 ? 1 : size)) {
+        heap_bytes += malloc_usable_size(ptr);
+        peak_heap_bytes = max(peak_heap_bytes, heap_bytes);
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr) {
+        heap_bytes -= malloc_usable_size(ptr);
+        free(ptr);
+    }
+}
+
+void operator delete(void* ptr, size_t /*size*/) noexcept {
+    operator delete(ptr);
+}
+
+namespace bench {
+
+    uint64_t GetHeapAllocationCount() {
+        return heap_allocations;
+    }
+
+    size_t GetHeapBytes() {
+        return heap_bytes;
+    }
+
+    size_t GetPeakHeapBytes() {
+        return peak_heap_bytes;
+    }
+
+    void ResetPeakHeapBytes() {
+        peak_heap_bytes = heap_bytes;
+    }
+
+}  // namespace bench
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../runtime.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+
+// Общие средства бенчмарков и mython_perf_fuzz. harness.cpp заменяет глобальные операторы
+// выделения памяти, поэтому входит в сборку каждой из этих программ ровно один раз
+namespace bench {
+
+    // Возвращает количество выделений динамической памяти с начала работы программы
+    [[nodiscard]] uint64_t GetHeapAllocationCount();
+
+    // Возвращает текущий и пиковый объём динамической памяти, выделенной операторами new
+    [[nodiscard]] size_t GetHeapBytes();
+    [[nodiscard]] size_t GetPeakHeapBytes();
+    // Приравнивает пиковый объём памяти текущему
+    void ResetPeakHeapBytes();
+
+    // Контекст, отбрасывающий весь вывод программы
+    class NullContext : public runtime::Context {
+    public:
+        std::ostream& GetOutputStream() override {
+            return output_;
+        }
+
+    private:
+        class NullBuffer : public std::streambuf {
+        protected:
+            int_type overflow(int_type ch) override {
+                return traits_type::not_eof(ch);
+            }
+
+            std::streamsize xsputn(const char* /*s*/, std::streamsize count) override {
+                return count;
+            }
+        };
+
+        NullBuffer buffer_;
+        std::ostream output_{ &buffer_ };
+    };
+
+}  // namespace bench
@@ -0,0 +1,166 @@
+// Макробенчмарки: представительные программы на Mython из каталога bench/programs.
+// Каждая программа name.my исполняется несколько раз, её вывод сверяется с name.expected.txt,
+// а время лучшего запуска выводится в том же формате JSON, что и у микробенчмарков.
+//
+//   mython_macro [--dir=DIR] [--filter=SUBSTR] [--repetitions=N] [--out=FILE]
+//   mython_macro --compare BASE.json NEW.json
+//
+// Сборка: все файлы mython/*.cpp, кроме main.cpp, и файлы mython/bench/harness.cpp, bench.cpp, macro_bench.cpp
+
+#include "bench.h"
+
+#include "../lexer.h"
+#include "../parse.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string_view>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+    struct Options {
+        fs::path dir = "mython/bench/programs";
+        string filter;
+        int repetitions = 5;
+        string out_path;
+        // Файлы результатов для сравнения. Пустые строки - режим замера
+        string compare_base;
+        string compare_current;
+    };
+
+    string ReadFile(const fs::path& path) {
+        ifstream input(path, ios::binary);
+        if (!input) {
+            throw runtime_error("Cannot open file "s + path.string());
+        }
+        return { istreambuf_iterator<char>(input), istreambuf_iterator<char>() };
+    }
+
+    // Исполняет программу source и возвращает её вывод
+    string RunProgram(const string& source) {
+        istringstream input(source);
+        parse::Lexer lexer(input);
+        auto program = ParseProgram(lexer);
+
+        ostringstream output;
+        runtime::SimpleContext context{ output };
+        runtime::Closure closure;
+        program->Execute(closure, context);
+        return output.str();
+    }
+
+    // Исполняет программу repetitions раз, проверяя вывод, и возвращает время самого быстрого запуска
+    bench::Result MeasureProgram(const string& name, const string& source, const string& expected, int repetitions) {
+        bench::Result result;
+        result.name = name;
+        result.iterations = static_cast<uint64_t>(repetitions);
+        for (int repetition = 0; repetition < repetitions; ++repetition) {
+            const uint64_t allocs_before = bench::GetHeapAllocationCount();
+            const uint64_t objects_before = bench::GetObjectsAllocated();
+            const auto start = chrono::steady_clock::now();
+            const string output = RunProgram(source);
+            const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+
+            if (output != expected) {
+                throw runtime_error("Program "s + name + " printed unexpected output:\n"s + output);
+            }
+            if (repetition == 0 || elapsed.count() < result.ns_per_op) {
+                result.ns_per_op = elapsed.count();
+            }
+            result.allocs_per_op = static_cast<double>(bench::GetHeapAllocationCount() - allocs_before);
+            result.objects_per_op = static_cast<double>(bench::GetObjectsAllocated() - objects_before);
+        }
+        return result;
+    }
+
+    Options ParseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            string_view arg = argv[i];
+            auto value_of = [arg](string_view prefix) -> optional<string_view> {
+                if (arg.substr(0, prefix.size()) == prefix) {
+                    return arg.substr(prefix.size());
+                }
+                return nullopt;
+            };
+
+            if (auto value = value_of("--dir="sv)) {
+                options.dir = string(*value);
+            }
+            else if (auto value = value_of("--filter="sv)) {
+                options.filter = string(*value);
+            }
+            else if (auto value = value_of("--repetitions="sv)) {
+                options.repetitions = stoi(string(*value));
+            }
+            else if (auto value = value_of("--out="sv)) {
+                options.out_path = string(*value);
+            }
+            else if (arg == "--compare"sv && i + 2 < argc) {
+                options.compare_base = argv[++i];
+                options.compare_current = argv[++i];
+            }
+            else {
+                throw invalid_argument("Unknown option "s + string(arg));
+            }
+        }
+        return options;
+    }
+
+    vector<bench::Result> RunPrograms(const Options& options) {
+        vector<fs::path> programs;
+        for (const auto& entry : fs::directory_iterator(options.dir)) {
+            if (entry.path().extension() == ".my"
+                && entry.path().stem().string().find(options.filter) != string::npos) {
+                programs.push_back(entry.path());
+            }
+        }
+        sort(programs.begin(), programs.end());
+
+        vector<bench::Result> results;
+        for (const fs::path& path : programs) {
+            fs::path expected_path = path;
+            expected_path.replace_extension(".expected.txt");
+            const string name = path.stem().string();
+            results.push_back(MeasureProgram(name, ReadFile(path), ReadFile(expected_path), options.repetitions));
+            cerr << name << ": "sv << results.back().ns_per_op / 1e6 << " ms\n"sv;
+        }
+        return results;
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+        if (!options.compare_base.empty()) {
+            bench::WriteComparison(cout, bench::ReadJsonFile(options.compare_base),
+                bench::ReadJsonFile(options.compare_current));
+            return 0;
+        }
+
+        const vector<bench::Result> results = RunPrograms(options);
+        if (options.out_path.empty()) {
+            bench::WriteJson(cout, results);
+        }
+        else {
+            ofstream out(options.out_path);
+            if (!out) {
+                throw runtime_error("Cannot open file "s + options.out_path);
+            }
+            bench::WriteJson(out, results);
+        }
+    }
+    catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
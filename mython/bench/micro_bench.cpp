@@ -0,0 +1,213 @@
+// Микробенчмарки основных операций интерпретатора Mython.
+//
+//   mython_bench [--filter=SUBSTR] [--min-time-ms=N] [--repetitions=N] [--out=FILE]
+//   mython_bench --compare BASE.json NEW.json
+//
+// Сборка: все файлы mython/*.cpp, кроме main.cpp, и файлы mython/bench/harness.cpp, bench.cpp, micro_bench.cpp
+
+#include "bench.h"
+
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+    // Замеряемая операция code, исполняемая после программы setup.
+    // Для выражения (EXPRESSION) code вычисляется без присваивания
+    struct MicroBenchmark {
+        enum class Kind {
+            EXPRESSION,
+            STATEMENT
+        };
+
+        string name;
+        string setup;
+        string code;
+        Kind kind = Kind::EXPRESSION;
+    };
+
+    const string CLASSES = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def __str__():
+    return 'Point'
+
+  def __eq__(other):
+    return self.x == other.x
+
+  def __lt__(other):
+    return self.x < other.x
+
+  def __add__(other):
+    return self.x + other.x
+
+class Box:
+  def __init__(inner):
+    self.inner = inner
+
+class Calls:
+  def none():
+    x = 0
+
+  def one(a):
+    x = a
+
+  def three(a, b, c):
+    x = a
+
+  def value():
+    return 1
+
+p = Point(1, 2)
+q = Point(3, 4)
+box = Box(Box(p))
+calls = Calls()
+x = 57
+y = 13
+s = 'hello'
+t = 'world'
+b = True
+c = False
+n = None
+)"s;
+
+    vector<MicroBenchmark> MakeBenchmarks() {
+        using Kind = MicroBenchmark::Kind;
+        return {
+            { "literal/number"s, ""s, "57"s },
+            { "literal/string"s, ""s, "'hello'"s },
+            { "literal/bool"s, ""s, "True"s },
+            { "literal/none"s, ""s, "None"s },
+            { "variable/lookup"s, CLASSES, "x"s },
+            { "field/get"s, CLASSES, "p.x"s },
+            { "field/get_chain"s, CLASSES, "box.inner.inner.x"s },
+            { "field/set"s, CLASSES, "p.x = 5"s, Kind::STATEMENT },
+            { "field/set_chain"s, CLASSES, "box.inner.inner.x = 5"s, Kind::STATEMENT },
+            { "arith/add_number"s, CLASSES, "x + y"s },
+            { "arith/sub_number"s, CLASSES, "x - y"s },
+            { "arith/mult_number"s, CLASSES, "x * y"s },
+            { "arith/div_number"s, CLASSES, "x / y"s },
+            { "arith/expression"s, CLASSES, "(x + y) * (x - 1) / 2 - -y"s },
+            { "arith/add_string"s, CLASSES, "s + t"s },
+            { "arith/add_instance"s, CLASSES, "p + q"s },
+            { "compare/equal_number"s, CLASSES, "x == y"s },
+            { "compare/equal_string"s, CLASSES, "s == t"s },
+            { "compare/equal_bool"s, CLASSES, "b == c"s },
+            { "compare/equal_none"s, CLASSES, "n == None"s },
+            { "compare/equal_instance"s, CLASSES, "p == q"s },
+            { "compare/less_number"s, CLASSES, "x < y"s },
+            { "compare/less_string"s, CLASSES, "s < t"s },
+            { "compare/less_bool"s, CLASSES, "c < b"s },
+            { "compare/less_instance"s, CLASSES, "p < q"s },
+            { "is_true/number"s, CLASSES, "not x"s },
+            { "is_true/string"s, CLASSES, "not s"s },
+            { "is_true/bool"s, CLASSES, "not b"s },
+            { "call/args0"s, CLASSES, "calls.none()"s },
+            { "call/args1"s, CLASSES, "calls.one(x)"s },
+            { "call/args3"s, CLASSES, "calls.three(x, y, s)"s },
+            { "call/return"s, CLASSES, "calls.value()"s },
+            { "new_instance/init"s, CLASSES, "Point(x, y)"s },
+            { "print/number"s, CLASSES, "print x"s, Kind::STATEMENT },
+            { "print/three_args"s, CLASSES, "print x, s, b"s, Kind::STATEMENT },
+            { "print/instance"s, CLASSES, "print p"s, Kind::STATEMENT },
+            { "str/number"s, CLASSES, "str(x)"s },
+            { "str/instance"s, CLASSES, "str(p)"s },
+        };
+    }
+
+    struct Options {
+        string filter;
+        bench::MeasureOptions measure;
+        string out_path;
+        // Файлы результатов для сравнения. Пустые строки - режим замера
+        string compare_base;
+        string compare_current;
+    };
+
+    Options ParseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            string_view arg = argv[i];
+            auto value_of = [arg](string_view prefix) -> optional<string_view> {
+                if (arg.substr(0, prefix.size()) == prefix) {
+                    return arg.substr(prefix.size());
+                }
+                return nullopt;
+            };
+
+            if (auto value = value_of("--filter="sv)) {
+                options.filter = string(*value);
+            }
+            else if (auto value = value_of("--min-time-ms="sv)) {
+                options.measure.min_time = chrono::milliseconds{ stoi(string(*value)) };
+            }
+            else if (auto value = value_of("--repetitions="sv)) {
+                options.measure.repetitions = stoi(string(*value));
+            }
+            else if (auto value = value_of("--out="sv)) {
+                options.out_path = string(*value);
+            }
+            else if (arg == "--compare"sv && i + 2 < argc) {
+                options.compare_base = argv[++i];
+                options.compare_current = argv[++i];
+            }
+            else {
+                throw invalid_argument("Unknown option "s + string(arg));
+            }
+        }
+        return options;
+    }
+
+    vector<bench::Result> RunBenchmarks(const Options& options) {
+        vector<bench::Result> results;
+        for (const MicroBenchmark& benchmark : MakeBenchmarks()) {
+            if (benchmark.name.find(options.filter) == string::npos) {
+                continue;
+            }
+            const bool expression = benchmark.kind == MicroBenchmark::Kind::EXPRESSION;
+            bench::PreparedProgram prepared(
+                benchmark.setup + '\n' + (expression ? "_ = "s : ""s) + benchmark.code + '\n', expression);
+            results.push_back(bench::Measure(benchmark.name, [&prepared] {
+                prepared();
+                }, options.measure));
+            cerr << benchmark.name << ": "sv << results.back().ns_per_op << " ns/op\n"sv;
+        }
+        return results;
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+        if (!options.compare_base.empty()) {
+            bench::WriteComparison(cout, bench::ReadJsonFile(options.compare_base),
+                bench::ReadJsonFile(options.compare_current));
+            return 0;
+        }
+
+        const vector<bench::Result> results = RunBenchmarks(options);
+        if (options.out_path.empty()) {
+            bench::WriteJson(cout, results);
+        }
+        else {
+            ofstream out(options.out_path);
+            if (!out) {
+                throw runtime_error("Cannot open file "s + options.out_path);
+            }
+            bench::WriteJson(out, results);
+        }
+    }
+    catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,352 @@
+// Бенчмарки масштабирования интерпретатора Mython: каждая серия замеряет одну фазу или операцию
+// на растущих входных данных и оценивает показатель степени роста времени от размера входа.
+//
+//   mython_scaling [--filter=SUBSTR] [--max-size=BYTES] [--max-depth=N] [--json]
+//
+// Сборка: все файлы mython/*.cpp, кроме main.cpp, и файлы mython/bench/harness.cpp, bench.cpp, scaling_bench.cpp
+
+#include "bench.h"
+
+#include "../lexer.h"
+#include "../parse.h"
+
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+    using Clock = chrono::steady_clock;
+
+    // Показатель роста, превышающий ожидаемый больше чем на этот допуск, считается аномальным
+    constexpr double EXPONENT_TOLERANCE = 0.3;
+
+    // Замер серии при одном размере входа
+    struct Point {
+        uint64_t size = 0;
+        double seconds = 0;
+        // Объём обработанной работы в секунду в единицах серии
+        double rate = 0;
+        long peak_rss_kb = 0;
+    };
+
+    struct Sweep {
+        string name;
+        // Единица размера входа и единица скорости обработки
+        string size_unit;
+        string rate_unit;
+        // Ожидаемый показатель роста времени: 1 - линейный рост, 0 - время не зависит от размера
+        double expected_exponent = 1;
+        vector<uint64_t> sizes;
+        // Возвращает время обработки входа размера size и объём обработанной работы
+        function<pair<double, double>(uint64_t size)> run;
+    };
+
+    struct SweepResult {
+        const Sweep* sweep = nullptr;
+        vector<Point> points;
+        double exponent = 0;
+
+        [[nodiscard]] bool IsFlagged() const {
+            return exponent > sweep->expected_exponent + EXPONENT_TOLERANCE;
+        }
+    };
+
+    // Возвращает наклон прямой, приближающей зависимость log(seconds) от log(size) по методу
+    // наименьших квадратов. Используется старшая половина точек: на малых входах время
+    // определяется постоянными накладными расходами, а не асимптотикой
+    double FitExponent(const vector<Point>& points) {
+        const size_t first = points.size() >= 6 ? points.size() / 2 : 0;
+        double sum_x = 0;
+        double sum_y = 0;
+        double sum_xx = 0;
+        double sum_xy = 0;
+        size_t count = 0;
+        for (size_t i = first; i < points.size(); ++i) {
+            if (points[i].seconds <= 0) {
+                continue;
+            }
+            const double x = log(static_cast<double>(points[i].size));
+            const double y = log(points[i].seconds);
+            sum_x += x;
+            sum_y += y;
+            sum_xx += x * x;
+            sum_xy += x * y;
+            ++count;
+        }
+        const double denominator = static_cast<double>(count) * sum_xx - sum_x * sum_x;
+        if (count < 2 || denominator == 0) {
+            return 0;
+        }
+        return (static_cast<double>(count) * sum_xy - sum_x * sum_y) / denominator;
+    }
+
+    vector<uint64_t> GeometricSizes(uint64_t from, uint64_t to, uint64_t factor) {
+        vector<uint64_t> sizes;
+        for (uint64_t size = from; size <= to; size *= factor) {
+            sizes.push_back(size);
+        }
+        return sizes;
+    }
+
+    // Возвращает программу размером не меньше size байт из повторяющихся блоков
+    // с определениями классов, вызовами методов, условиями и выражениями
+    string GenerateProgram(uint64_t size) {
+        string program;
+        program.reserve(size + 256);
+        for (uint64_t block = 0; program.size() < size; ++block) {
+            const string id = to_string(block);
+            program += "class C"s + id + ":\n"s
+                "  def __init__(v):\n"s
+                "    self.v = v\n"s
+                "\n"s
+                "  def get(a, b):\n"s
+                "    if a < b and not a == 0:\n"s
+                "      return self.v + a * b - (a / b)\n"s
+                "    else:\n"s
+                "      return 'text' + str(b)\n"s
+                "\n"s
+                "o"s + id + " = C"s + id + '(' + id + ")\n"s
+                "print o"s + id + ".get("s + id + ", 2), 'done'\n"s;
+        }
+        return program;
+    }
+
+    // Возвращает время исполнения программы source и количество созданных объектов Mython
+    pair<double, double> TimeExecution(const string& source) {
+        istringstream input(source);
+        parse::Lexer lexer(input);
+        auto program = ParseProgram(lexer);
+
+        runtime::Closure closure;
+        bench::NullContext context;
+        const uint64_t objects_before = bench::GetObjectsAllocated();
+        const auto start = Clock::now();
+        program->Execute(closure, context);
+        const chrono::duration<double> elapsed = Clock::now() - start;
+        return { elapsed.count(), static_cast<double>(bench::GetObjectsAllocated() - objects_before) };
+    }
+
+    // Возвращает время одной операции программы source (см. bench::PreparedProgram)
+    pair<double, double> TimeOperation(const string& source, bool expression) {
+        bench::PreparedProgram prepared(source, expression);
+        bench::MeasureOptions options;
+        options.min_time = chrono::milliseconds{ 50 };
+        const bench::Result result = bench::Measure(""s, [&prepared] {
+            prepared();
+            }, options);
+        return { result.ns_per_op / 1e9, 1 };
+    }
+
+    struct Options {
+        string filter;
+        uint64_t max_size = uint64_t{ 16 } << 20;
+        uint64_t max_depth = 4096;
+        bool json = false;
+    };
+
+    vector<Sweep> MakeSweeps(const Options& options) {
+        vector<Sweep> sweeps;
+
+        sweeps.push_back({ "lex"s, "bytes"s, "MB/s"s, 1, GeometricSizes(1024, options.max_size, 4),
+            [](uint64_t size) -> pair<double, double> {
+                const string source = GenerateProgram(size);
+                istringstream input(source);
+                const auto start = Clock::now();
+                parse::Lexer lexer(input);
+                lexer.TokenizeAll();
+                const chrono::duration<double> elapsed = Clock::now() - start;
+                return { elapsed.count(), static_cast<double>(source.size()) / 1e6 };
+            } });
+
+        sweeps.push_back({ "parse"s, "bytes"s, "nodes/s"s, 1, GeometricSizes(1024, options.max_size, 4),
+            [](uint64_t size) -> pair<double, double> {
+                const string source = GenerateProgram(size);
+                istringstream input(source);
+                parse::Lexer lexer(input);
+                lexer.TokenizeAll();
+                const uint64_t nodes_before = runtime::Stats::Get().ast_nodes;
+                const auto start = Clock::now();
+                auto program = ParseProgram(lexer);
+                const chrono::duration<double> elapsed = Clock::now() - start;
+                return { elapsed.count(), static_cast<double>(runtime::Stats::Get().ast_nodes - nodes_before) };
+            } });
+
+        // Рекурсия до глубины depth: время растёт линейно с количеством вызовов
+        sweeps.push_back({ "execute/recursion_depth"s, "frames"s, "calls/s"s, 1, GeometricSizes(64, options.max_depth, 2),
+            [](uint64_t depth) {
+                const auto [seconds, objects] = TimeExecution(
+                    "class R:\n"
+                    "  def down(n):\n"
+                    "    if n > 0:\n"
+                    "      return self.down(n - 1)\n"
+                    "    return 0\n"
+                    "\n"
+                    "r = R()\n"
+                    "print r.down("s + to_string(depth) + ")\n"s);
+                return pair{ seconds, static_cast<double>(depth) };
+            } });
+
+        // Создание count экземпляров подряд идущими инструкциями
+        sweeps.push_back({ "execute/instances"s, "instances"s, "instances/s"s, 1, GeometricSizes(256, 262144, 4),
+            [](uint64_t count) {
+                string source = "class Point:\n  def __init__(x):\n    self.x = x\n\n"s;
+                for (uint64_t i = 0; i < count; ++i) {
+                    source += "p"s + to_string(i) + " = Point("s + to_string(i) + ")\n"s;
+                }
+                const auto [seconds, objects] = TimeExecution(source);
+                return pair{ seconds, static_cast<double>(count) };
+            } });
+
+        // Чтение одного поля у экземпляра с fields полями: время не должно зависеть от количества полей
+        sweeps.push_back({ "execute/fields_per_instance"s, "fields"s, "reads/s"s, 0, GeometricSizes(1, 4096, 4),
+            [](uint64_t fields) {
+                string source = "class Wide:\n  def __init__():\n"s;
+                for (uint64_t i = 0; i < fields; ++i) {
+                    source += "    self.f"s + to_string(i) + " = "s + to_string(i) + '\n';
+                }
+                source += "\nw = Wide()\n_ = w.f"s + to_string(fields - 1) + '\n';
+                return TimeOperation(source, true);
+            } });
+
+        // Вызов метода базового класса через depth уровней наследования
+        sweeps.push_back({ "execute/inheritance_depth"s, "levels"s, "calls/s"s, 0, GeometricSizes(1, 1024, 4),
+            [](uint64_t depth) {
+                string source = "class L0:\n  def base():\n    return 1\n\n"s;
+                for (uint64_t i = 1; i <= depth; ++i) {
+                    source += "class L"s + to_string(i) + "(L"s + to_string(i - 1) + "):\n  def m"s
+                        + to_string(i) + "():\n    return 0\n\n"s;
+                }
+                source += "o = L"s + to_string(depth) + "()\n_ = o.base()\n"s;
+                return TimeOperation(source, true);
+            } });
+
+        // Конкатенация строк длины length: время растёт линейно с длиной
+        sweeps.push_back({ "execute/string_length"s, "chars"s, "concatenations/s"s, 1, GeometricSizes(16, 1 << 20, 4),
+            [](uint64_t length) {
+                const string source = "s = '"s + string(length, 'x') + "'\n_ = s + s\n"s;
+                return TimeOperation(source, true);
+            } });
+
+        return sweeps;
+    }
+
+    SweepResult RunSweep(const Sweep& sweep) {
+        SweepResult result;
+        result.sweep = &sweep;
+        for (uint64_t size : sweep.sizes) {
+            const auto [seconds, work] = sweep.run(size);
+            Point point;
+            point.size = size;
+            point.seconds = seconds;
+            point.rate = seconds > 0 ? work / seconds : 0;
+            // Пиковый объём памяти процесса не убывает, но серии идут по возрастанию размера
+            point.peak_rss_kb = runtime::Stats::GetPeakRssKb();
+            result.points.push_back(point);
+            cerr << sweep.name << ' ' << size << ' ' << sweep.size_unit << ": "sv << seconds * 1e3 << " ms\n"sv;
+        }
+        result.exponent = FitExponent(result.points);
+        return result;
+    }
+
+    void WriteText(ostream& out, const SweepResult& result) {
+        const Sweep& sweep = *result.sweep;
+        out << sweep.name << " (growth exponent "sv << fixed << setprecision(2) << result.exponent
+            << ", expected "sv << sweep.expected_exponent << (result.IsFlagged() ? ") ABOVE EXPECTED\n"sv : ")\n"sv);
+        out << setw(14) << sweep.size_unit << setw(16) << "us"sv << setw(18) << sweep.rate_unit << setw(14) << "peak rss kb"sv << '\n';
+        for (const Point& point : result.points) {
+            out << setw(14) << point.size << setw(16) << setprecision(3) << point.seconds * 1e6
+                << setw(18) << setprecision(1) << point.rate << setw(14) << point.peak_rss_kb << '\n';
+        }
+        out << '\n';
+    }
+
+    void WriteJson(ostream& out, const vector<SweepResult>& results) {
+        out << "{\"sweeps\":[\n"sv;
+        for (size_t i = 0; i < results.size(); ++i) {
+            const SweepResult& result = results[i];
+            out << "{\"name\":"sv;
+            runtime::WriteJsonString(out, result.sweep->name);
+            out << ",\"exponent\":"sv << result.exponent << ",\"expected_exponent\":"sv << result.sweep->expected_exponent
+                << ",\"flagged\":"sv << (result.IsFlagged() ? "true"sv : "false"sv) << ",\"points\":["sv;
+            for (size_t j = 0; j < result.points.size(); ++j) {
+                const Point& point = result.points[j];
+                out << (j == 0 ? "" : ",") << "{\"size\":"sv << point.size << ",\"seconds\":"sv << point.seconds
+                    << ",\"rate\":"sv << point.rate << ",\"peak_rss_kb\":"sv << point.peak_rss_kb << '}';
+            }
+            out << "]}"sv << (i + 1 < results.size() ? ",\n"sv : "\n"sv);
+        }
+        out << "]}\n"sv;
+    }
+
+    Options ParseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            string_view arg = argv[i];
+            auto value_of = [arg](string_view prefix) -> optional<string_view> {
+                if (arg.substr(0, prefix.size()) == prefix) {
+                    return arg.substr(prefix.size());
+                }
+                return nullopt;
+            };
+
+            if (auto value = value_of("--filter="sv)) {
+                options.filter = string(*value);
+            }
+            else if (auto value = value_of("--max-size="sv)) {
+                options.max_size = stoull(string(*value));
+            }
+            else if (auto value = value_of("--max-depth="sv)) {
+                options.max_depth = stoull(string(*value));
+            }
+            else if (arg == "--json"sv) {
+                options.json = true;
+            }
+            else {
+                throw invalid_argument("Unknown option "s + string(arg));
+            }
+        }
+        return options;
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+        const vector<Sweep> sweeps = MakeSweeps(options);
+
+        vector<SweepResult> results;
+        for (const Sweep& sweep : sweeps) {
+            if (sweep.name.find(options.filter) != string::npos) {
+                results.push_back(RunSweep(sweep));
+            }
+        }
+
+        if (options.json) {
+            WriteJson(cout, results);
+        }
+        else {
+            for (const SweepResult& result : results) {
+                WriteText(cout, result);
+            }
+        }
+        for (const SweepResult& result : results) {
+            if (result.IsFlagged()) {
+                cerr << "warning: "sv << result.sweep->name << " grows with exponent "sv << result.exponent
+                    << ", expected "sv << result.sweep->expected_exponent << '\n';
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "call_stack.h"
+
+#include "runtime.h"
+
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace runtime {
+
+	namespace {
+		constexpr size_t DEFAULT_STACK_SIZE = size_t{ 8 } << 20;
+		// Запас стека, который остаётся для разрушения объектов, обработки исключения
+		// и вызовов встроенных функций на самой большой глубине рекурсии
+		constexpr size_t MIN_STACK_RESERVE = size_t{ 1 } << 20;
+
+		// Возвращает размер машинного стека текущего потока. RLIMIT_STACK ограничивает только стек
+		// основного потока, поэтому размер берётся из атрибутов потока, а RLIMIT_STACK - если их нет
+		size_t GetStackSize() {
+#if defined(__GLIBC__)
+			pthread_attr_t attributes;
+			if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+				size_t size = 0;
+				const bool known = pthread_attr_getstacksize(&attributes, &size) == 0;
+				pthread_attr_destroy(&attributes);
+				if (known && size > 0) {
+					return size;
+				}
+			}
+#endif
+			rlimit limit{};
+			if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+				return static_cast<size_t>(limit.rlim_cur);
+			}
+			return DEFAULT_STACK_SIZE;
+		}
+
+		// Возвращает объём машинного стека, который могут занять вызовы методов Mython
+		size_t GetStackBudget() {
+			const size_t size = GetStackSize();
+			const size_t reserve = std::max(size / 4, MIN_STACK_RESERVE);
+			return size > reserve ? size - reserve : size / 2;
+		}
+
+		uintptr_t GetStackPosition() {
+			volatile char marker = 0;
+			return reinterpret_cast<uintptr_t>(&marker);
+		}
+	}  // namespace
+
+	void CallStack::Push(const Class& cls, const Method& method, const vector<ObjectHolder>& args) {
+		// Интерпретатор может исполняться не в основном потоке, стек которого меньше
+		thread_local const size_t stack_budget = GetStackBudget();
+
+		size_t depth = depth_.load(std::memory_order_relaxed) + 1;
+		const uintptr_t position = GetStackPosition();
+		if (depth == 1) {
+			stack_base_ = position;
+		}
+		else if ((stack_base_ > position ? stack_base_ - position : position - stack_base_) > stack_budget) {
+			throw std::runtime_error("Maximum recursion depth exceeded in "s + cls.GetName() + '.' + method.name
+				+ " at depth "s + to_string(depth));
+		}
+		if (depth < MAX_DEPTH) {
+			frames_[depth].cls = &cls;
+			frames_[depth].method = &method;
+			frames_[depth].args = &args;
+			frames_[depth].line = 0;
+		}
+		// Кадр должен быть заполнен раньше, чем его увидит обработчик сигнала
+		std::atomic_signal_fence(std::memory_order_release);
+		depth_.store(depth, std::memory_order_relaxed);
+	}
+
+	void CallStack::Pop() {
+		size_t depth = depth_.load(std::memory_order_relaxed);
+		if (depth > 0) {
+			depth_.store(depth - 1, std::memory_order_relaxed);
+		}
+	}
+
+	size_t CallStack::GetDepth() {
+		return depth_.load(std::memory_order_relaxed);
+	}
+
+	size_t CallStack::Snapshot(Frame* out, size_t max_frames) {
+		size_t count = std::min({ depth_.load(std::memory_order_relaxed) + 1, MAX_DEPTH, max_frames });
+		std::atomic_signal_fence(std::memory_order_acquire);
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = frames_[i];
+		}
+		return count;
+	}
+
+	string CallStack::FrameName(const Frame& frame) {
+		if (frame.cls == nullptr || frame.method == nullptr) {
+			return "<module>"s;
+		}
+		return frame.cls->GetName() + '.' + frame.method->name;
+	}
+
+	string CallStack::DescribeCall(const Frame& frame) {
+		string result = FrameName(frame);
+		if (frame.method != nullptr && frame.args != nullptr) {
+			result += '(';
+			const auto& params = frame.method->formal_params;
+			for (size_t i = 0; i < frame.args->size(); ++i) {
+				if (i > 0) {
+					result += ", "s;
+				}
+				if (i < params.size()) {
+					result += params[i] + '=';
+				}
+				result += DescribeValue((*frame.args)[i]);
+			}
+			result += ')';
+		}
+		return result;
+	}
+
+	string CallStack::DescribeFrame(const Frame& frame) {
+		return DescribeCall(frame) + " line "s + to_string(frame.line);
+	}
+
+	string CallStack::DescribeValue(const ObjectHolder& value) {
+		// Длинные строки обрезаются, чтобы описание кадра оставалось однострочным
+		constexpr size_t MAX_STRING_LENGTH = 32;
+
+		if (!value) {
+			return "None"s;
+		}
+		if (const auto* number = value.TryAs<Number>()) {
+			return to_string(number->GetValue());
+		}
+		if (const auto* str = value.TryAs<String>()) {
+			const string& text = str->GetValue();
+			if (text.size() > MAX_STRING_LENGTH) {
+				return '\'' + text.substr(0, MAX_STRING_LENGTH) + "...'"s;
+			}
+			return '\'' + text + '\'';
+		}
+		if (const auto* boolean = value.TryAs<Bool>()) {
+			return boolean->GetValue() ? "True"s : "False"s;
+		}
+		if (const auto* instance = value.TryAs<ClassInstance>()) {
+			return '<' + instance->GetClass().GetName() + " instance>"s;
+		}
+		if (const auto* cls = value.TryAs<Class>()) {
+			return "<class "s + cls->GetName() + '>';
+		}
+		return "<object>"s;
+	}
+
+}  // namespace runtime
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace runtime {
+
+    class Class;
+    class ObjectHolder;
+    struct Method;
+
+    // Кадр теневого стека вызовов Mython
+    struct Frame {
+        // Класс объекта, у которого вызван метод. Для кадра верхнего уровня программы nullptr
+        const Class* cls = nullptr;
+        // Вызванный метод. Для кадра верхнего уровня программы nullptr
+        const Method* method = nullptr;
+        // Фактические параметры вызова. Для кадра верхнего уровня программы nullptr
+        const std::vector<ObjectHolder>* args = nullptr;
+        // Номер строки исходного текста, которая исполняется в этом кадре
+        size_t line = 0;
+    };
+
+    /*
+     * Теневой стек вызовов методов Mython, который поддерживает интерпретатор.
+     * Самый нижний кадр соответствует коду верхнего уровня программы и присутствует всегда.
+     * Стек хранится в массиве фиксированного размера, поэтому его можно читать из обработчика
+     * сигнала: кадры глубже MAX_DEPTH учитываются в глубине, но не сохраняются.
+     */
+    class CallStack {
+    public:
+        static constexpr size_t MAX_DEPTH = 1024;
+
+        // Добавляет кадр вызова метода method у объекта класса cls с параметрами args.
+        // Параметры должны существовать, пока кадр находится в стеке.
+        // Выбрасывает runtime_error, если машинный стек потока почти исчерпан рекурсией
+        static void Push(const Class& cls, const Method& method, const std::vector<ObjectHolder>& args);
+        // Удаляет верхний кадр
+        static void Pop();
+
+        // Запоминает номер исполняемой строки в верхнем кадре
+        static void SetLine(size_t line) {
+            size_t depth = depth_.load(std::memory_order_relaxed);
+            if (depth < MAX_DEPTH) {
+                frames_[depth].line = line;
+            }
+        }
+
+        // Возвращает количество кадров вызовов методов (без кадра верхнего уровня)
+        static size_t GetDepth();
+
+        // Копирует в out не более max_frames сохранённых кадров, начиная с кадра верхнего уровня.
+        // Возвращает количество скопированных кадров. Безопасна для вызова из обработчика сигнала
+        static size_t Snapshot(Frame* out, size_t max_frames);
+
+        // Возвращает имя кадра в виде "Class.method" либо "<module>" для кадра верхнего уровня
+        static std::string FrameName(const Frame& frame);
+        // Возвращает описание вызова в виде "Class.method(a=1, b='text')"
+        static std::string DescribeCall(const Frame& frame);
+        // Возвращает описание кадра в виде "Class.method(a=1, b='text') line 5"
+        static std::string DescribeFrame(const Frame& frame);
+        // Возвращает краткое описание значения, не вызывая методов Mython
+        static std::string DescribeValue(const ObjectHolder& value);
+
+        // Удаляет добавленный кадр при выходе из области видимости, в том числе по исключению
+        class Guard {
+        public:
+            Guard(const Class& cls, const Method& method, const std::vector<ObjectHolder>& args) {
+                Push(cls, method, args);
+            }
+
+            Guard(const Guard&) = delete;
+            Guard& operator=(const Guard&) = delete;
+
+            ~Guard() {
+                Pop();
+            }
+        };
+
+    private:
+        // Кадр с индексом 0 - кадр верхнего уровня, индекс верхнего кадра равен depth_
+        inline static Frame frames_[MAX_DEPTH];
+        inline static std::atomic<size_t> depth_{ 0 };
+        // Адрес машинного стека при вызове самого внешнего метода
+        inline static std::uintptr_t stack_base_ = 0;
+    };
+
+}  // namespace runtime
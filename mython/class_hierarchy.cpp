@@ -0,0 +1,180 @@
+#include "class_hierarchy.h"
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace ast {
+
+    namespace {
+        const string SELF = "self"s;
+
+        // Вызывает visit для узлов области видимости: тела методов вложенных классов - другие области
+        void ForEachScopeNode(Statement& node, const function<void(Statement&)>& visit) {
+            visit(node);
+            if (dynamic_cast<ClassDefinition*>(&node) == nullptr) {
+                node.ForEachChild([&visit](Statement& child) {
+                    ForEachScopeNode(child, visit);
+                });
+            }
+        }
+
+        // Возвращает имя переменной node или пустую строку, если node - не переменная без полей
+        string GetVariableName(Statement& node) {
+            const auto* variable = dynamic_cast<const VariableValue*>(&node);
+            if (variable == nullptr) {
+                return {};
+            }
+            vector<string> ids = variable->GetIds();
+            return ids.size() == 1 ? move(ids.front()) : string{};
+        }
+
+        bool IsDerived(const runtime::Class& cls, const runtime::Class& base) {
+            for (const runtime::Class* current = &cls; current != nullptr; current = current->GetParent()) {
+                if (current == &base) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        class StaticBinder {
+        public:
+            explicit StaticBinder(const runtime::Closure& classes) {
+                for (const auto& [name, holder] : classes) {
+                    if (const auto* cls = holder.TryAs<runtime::Class>()) {
+                        classes_.push_back(cls);
+                        class_names_.insert(name);
+                    }
+                }
+            }
+
+            void Run(Statement& program) {
+                BindScope(program, {}, nullptr);
+                ForEachNode(program, [this](Statement& node) {
+                    auto* definition = dynamic_cast<ClassDefinition*>(&node);
+                    if (definition == nullptr) {
+                        return;
+                    }
+                    const runtime::Class& cls = definition->GetClass();
+                    for (const runtime::Method& method : cls.GetMethods()) {
+                        if (auto* body = dynamic_cast<Statement*>(method.body.get())) {
+                            BindScope(*body, method.formal_params, &cls);
+                        }
+                    }
+                });
+                for (const auto& [call, binding] : bindings_) {
+                    if (binding.method != nullptr) {
+                        call->BindMethod(*binding.cls, *binding.method, binding.with_subclasses);
+                    }
+                }
+            }
+
+        private:
+            // Класс значения переменной, известный при разборе
+            struct StaticClass {
+                const runtime::Class* cls = nullptr;
+                // Значением может быть экземпляр наследника cls (self)
+                bool with_subclasses = false;
+            };
+
+            // Связывает вызовы области scope: тела метода класса self_class или программы (self_class == nullptr)
+            void BindScope(Statement& scope, const vector<string>& formal_params, const runtime::Class* self_class) {
+                unordered_map<string, StaticClass> variables;
+                ForEachScopeNode(scope, [&variables](Statement& node) {
+                    auto* assignment = dynamic_cast<Assignment*>(&node);
+                    if (assignment == nullptr) {
+                        return;
+                    }
+                    const auto* instance = dynamic_cast<const NewInstance*>(&assignment->GetValue());
+                    const runtime::Class* cls = instance != nullptr ? &instance->GetClass() : nullptr;
+                    auto [it, inserted] = variables.emplace(assignment->GetName(), StaticClass{ cls, false });
+                    if (!inserted && it->second.cls != cls) {
+                        it->second.cls = nullptr;
+                    }
+                });
+                // Значения параметров и имён классов создаются вне области
+                for (const string& param : formal_params) {
+                    variables[param] = {};
+                }
+                for (const string& name : class_names_) {
+                    if (auto it = variables.find(name); it != variables.end()) {
+                        it->second = {};
+                    }
+                }
+                if (self_class != nullptr) {
+                    // Присваивание self или параметр self заменяют объект, у которого вызван метод
+                    auto [it, inserted] = variables.emplace(SELF, StaticClass{ self_class, true });
+                    if (!inserted) {
+                        it->second = {};
+                    }
+                }
+
+                ForEachScopeNode(scope, [this, &variables](Statement& node) {
+                    auto* call = dynamic_cast<MethodCall*>(&node);
+                    if (call == nullptr) {
+                        return;
+                    }
+                    Binding binding;
+                    if (auto it = variables.find(GetVariableName(call->GetObject()));
+                        it != variables.end() && it->second.cls != nullptr) {
+                        binding = { it->second.cls, Resolve(it->second, call->GetMethodName()), it->second.with_subclasses };
+                    }
+                    if (binding.method != nullptr && binding.method->formal_params.size() != call->GetArgs().size()) {
+                        binding.method = nullptr;
+                    }
+                    Record(*call, binding);
+                });
+            }
+
+            // Возвращает метод, который вызывается у любого значения с классом static_class,
+            // или nullptr, если наследники класса вызывают разные методы
+            const runtime::Method* Resolve(const StaticClass& static_class, const string& name) const {
+                const runtime::Method* method = static_class.cls->GetMethod(name);
+                if (!static_class.with_subclasses) {
+                    return method;
+                }
+                for (const runtime::Class* cls : classes_) {
+                    if (cls != static_class.cls && IsDerived(*cls, *static_class.cls) && cls->GetMethod(name) != method) {
+                        return nullptr;
+                    }
+                }
+                return method;
+            }
+
+            // Метод, с которым связывается вызов, и класс объекта, для которого связывание доказано
+            struct Binding {
+                const runtime::Class* cls = nullptr;
+                const runtime::Method* method = nullptr;
+                bool with_subclasses = false;
+
+                bool operator==(const Binding& other) const {
+                    return cls == other.cls && method == other.method && with_subclasses == other.with_subclasses;
+                }
+            };
+
+            // Тело метода, общее для нескольких классов (ast::SharedNode), анализируется для каждого из них.
+            // Вызов связывается, только если во всех случаях найден один и тот же метод для того же класса
+            void Record(MethodCall& call, const Binding& binding) {
+                auto [it, inserted] = bindings_.emplace(&call, binding);
+                if (!inserted && !(it->second == binding)) {
+                    it->second.method = nullptr;
+                }
+            }
+
+            vector<const runtime::Class*> classes_;
+            unordered_set<string> class_names_;
+            unordered_map<MethodCall*, Binding> bindings_;
+        };
+    }  // namespace
+
+    void BindStaticMethodCalls(Statement& program, const runtime::Closure& classes) {
+        StaticBinder(classes).Run(program);
+    }
+
+}  // namespace ast
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "runtime.h"
+#include "statement.h"
+
+namespace ast {
+
+    /*
+     * Анализ иерархии классов всей программы. Связывает вызовы методов, класс объекта которых
+     * известен при разборе, с вызываемым методом (MethodCall::BindMethod):
+     *  - self.method(...) в методе класса C, если ни один наследник C не переопределяет method;
+     *  - x.method(...), если переменной x в той же области присваиваются только новые экземпляры
+     *    одного класса (x = Point(1, 2)), а x не является параметром метода или именем класса.
+     * Вызов связывается, только если метод найден и принимает столько же параметров, сколько передано.
+     *
+     * classes - все классы программы, включая импортированные. Тела методов импортированных модулей
+     * не анализируются: их классы может унаследовать любая импортирующая программа
+     */
+    void BindStaticMethodCalls(Statement& program, const runtime::Closure& classes);
+
+}  // namespace ast
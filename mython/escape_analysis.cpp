@@ -0,0 +1,129 @@
+#include "escape_analysis.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_set>
+
+using namespace std;
+
+namespace ast {
+
+    namespace {
+        const string SELF = "self"s;
+        const string INIT_METHOD = "__init__"s;
+
+        class EscapeAnalysis {
+        public:
+            // Возвращает true, если значение переменной name в теле body не покидает вызов метода.
+            // Переменной могут присваиваться только новые экземпляры класса cls
+            bool IsConfined(Statement& body, const string& name, const runtime::Class& cls) {
+                // Узлы, читающие переменную name как объект вызова метода или присваивания полю
+                unordered_set<const Statement*> object_uses;
+                bool confined = true;
+                ForEachNode(body, [&](Statement& node) {
+                    if (!confined) {
+                        return;
+                    }
+                    if (auto* call = dynamic_cast<MethodCall*>(&node)) {
+                        if (IsVariable(call->GetObject(), name)) {
+                            const runtime::Method* method = cls.GetMethod(call->GetMethodName());
+                            confined = method != nullptr && method->formal_params.size() == call->GetArgs().size()
+                                && IsMethodConfined(cls, *method);
+                            object_uses.insert(&call->GetObject());
+                        }
+                    }
+                    else if (auto* field_assignment = dynamic_cast<FieldAssignment*>(&node)) {
+                        object_uses.insert(&field_assignment->GetObject());
+                    }
+                    else if (auto* assignment = dynamic_cast<Assignment*>(&node); assignment && assignment->GetName() == name) {
+                        auto* instance = dynamic_cast<NewInstance*>(&assignment->GetValue());
+                        confined = instance != nullptr && &instance->GetClass() == &cls && IsInitConfined(*instance);
+                    }
+                });
+                if (!confined) {
+                    return false;
+                }
+                // Остальные чтения самой переменной (а не её полей) выпускают экземпляр
+                ForEachNode(body, [&](Statement& node) {
+                    confined = confined && (!IsVariable(node, name) || object_uses.count(&node) > 0);
+                });
+                return confined;
+            }
+
+        private:
+            static bool IsVariable(const Statement& node, const string& name) {
+                const auto* variable = dynamic_cast<const VariableValue*>(&node);
+                return variable != nullptr && variable->GetIds() == vector{ name };
+            }
+
+            bool IsInitConfined(const NewInstance& instance) {
+                const runtime::Method* init = instance.GetClass().GetMethod(INIT_METHOD);
+                return init == nullptr || init->formal_params.size() != instance.GetArgCount()
+                    || IsMethodConfined(instance.GetClass(), *init);
+            }
+
+            // Метод method, вызванный у экземпляра класса cls, не выпускает self
+            bool IsMethodConfined(const runtime::Class& cls, const runtime::Method& method) {
+                const auto key = pair{ &cls, &method };
+                if (auto it = methods_.find(key); it != methods_.end()) {
+                    return it->second;
+                }
+                // Рекурсивный вызов проверяемого метода не выпускает self, если этого не делает
+                // остальная часть тела
+                if (!in_progress_.insert(key).second) {
+                    return true;
+                }
+                auto* body = dynamic_cast<Statement*>(method.body.get());
+                const bool confined = body != nullptr
+                    && find(method.formal_params.begin(), method.formal_params.end(), SELF) == method.formal_params.end()
+                    && !AssignsVariable(*body, SELF) && IsConfined(*body, SELF, cls);
+                in_progress_.erase(key);
+                // Результат, полученный в предположении о методах, проверка которых не завершена,
+                // запоминается только вместе с результатом проверки самих этих методов
+                if (in_progress_.empty() || !confined) {
+                    methods_[key] = confined;
+                }
+                return confined;
+            }
+
+            static bool AssignsVariable(Statement& body, const string& name) {
+                bool assigns = false;
+                ForEachNode(body, [&assigns, &name](Statement& node) {
+                    auto* assignment = dynamic_cast<Assignment*>(&node);
+                    assigns = assigns || (assignment && assignment->GetName() == name);
+                });
+                return assigns;
+            }
+
+            map<pair<const runtime::Class*, const runtime::Method*>, bool> methods_;
+            set<pair<const runtime::Class*, const runtime::Method*>> in_progress_;
+        };
+    }  // namespace
+
+    void MarkNonEscapingInstances(MethodBody& body, const vector<string>& formal_params) {
+        // Переменные метода, которым присваиваются новые экземпляры, и узлы, создающие эти экземпляры
+        map<string, vector<NewInstance*>> candidates;
+        ForEachNode(body, [&candidates](Statement& node) {
+            if (auto* assignment = dynamic_cast<Assignment*>(&node)) {
+                if (auto* instance = dynamic_cast<NewInstance*>(&assignment->GetValue())) {
+                    candidates[assignment->GetName()].push_back(instance);
+                }
+            }
+        });
+
+        EscapeAnalysis analysis;
+        for (const auto& [name, instances] : candidates) {
+            if (name == SELF || find(formal_params.begin(), formal_params.end(), name) != formal_params.end()) {
+                continue;
+            }
+            if (analysis.IsConfined(body, name, instances.front()->GetClass())) {
+                for (NewInstance* instance : instances) {
+                    instance->EnableFrameSlots();
+                    body.AddFrameSlots(*instance);
+                }
+            }
+        }
+    }
+
+}  // namespace ast
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "statement.h"
+
+#include <string>
+#include <vector>
+
+namespace ast {
+
+    /*
+     * Анализ убегания экземпляров в теле метода. Находит переменные метода, которым присваиваются
+     * только новые экземпляры одного класса (p = Point(x, y)) и которые используются только для
+     * чтения и присваивания полей (p.x, p.x = ...) и вызова методов (p.length()). Экземпляр такой
+     * переменной не покидает вызов метода: он не сохраняется в полях и переменных, не возвращается,
+     * не передаётся в другие методы и не выводится. Методы, вызываемые у экземпляра, включая __init__,
+     * проверяются так же: self в них используется только для обращения к полям и вызова таких же методов.
+     *
+     * Для узлов NewInstance, создающих такие экземпляры, включаются слоты кадров (NewInstance::EnableFrameSlots),
+     * а тело метода запоминает эти узлы, чтобы освобождать слоты при выходе из метода.
+     * formal_params - параметры метода: их значения создаёт вызывающий код, поэтому они не анализируются
+     */
+    void MarkNonEscapingInstances(MethodBody& body, const std::vector<std::string>& formal_params);
+
+}  // namespace ast
@@ -0,0 +1,20 @@
+#include "perf_target.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+// Точка входа libFuzzer. Нарушение границ сложности считается ошибкой: libFuzzer сохраняет
+// вход, на котором вызван abort, и может минимизировать его параметром -minimize_crash=1
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static const fuzz::Limits limits;
+
+    const std::string_view input(reinterpret_cast<const char*>(data), size);
+    const fuzz::Cost cost = fuzz::MeasureConfirmed(input, limits);
+    if (fuzz::IsViolation(cost, limits)) {
+        std::cerr << "complexity bound violated: " << fuzz::Describe(cost, limits) << std::endl;
+        std::abort();
+    }
+    return 0;
+}
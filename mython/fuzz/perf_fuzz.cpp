@@ -0,0 +1,516 @@
+// Поиск входов, которые интерпретатор обрабатывает сверхлинейно по времени или памяти.
+// Целевая функция - не падение, а стоимость лексического и синтаксического анализа и исполнения
+// в пересчёте на байт входа, лексему и единицу работы (fuzz::Score). Каждый вход обрабатывается
+// в дочернем процессе, поэтому переполнение стека и зависание тоже обнаруживаются.
+//
+//   mython_perf_fuzz search [--corpus=DIR] [--seeds=DIR] [--runs=N] [--max-len=N] [--seed=N]
+//   mython_perf_fuzz minimize FILE [--out=FILE]
+//   mython_perf_fuzz check [DIR]
+//
+// search изменяет входы из корпуса и --seeds, оставляя самые дорогие, а найденные нарушения
+// минимизирует и сохраняет в корпус. check проверяет, что ни один вход корпуса не нарушает границ:
+// это регрессионная проверка сложности.
+//
+// Сборка: все файлы mython/*.cpp, кроме main.cpp, и файлы mython/bench/harness.cpp, mython/fuzz/perf_target.cpp, perf_fuzz.cpp, с -DMYTHON_HOOKS.
+// По умолчанию корпус - каталог corpus рядом с этим файлом, независимо от текущего каталога.
+// Сборка может задать его явно: -DMYTHON_FUZZ_CORPUS_DIR="\"/path/to/corpus\""
+
+#include "perf_target.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+    fs::path DefaultCorpus() {
+#ifdef MYTHON_FUZZ_CORPUS_DIR
+        return MYTHON_FUZZ_CORPUS_DIR;
+#else
+        // Путь к этому файлу в том виде, в каком его получил компилятор. Сборки обычно передают
+        // абсолютные пути; относительный путь отсчитывается от текущего каталога
+        return fs::path(__FILE__).parent_path() / "corpus"s;
+#endif
+    }
+
+    struct Options {
+        string command;
+        // Файл для minimize
+        string input_path;
+        fs::path corpus = DefaultCorpus();
+        vector<fs::path> seeds;
+        string out_path;
+        uint64_t runs = 10000;
+        size_t max_len = 4096;
+        uint64_t seed = random_device{}();
+        // Наибольшее количество запусков при минимизации одного входа
+        int max_minimize_runs = 2000;
+        // Время, через которое дочерний процесс считается зависшим
+        unsigned timeout_s = 10;
+    };
+
+    // Результат обработки входа в дочернем процессе
+    struct Outcome {
+        enum class Kind {
+            OK,
+            VIOLATION,
+            CRASH,
+            TIMEOUT
+        };
+
+        Kind kind = Kind::OK;
+        double score = 0;
+        string description;
+
+        [[nodiscard]] bool IsFailure() const {
+            return kind != Kind::OK;
+        }
+    };
+
+    const char* KindName(Outcome::Kind kind) {
+        switch (kind) {
+        case Outcome::Kind::OK:
+            return "ok";
+        case Outcome::Kind::VIOLATION:
+            return "slow";
+        case Outcome::Kind::CRASH:
+            return "crash";
+        case Outcome::Kind::TIMEOUT:
+            return "timeout";
+        }
+        return "unknown";
+    }
+
+    // Обрабатывает вход в дочернем процессе и возвращает результат
+    Outcome RunIsolated(const string& input, const fuzz::Limits& limits, unsigned timeout_s) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            throw runtime_error("Cannot create pipe"s);
+        }
+        cout.flush();
+        const pid_t pid = fork();
+        if (pid < 0) {
+            throw runtime_error("Cannot fork"s);
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            alarm(timeout_s);
+            const fuzz::Cost cost = fuzz::MeasureConfirmed(input, limits);
+            ostringstream report;
+            report << setprecision(17) << fuzz::Evaluate(cost, limits).Max() << ' '
+                << fuzz::IsViolation(cost, limits) << ' ' << fuzz::Describe(cost, limits);
+            const string text = report.str();
+            for (size_t written = 0; written < text.size();) {
+                const ssize_t count = write(fds[1], text.data() + written, text.size() - written);
+                if (count <= 0) {
+                    break;
+                }
+                written += static_cast<size_t>(count);
+            }
+            _exit(0);
+        }
+
+        close(fds[1]);
+        string text;
+        char buffer[4096];
+        for (ssize_t count; (count = read(fds[0], buffer, sizeof(buffer))) > 0;) {
+            text.append(buffer, static_cast<size_t>(count));
+        }
+        close(fds[0]);
+        int status = 0;
+        waitpid(pid, &status, 0);
+
+        Outcome outcome;
+        if (WIFSIGNALED(status)) {
+            const int signal = WTERMSIG(status);
+            outcome.kind = signal == SIGALRM ? Outcome::Kind::TIMEOUT : Outcome::Kind::CRASH;
+            outcome.score = numeric_limits<double>::infinity();
+            outcome.description = "killed by signal "s + to_string(signal);
+            return outcome;
+        }
+        istringstream report(text);
+        bool violation = false;
+        report >> outcome.score >> violation;
+        report.ignore(1);
+        getline(report, outcome.description);
+        outcome.kind = violation ? Outcome::Kind::VIOLATION : Outcome::Kind::OK;
+        return outcome;
+    }
+
+    string ReadFile(const fs::path& path) {
+        ifstream input(path, ios::binary);
+        if (!input) {
+            throw runtime_error("Cannot open file "s + path.string());
+        }
+        return { istreambuf_iterator<char>(input), istreambuf_iterator<char>() };
+    }
+
+    void WriteFile(const fs::path& path, const string& content) {
+        ofstream out(path, ios::binary);
+        if (!out) {
+            throw runtime_error("Cannot open file "s + path.string());
+        }
+        out << content;
+    }
+
+    // Возвращает входы *.my из каталога dir в порядке имён
+    vector<pair<fs::path, string>> ReadInputs(const fs::path& dir) {
+        vector<pair<fs::path, string>> inputs;
+        if (!fs::is_directory(dir)) {
+            return inputs;
+        }
+        for (const auto& entry : fs::directory_iterator(dir)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".my"sv) {
+                inputs.emplace_back(entry.path(), ReadFile(entry.path()));
+            }
+        }
+        sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    /*
+     * Минимизирует вход, сохраняя вид нарушения: сначала удаляет группы строк, затем группы символов,
+     * уменьшая размер группы вдвое, пока удаление ещё что-то даёт (упрощённый delta debugging)
+     */
+    string Minimize(string input, Outcome::Kind kind, const fuzz::Limits& limits, const Options& options) {
+        int runs = 0;
+        auto still_fails = [&](const string& candidate) {
+            ++runs;
+            const Outcome outcome = RunIsolated(candidate, limits, options.timeout_s);
+            return outcome.kind == kind;
+        };
+
+        for (const bool by_lines : { true, false }) {
+            auto split = [by_lines](const string& text) {
+                vector<string> parts;
+                if (!by_lines) {
+                    for (char c : text) {
+                        parts.emplace_back(1, c);
+                    }
+                    return parts;
+                }
+                size_t start = 0;
+                while (start < text.size()) {
+                    const size_t end = min(text.find('\n', start), text.size() - 1);
+                    parts.push_back(text.substr(start, end - start + 1));
+                    start = end + 1;
+                }
+                return parts;
+            };
+
+            vector<string> parts = split(input);
+            for (size_t chunk = max<size_t>(parts.size() / 2, 1); runs < options.max_minimize_runs;) {
+                bool removed = false;
+                for (size_t start = 0; start < parts.size() && runs < options.max_minimize_runs;) {
+                    string candidate;
+                    for (size_t i = 0; i < parts.size(); ++i) {
+                        if (i < start || i >= start + chunk) {
+                            candidate += parts[i];
+                        }
+                    }
+                    if (!candidate.empty() && still_fails(candidate)) {
+                        parts.erase(parts.begin() + static_cast<ptrdiff_t>(start),
+                            parts.begin() + static_cast<ptrdiff_t>(min(start + chunk, parts.size())));
+                        input = move(candidate);
+                        removed = true;
+                    }
+                    else {
+                        start += chunk;
+                    }
+                }
+                if (chunk == 1 && !removed) {
+                    break;
+                }
+                chunk = max<size_t>(chunk / 2, 1);
+            }
+        }
+        return input;
+    }
+
+    // Изменяет входы случайным образом. Изменения нацелены на то, что делает обработку дорогой:
+    // повторение участков входа, вложенность скобок и унарных операций, длинные цепочки операций
+    class Mutator {
+    public:
+        explicit Mutator(uint64_t seed)
+            : random_(seed) {
+        }
+
+        string Mutate(string input, const vector<string>& pool, size_t max_len) {
+            const size_t count = Uniform(1, 4);
+            for (size_t i = 0; i < count; ++i) {
+                MutateOnce(input, pool);
+            }
+            if (input.size() > max_len) {
+                input.resize(max_len);
+            }
+            return input;
+        }
+
+        size_t Uniform(size_t min, size_t max) {
+            return uniform_int_distribution<size_t>(min, max)(random_);
+        }
+
+    private:
+        inline static const vector<string_view> DICTIONARY = {
+            "("sv, ")"sv, "\n"sv, "#"sv, " "sv, "  "sv, "+"sv, "-"sv, "*"sv, "/"sv, "1"sv, "x"sv, "'s'"sv,
+            ":"sv, ","sv, "."sv, "=="sv, "<"sv, "="sv, "print "sv, "class "sv, "def "sv, "return "sv, "if "sv,
+            "else:"sv, "self."sv, "not "sv, " and "sv, " or "sv, "None"sv, "True"sv, "str("sv, "x = "sv,
+        };
+
+        void MutateOnce(string& input, const vector<string>& pool) {
+            const size_t pos = Uniform(0, input.size());
+            switch (Uniform(0, 6)) {
+            case 0:
+                if (!input.empty()) {
+                    input[min(pos, input.size() - 1)] = DICTIONARY[Uniform(0, DICTIONARY.size() - 1)][0];
+                }
+                break;
+            case 1:
+                input.insert(pos, DICTIONARY[Uniform(0, DICTIONARY.size() - 1)]);
+                break;
+            case 2:
+                input.erase(pos, Uniform(1, 16));
+                break;
+            case 3: {
+                // Удваивает участок: повторение растит вход без изменения его структуры
+                const size_t length = Uniform(1, max<size_t>(input.size() - pos, 1));
+                input.insert(pos, input.substr(pos, length));
+                break;
+            }
+            case 4: {
+                const size_t line_start = input.rfind('\n', pos == 0 ? 0 : pos - 1);
+                const size_t begin = line_start == string::npos ? 0 : line_start + 1;
+                const size_t end = input.find('\n', begin);
+                const string line = input.substr(begin, end == string::npos ? string::npos : end - begin + 1);
+                string repeated;
+                for (size_t i = Uniform(2, 64); i > 0; --i) {
+                    repeated += line;
+                }
+                input.insert(begin, repeated);
+                break;
+            }
+            case 5: {
+                const size_t depth = Uniform(1, 64);
+                const size_t length = Uniform(0, min<size_t>(input.size() - pos, 16));
+                const bool parens = Uniform(0, 1) == 0;
+                input.insert(pos + length, parens ? string(depth, ')') : ""s);
+                string prefix;
+                for (size_t i = 0; i < depth; ++i) {
+                    prefix += parens ? "("sv : "not "sv;
+                }
+                input.insert(pos, prefix);
+                break;
+            }
+            default:
+                if (!pool.empty()) {
+                    const string& other = pool[Uniform(0, pool.size() - 1)];
+                    const size_t start = Uniform(0, other.size());
+                    input.insert(pos, other.substr(start, Uniform(0, other.size() - start)));
+                }
+                break;
+            }
+        }
+
+        mt19937_64 random_;
+    };
+
+    // Возвращает имя файла корпуса для входа: вид нарушения и хеш FNV-1a содержимого
+    string CorpusName(Outcome::Kind kind, const string& input) {
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : input) {
+            hash = (hash ^ c) * 1099511628211ull;
+        }
+        ostringstream name;
+        name << KindName(kind) << '-' << hex << setw(16) << setfill('0') << hash << ".my";
+        return name.str();
+    }
+
+    int Search(const Options& options, const fuzz::Limits& limits) {
+        // Самые дорогие из найденных входов, из которых получаются новые
+        constexpr size_t MAX_POOL_SIZE = 256;
+
+        vector<string> pool;
+        for (const fs::path& dir : options.seeds) {
+            for (auto& [path, input] : ReadInputs(dir)) {
+                pool.push_back(move(input));
+            }
+        }
+        for (auto& [path, input] : ReadInputs(options.corpus)) {
+            pool.push_back(move(input));
+        }
+        if (pool.empty()) {
+            pool = {
+                "x = 1\nprint x + 2\n"s,
+                "class A:\n  def f(n):\n    if n > 0:\n      return self.f(n - 1)\n    return 0\na = A()\nprint a.f(10)\n"s,
+                "# comment\n\nprint (1 + 2) * -3, not True or False\n"s,
+            };
+        }
+        vector<double> scores;
+        for (const string& input : pool) {
+            scores.push_back(RunIsolated(input, limits, options.timeout_s).score);
+        }
+
+        Mutator mutator(options.seed);
+        size_t failures = 0;
+        for (uint64_t run = 1; run <= options.runs; ++run) {
+            const string input = mutator.Mutate(pool[mutator.Uniform(0, pool.size() - 1)], pool, options.max_len);
+            const Outcome outcome = RunIsolated(input, limits, options.timeout_s);
+            if (outcome.IsFailure()) {
+                ++failures;
+                const string minimized = Minimize(input, outcome.kind, limits, options);
+                fs::create_directories(options.corpus);
+                const fs::path path = options.corpus / CorpusName(outcome.kind, minimized);
+                WriteFile(path, minimized);
+                cout << "run "sv << run << ": "sv << KindName(outcome.kind) << ", "sv << input.size() << " -> "sv
+                    << minimized.size() << " bytes, saved to "sv << path.string() << "\n  "sv << outcome.description
+                    << endl;
+                continue;
+            }
+
+            const auto cheapest = min_element(scores.begin(), scores.end());
+            if (pool.size() < MAX_POOL_SIZE) {
+                pool.push_back(input);
+                scores.push_back(outcome.score);
+            }
+            else if (outcome.score > *cheapest) {
+                const size_t index = static_cast<size_t>(cheapest - scores.begin());
+                pool[index] = input;
+                scores[index] = outcome.score;
+            }
+            if (run % 1000 == 0) {
+                cout << "run "sv << run << ": max score "sv << *max_element(scores.begin(), scores.end())
+                    << ", failures "sv << failures << endl;
+            }
+        }
+        cout << "done: "sv << options.runs << " runs, "sv << failures << " failures"sv << endl;
+        return failures == 0 ? 0 : 1;
+    }
+
+    int MinimizeFile(const Options& options, const fuzz::Limits& limits) {
+        const string input = ReadFile(options.input_path);
+        const Outcome outcome = RunIsolated(input, limits, options.timeout_s);
+        if (!outcome.IsFailure()) {
+            cerr << "Input does not violate complexity bounds: "sv << outcome.description << endl;
+            return 1;
+        }
+        const string minimized = Minimize(input, outcome.kind, limits, options);
+        const string out_path = options.out_path.empty() ? options.input_path + ".min"s : options.out_path;
+        WriteFile(out_path, minimized);
+        cout << KindName(outcome.kind) << ": "sv << input.size() << " -> "sv << minimized.size() << " bytes, saved to "sv
+            << out_path << endl;
+        return 0;
+    }
+
+    int Check(const Options& options, const fuzz::Limits& limits) {
+        const auto inputs = ReadInputs(options.corpus);
+        if (inputs.empty()) {
+            throw runtime_error("No inputs in "s + options.corpus.string() + "; pass the corpus directory to check"s);
+        }
+        size_t failures = 0;
+        for (const auto& [path, input] : inputs) {
+            const Outcome outcome = RunIsolated(input, limits, options.timeout_s);
+            failures += outcome.IsFailure();
+            cout << (outcome.IsFailure() ? "FAIL "sv : "ok   "sv) << path.filename().string() << ": "sv
+                << KindName(outcome.kind) << "; "sv << outcome.description << '\n';
+        }
+        cout << inputs.size() - failures << " of "sv << inputs.size() << " inputs within bounds"sv << endl;
+        return failures == 0 ? 0 : 1;
+    }
+
+    Options ParseOptions(int argc, char* argv[]) {
+        Options options;
+        vector<string_view> positional;
+        for (int i = 1; i < argc; ++i) {
+            string_view arg = argv[i];
+            auto value_of = [arg](string_view prefix) -> optional<string_view> {
+                if (arg.substr(0, prefix.size()) == prefix) {
+                    return arg.substr(prefix.size());
+                }
+                return nullopt;
+            };
+
+            if (auto value = value_of("--corpus="sv)) {
+                options.corpus = string(*value);
+            }
+            else if (auto value = value_of("--seeds="sv)) {
+                options.seeds.emplace_back(string(*value));
+            }
+            else if (auto value = value_of("--out="sv)) {
+                options.out_path = string(*value);
+            }
+            else if (auto value = value_of("--runs="sv)) {
+                options.runs = stoull(string(*value));
+            }
+            else if (auto value = value_of("--max-len="sv)) {
+                options.max_len = stoul(string(*value));
+            }
+            else if (auto value = value_of("--seed="sv)) {
+                options.seed = stoull(string(*value));
+            }
+            else if (auto value = value_of("--max-minimize-runs="sv)) {
+                options.max_minimize_runs = stoi(string(*value));
+            }
+            else if (auto value = value_of("--timeout="sv)) {
+                options.timeout_s = static_cast<unsigned>(stoul(string(*value)));
+            }
+            else if (arg.substr(0, 2) == "--"sv) {
+                throw invalid_argument("Unknown option "s + string(arg));
+            }
+            else {
+                positional.push_back(arg);
+            }
+        }
+
+        if (positional.empty()) {
+            throw invalid_argument("Usage: mython_perf_fuzz search|minimize FILE|check [DIR] [options]"s);
+        }
+        options.command = string(positional[0]);
+        if (options.command == "minimize"sv) {
+            if (positional.size() != 2) {
+                throw invalid_argument("minimize requires a file"s);
+            }
+            options.input_path = string(positional[1]);
+        }
+        else if (options.command == "check"sv && positional.size() == 2) {
+            options.corpus = string(positional[1]);
+        }
+        else if ((options.command != "search"sv && options.command != "check"sv) || positional.size() != 1) {
+            throw invalid_argument("Unknown command "s + string(positional[0]));
+        }
+        return options;
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+        const fuzz::Limits limits;
+        if (options.command == "search"sv) {
+            return Search(options, limits);
+        }
+        if (options.command == "minimize"sv) {
+            return MinimizeFile(options, limits);
+        }
+        return Check(options, limits);
+    }
+    catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,193 @@
+#include "perf_target.h"
+
+#include "../bench/harness.h"
+#include "../hooks.h"
+#include "../lexer.h"
+#include "../parse.h"
+#include "../runtime.h"
+#include "../statement.h"
+#include "../stats.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+// BudgetListener ограничивает исполнение, получая события исполнения
+static_assert(runtime::ExecutionHooks::ENABLED, "mython_perf_fuzz must be built with -DMYTHON_HOOKS");
+
+namespace fuzz {
+
+	namespace {
+		using Clock = chrono::steady_clock;
+
+		// Исполнение прервано из-за превышения Limits
+		class BudgetExceeded : public runtime_error {
+		public:
+			using runtime_error::runtime_error;
+		};
+
+		// Считает единицы работы и прерывает исполнение, превысившее время или память
+		class BudgetListener : public runtime::ExecutionListener {
+		public:
+			explicit BudgetListener(const Limits& limits)
+				: limits_(limits), deadline_(Clock::now() + limits.max_exec_time) {
+				runtime::ExecutionHooks::AddListener(*this);
+			}
+
+			BudgetListener(const BudgetListener&) = delete;
+			BudgetListener& operator=(const BudgetListener&) = delete;
+
+			~BudgetListener() override {
+				runtime::ExecutionHooks::RemoveListener(*this);
+			}
+
+			void OnCall(const runtime::ClassInstance& /*self*/, const runtime::Method& /*method*/,
+				const vector<runtime::ObjectHolder>& /*args*/) override {
+				Count();
+			}
+
+			void OnStatement(const runtime::Executable& /*statement*/, size_t /*line*/) override {
+				Count();
+			}
+
+			[[nodiscard]] uint64_t GetWork() const {
+				return work_;
+			}
+
+		private:
+			// Часы опрашиваются не на каждом событии: это заметно замедлило бы исполнение
+			static constexpr uint64_t CHECK_PERIOD = 256;
+
+			void Count() {
+				++work_;
+				if (bench::GetHeapBytes() > limits_.max_heap_bytes) {
+					throw BudgetExceeded("Heap limit exceeded"s);
+				}
+				if (work_ % CHECK_PERIOD == 0 && Clock::now() > deadline_) {
+					throw BudgetExceeded("Time limit exceeded"s);
+				}
+			}
+
+			const Limits& limits_;
+			Clock::time_point deadline_;
+			uint64_t work_ = 0;
+		};
+
+		double Ratio(double value, size_t units, const Limits& limits, double limit) {
+			return value / static_cast<double>(units + limits.unit_offset) / limit;
+		}
+	}  // namespace
+
+	double Score::Max() const {
+		return max({ lex, parse, exec, heap });
+	}
+
+	const char* Score::Worst() const {
+		const double worst = Max();
+		if (worst == lex) {
+			return "lex";
+		}
+		if (worst == parse) {
+			return "parse";
+		}
+		return worst == exec ? "exec" : "heap";
+	}
+
+	Cost Measure(string_view input, const Limits& limits) {
+		Cost cost;
+		cost.input_bytes = input.size();
+		runtime::Stats::Reset();
+		bench::ResetPeakHeapBytes();
+		const size_t heap_before = bench::GetHeapBytes();
+
+		bench::NullContext context;
+		runtime::Closure closure;
+		unique_ptr<ast::Statement> program;
+		// Время каждой фазы прибавляется к *phase при переходе к следующей фазе
+		chrono::nanoseconds* phase = &cost.lex_time;
+		auto phase_start = Clock::now();
+		auto next_phase = [&phase, &phase_start](chrono::nanoseconds* next) {
+			const auto now = Clock::now();
+			*phase += now - phase_start;
+			phase_start = now;
+			phase = next;
+		};
+		try {
+			istringstream stream{ string(input) };
+			parse::Lexer lexer(stream);
+			lexer.TokenizeAll();
+			cost.tokens = runtime::Stats::Get().tokens_lexed;
+			next_phase(&cost.parse_time);
+
+			program = ParseProgram(lexer);
+			cost.ast_nodes = runtime::Stats::Get().ast_nodes;
+			next_phase(&cost.exec_time);
+
+			BudgetListener budget(limits);
+			try {
+				program->Execute(closure, context);
+			}
+			catch (...) {
+				cost.work = budget.GetWork();
+				throw;
+			}
+			cost.work = budget.GetWork();
+		}
+		catch (const BudgetExceeded& e) {
+			cost.budget_exceeded = true;
+			cost.error = e.what();
+		}
+		catch (const exception& e) {
+			cost.error = e.what();
+		}
+		// Разрушение дерева и объектов программы входит в стоимость фазы, на которой завершилась обработка
+		program.reset();
+		closure.clear();
+		next_phase(phase);
+		cost.peak_heap_bytes = bench::GetPeakHeapBytes() - heap_before;
+		return cost;
+	}
+
+	Cost MeasureConfirmed(string_view input, const Limits& limits, int attempts) {
+		Cost best = Measure(input, limits);
+		// Превышение Limits::max_exec_time не перепроверяется: такой замер и так длился дольше всех
+		for (int attempt = 1; attempt < attempts && !best.budget_exceeded && IsViolation(best, limits); ++attempt) {
+			Cost cost = Measure(input, limits);
+			if (Evaluate(cost, limits).Max() < Evaluate(best, limits).Max()) {
+				best = move(cost);
+			}
+		}
+		return best;
+	}
+
+	Score Evaluate(const Cost& cost, const Limits& limits) {
+		Score score;
+		score.lex = Ratio(static_cast<double>(cost.lex_time.count()), cost.input_bytes, limits, limits.lex_ns_per_byte);
+		score.parse = Ratio(static_cast<double>(cost.parse_time.count()), cost.tokens, limits, limits.parse_ns_per_token);
+		score.exec = Ratio(static_cast<double>(cost.exec_time.count()), cost.work, limits, limits.exec_ns_per_work);
+		score.heap = Ratio(static_cast<double>(cost.peak_heap_bytes), cost.input_bytes + cost.work, limits,
+			limits.heap_bytes_per_unit);
+		return score;
+	}
+
+	bool IsViolation(const Cost& cost, const Limits& limits) {
+		return cost.budget_exceeded || Evaluate(cost, limits).Max() > 1;
+	}
+
+	string Describe(const Cost& cost, const Limits& limits) {
+		const Score score = Evaluate(cost, limits);
+		ostringstream out;
+		out << cost.input_bytes << " bytes, "sv << cost.tokens << " tokens, "sv << cost.ast_nodes << " nodes, "sv
+			<< cost.work << " work; lex "sv << cost.lex_time.count() << " ns, parse "sv << cost.parse_time.count()
+			<< " ns, exec "sv << cost.exec_time.count() << " ns, peak heap "sv << cost.peak_heap_bytes
+			<< " bytes; score "sv << score.Max() << " ("sv << score.Worst() << ')';
+		if (!cost.error.empty()) {
+			out << "; error: "sv << cost.error;
+		}
+		return out.str();
+	}
+
+}  // namespace fuzz
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace fuzz {
+
+    // Стоимость обработки одного входа интерпретатором
+    struct Cost {
+        size_t input_bytes = 0;
+        size_t tokens = 0;
+        size_t ast_nodes = 0;
+        // Единицы работы при исполнении: исполненные инструкции блоков и вызовы методов
+        uint64_t work = 0;
+
+        std::chrono::nanoseconds lex_time{ 0 };
+        std::chrono::nanoseconds parse_time{ 0 };
+        std::chrono::nanoseconds exec_time{ 0 };
+        // Наибольший объём динамической памяти, занятой во время обработки входа
+        size_t peak_heap_bytes = 0;
+
+        // Текст исключения, которым завершилась обработка. Пустая строка - обработка завершилась успешно
+        std::string error;
+        // Обработка прервана из-за превышения Limits
+        bool budget_exceeded = false;
+    };
+
+    /*
+     * Границы сложности обработки входа. Стоимость каждой фазы делится на размер того, что она
+     * обрабатывает, с поправкой на постоянные расходы коротких входов. Вход, у которого хотя бы одно
+     * отношение превышает границу, обрабатывается интерпретатором сверхлинейно или слишком дорого.
+     */
+    struct Limits {
+        double lex_ns_per_byte = 2000;
+        double parse_ns_per_token = 10000;
+        double exec_ns_per_work = 50000;
+        double heap_bytes_per_unit = 8192;
+        // Постоянная добавка к размеру входа, количеству лексем и единиц работы
+        size_t unit_offset = 64;
+
+        // Исполнение прерывается, если длится дольше или занимает больше памяти
+        std::chrono::nanoseconds max_exec_time = std::chrono::seconds{ 2 };
+        size_t max_heap_bytes = size_t{ 256 } << 20;
+    };
+
+    // Отношения стоимости к границам Limits. Значение больше 1 означает нарушение границы
+    struct Score {
+        double lex = 0;
+        double parse = 0;
+        double exec = 0;
+        double heap = 0;
+
+        [[nodiscard]] double Max() const;
+        // Возвращает название худшего отношения: "lex", "parse", "exec" или "heap"
+        [[nodiscard]] const char* Worst() const;
+    };
+
+    // Лексический и синтаксический анализ и исполнение входа input с отбрасыванием вывода.
+    // Ошибки программы не считаются нарушениями и сохраняются в Cost::error
+    [[nodiscard]] Cost Measure(std::string_view input, const Limits& limits);
+
+    // Повторяет замер не более attempts раз, пока вход нарушает границы, и возвращает самый дешёвый.
+    // Так случайная задержка одного замера не принимается за сверхлинейную сложность
+    [[nodiscard]] Cost MeasureConfirmed(std::string_view input, const Limits& limits, int attempts = 3);
+
+    [[nodiscard]] Score Evaluate(const Cost& cost, const Limits& limits);
+
+    // Вход нарушает границы сложности
+    [[nodiscard]] bool IsViolation(const Cost& cost, const Limits& limits);
+
+    // Возвращает однострочное описание стоимости
+    [[nodiscard]] std::string Describe(const Cost& cost, const Limits& limits);
+
+}  // namespace fuzz
@@ -0,0 +1,229 @@
+#include "heap_census.h"
+
+#include "runtime.h"
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+namespace runtime {
+
+	namespace {
+		// Накладные расходы make_shared на блок управления
+		constexpr size_t CONTROL_BLOCK_SIZE = 16;
+
+		size_t StringHeapSize(const string& str) {
+			// Короткие строки хранятся внутри объекта string
+			return str.capacity() > string().capacity() ? str.capacity() + 1 : 0;
+		}
+
+		size_t ClosureHeapSize(const Closure& closure) {
+			size_t size = closure.bucket_count() * sizeof(void*);
+			for (const auto& [name, value] : closure) {
+				size += sizeof(void*) + sizeof(size_t) + sizeof(Closure::value_type) + StringHeapSize(name);
+			}
+			return size;
+		}
+
+		// Возвращает приблизительный объём памяти, занимаемый объектом
+		size_t ApproximateSize(const Object& object, ObjectKind kind) {
+			size_t size = CONTROL_BLOCK_SIZE;
+			switch (kind) {
+			case ObjectKind::NUMBER:
+				return size + sizeof(Number);
+			case ObjectKind::STRING:
+				return size + sizeof(String) + StringHeapSize(static_cast<const String&>(object).GetValue());
+			case ObjectKind::BOOL:
+				return size + sizeof(Bool);
+			case ObjectKind::CLASS:
+				return size + sizeof(Class);
+			case ObjectKind::CLASS_INSTANCE:
+				return size + sizeof(ClassInstance) + ClosureHeapSize(static_cast<const ClassInstance&>(object).Fields());
+			default:
+				return size + sizeof(Object);
+			}
+		}
+
+		struct Usage {
+			size_t count = 0;
+			size_t bytes = 0;
+
+			void Add(size_t object_bytes) {
+				++count;
+				bytes += object_bytes;
+			}
+		};
+
+		template <typename Key>
+		void WriteGroup(ostream& out, string_view title, const map<Key, Usage>& group) {
+			vector<pair<Key, Usage>> rows(group.begin(), group.end());
+			sort(rows.begin(), rows.end(), [](const auto& lhs, const auto& rhs) {
+				return lhs.second.bytes > rhs.second.bytes;
+				});
+			out << title << ":\n"sv;
+			for (const auto& [key, usage] : rows) {
+				out << "  "sv << key << ": "sv << usage.count << " objects, "sv << usage.bytes << " bytes\n"sv;
+			}
+		}
+
+		// Помечает объекты, достижимые из значения holder
+		void MarkReachable(const ObjectHolder& holder, unordered_set<const Object*>& reachable) {
+			vector<const Object*> pending;
+			if (holder) {
+				pending.push_back(holder.Get());
+			}
+			while (!pending.empty()) {
+				const Object* object = pending.back();
+				pending.pop_back();
+				if (!reachable.insert(object).second) {
+					continue;
+				}
+				if (const auto* instance = dynamic_cast<const ClassInstance*>(object)) {
+					for (const auto& [name, value] : instance->Fields()) {
+						if (value) {
+							pending.push_back(value.Get());
+						}
+					}
+				}
+			}
+		}
+
+		void HandleReportSignal(int /*signal*/);
+
+		// Устанавливает обработчик SIGUSR2 так же, как профилировщик - SIGPROF: обработчик не сбрасывается
+		// после первого сигнала, а прерванные сигналом системные вызовы продолжаются
+		void SetReportSignalHandler(void (*handler)(int), struct sigaction* previous) {
+			struct sigaction action {};
+			action.sa_handler = handler;
+			action.sa_flags = SA_RESTART;
+			sigemptyset(&action.sa_mask);
+			sigaction(SIGUSR2, &action, previous);
+		}
+
+		// Выводит запрошенный отчёт на границе инструкций
+		class ReportRequestListener : public ExecutionListener {
+		public:
+			void OnStatement(const Executable& /*statement*/, size_t /*line*/) override {
+				HeapCensus::PollReportRequest();
+			}
+		};
+
+		ReportRequestListener report_listener;
+		bool report_handler_installed = false;
+		// Обработчик SIGUSR2, действовавший до InstallSignalHandler
+		struct sigaction previous_report_action {};
+	}  // namespace
+
+	void HeapCensus::Enable() {
+		enabled_ = true;
+	}
+
+	void HeapCensus::Disable() {
+		enabled_ = false;
+		live_.clear();
+	}
+
+	void HeapCensus::Track(const Object& object, ObjectKind kind) {
+		live_[&object] = { kind, site_ };
+	}
+
+	void HeapCensus::Untrack(const Object* object) {
+		live_.erase(object);
+	}
+
+	void HeapCensus::MarkFrameSlot(const Object& object) {
+		if (auto it = live_.find(&object); it != live_.end()) {
+			it->second.frame_slot = true;
+		}
+	}
+
+	size_t HeapCensus::GetLiveCount() {
+		return live_.size();
+	}
+
+	size_t HeapCensus::GetFrameSlotCount() {
+		return count_if(live_.begin(), live_.end(), [](const auto& entry) {
+			return entry.second.frame_slot;
+		});
+	}
+
+	void HeapCensus::WriteReport(ostream& out, const Closure* globals) {
+		map<string, Usage> by_kind;
+		map<string, Usage> by_class;
+		map<string, Usage> by_site;
+		Usage total;
+
+		for (const auto& [object, record] : live_) {
+			const size_t bytes = ApproximateSize(*object, record.kind);
+			total.Add(bytes);
+			by_kind[ObjectKindName(record.kind)].Add(bytes);
+			if (record.kind == ObjectKind::CLASS_INSTANCE) {
+				by_class[static_cast<const ClassInstance*>(object)->GetClass().GetName()].Add(bytes);
+			}
+			by_site[string(record.site.node) + " line "s + to_string(record.site.line)].Add(bytes);
+		}
+
+		out << "heap census: "sv << total.count << " live objects, "sv << total.bytes << " bytes\n"sv;
+		WriteGroup(out, "by kind"sv, by_kind);
+		WriteGroup(out, "by class"sv, by_class);
+		WriteGroup(out, "by allocation site"sv, by_site);
+
+		if (globals == nullptr) {
+			return;
+		}
+		unordered_set<const Object*> reachable;
+		for (const auto& [name, value] : *globals) {
+			MarkReachable(value, reachable);
+		}
+		map<string, Usage> in_frame_slots;
+		map<string, Usage> unreachable;
+		for (const auto& [object, record] : live_) {
+			if (reachable.count(object) == 0 && record.kind == ObjectKind::CLASS_INSTANCE) {
+				const auto* instance = static_cast<const ClassInstance*>(object);
+				// Слоты кадров хранят экземпляры для повторного использования, это не утечка
+				auto& group = record.frame_slot ? in_frame_slots : unreachable;
+				group[instance->GetClass().GetName()].Add(ApproximateSize(*object, record.kind));
+			}
+		}
+		WriteGroup(out, "unreachable from globals (held by frame slots)"sv, in_frame_slots);
+		WriteGroup(out, "unreachable from globals (held by cycles)"sv, unreachable);
+	}
+
+	void HeapCensus::InstallSignalHandler(ostream& out) {
+		report_output_ = &out;
+		if (!report_handler_installed) {
+			ExecutionHooks::AddListener(report_listener);
+			SetReportSignalHandler(&HandleReportSignal, &previous_report_action);
+			report_handler_installed = true;
+		}
+	}
+
+	void HeapCensus::RemoveSignalHandler() {
+		if (report_handler_installed) {
+			sigaction(SIGUSR2, &previous_report_action, nullptr);
+			ExecutionHooks::RemoveListener(report_listener);
+			report_handler_installed = false;
+		}
+		report_output_ = nullptr;
+		report_requested_ = 0;
+	}
+
+	void HeapCensus::WriteRequestedReport() {
+		report_requested_ = 0;
+		if (report_output_) {
+			WriteReport(*report_output_);
+			report_output_->flush();
+		}
+	}
+
+	namespace {
+		void HandleReportSignal(int /*signal*/) {
+			HeapCensus::RequestReport();
+		}
+	}  // namespace
+
+}  // namespace runtime
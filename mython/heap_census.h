@@ -0,0 +1,88 @@
+#pragma once
+
+#include "stats.h"
+
+#include <csignal>
+#include <cstddef>
+#include <iosfwd>
+#include <unordered_map>
+
+namespace runtime {
+
+    class Closure;
+    class Object;
+
+    // Узел синтаксического дерева, создавший объект
+    struct AllocationSite {
+        const char* node = "<unknown>";
+        size_t line = 0;
+    };
+
+    /*
+     * Перепись живых объектов Mython. Пока перепись включена, каждый объект, созданный через
+     * ObjectHolder::Own, запоминается вместе с видом и местом создания, а при разрушении забывается.
+     * Отчёт группирует живые объекты по виду, по классу (для экземпляров классов) и по месту создания.
+     */
+    class HeapCensus {
+    public:
+        static void Enable();
+        // Выключает перепись и забывает все запомненные объекты
+        static void Disable();
+
+        [[nodiscard]] static bool IsEnabled() {
+            return enabled_;
+        }
+
+        // Запоминает место создания следующих объектов
+        static void SetSite(const char* node, size_t line) {
+            site_ = { node, line };
+        }
+
+        static void Track(const Object& object, ObjectKind kind);
+        static void Untrack(const Object* object);
+        // Отмечает объект, который удерживает слот кадра узла NewInstance (см. escape_analysis.h)
+        static void MarkFrameSlot(const Object& object);
+
+        // Возвращает количество живых объектов
+        [[nodiscard]] static size_t GetLiveCount();
+        // Возвращает количество живых объектов, которые удерживают слоты кадров
+        [[nodiscard]] static size_t GetFrameSlotCount();
+
+        // Выводит отчёт о живых объектах. Если задан globals, дополнительно выводятся объекты,
+        // недостижимые из глобальных переменных: удерживаемые слотами кадров и циклическими ссылками
+        static void WriteReport(std::ostream& out, const Closure* globals = nullptr);
+
+        // Устанавливает обработчик SIGUSR2, по которому отчёт выводится в out на ближайшей
+        // границе инструкций. Границы инструкций перепись получает как получатель событий исполнения (см. hooks.h)
+        static void InstallSignalHandler(std::ostream& out);
+        // Восстанавливает обработчик SIGUSR2, действовавший до InstallSignalHandler
+        static void RemoveSignalHandler();
+        // Запрашивает вывод отчёта. Безопасна для вызова из обработчика сигнала
+        static void RequestReport() {
+            report_requested_ = 1;
+        }
+
+        // Выводит отчёт, если он был запрошен сигналом
+        static void PollReportRequest() {
+            if (report_requested_) {
+                WriteRequestedReport();
+            }
+        }
+
+    private:
+        struct Record {
+            ObjectKind kind;
+            AllocationSite site;
+            bool frame_slot = false;
+        };
+
+        static void WriteRequestedReport();
+
+        inline static bool enabled_ = false;
+        inline static AllocationSite site_;
+        inline static std::unordered_map<const Object*, Record> live_;
+        inline static volatile std::sig_atomic_t report_requested_ = 0;
+        inline static std::ostream* report_output_ = nullptr;
+    };
+
+}  // namespace runtime
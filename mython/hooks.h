@@ -0,0 +1,181 @@
+#pragma once
+
+#include "stats.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace runtime {
+
+    class Object;
+    class ObjectHolder;
+    class ClassInstance;
+    class Executable;
+    struct Method;
+
+    // Получатель событий исполнения программы: профилировщики, трассировщики, отладчики, покрытие
+    class ExecutionListener {
+    public:
+        virtual ~ExecutionListener() = default;
+
+        // Вызов метода method объекта self с фактическими параметрами args
+        virtual void OnCall(const ClassInstance& /*self*/, const Method& /*method*/,
+            const std::vector<ObjectHolder>& /*args*/) {
+        }
+        // Завершение вызова метода, в том числе исключением
+        virtual void OnReturn(const ClassInstance& /*self*/, const Method& /*method*/) {
+        }
+        // Создание объекта вида kind
+        virtual void OnAlloc(const Object& /*object*/, ObjectKind /*kind*/) {
+        }
+        // Начало исполнения инструкции блока, расположенной в строке line
+        virtual void OnStatement(const Executable& /*statement*/, size_t /*line*/) {
+        }
+        // Завершение исполнения инструкции блока, в том числе исключением
+        virtual void OnStatementEnd(const Executable& /*statement*/, size_t /*line*/) {
+        }
+        // Вывод строки командой print
+        virtual void OnPrint() {
+        }
+    };
+
+    /*
+     * Политики точек расширения интерпретатора. Интерпретатор вызывает статические методы
+     * политики ExecutionHooks в местах вызова и возврата из методов, создания объектов,
+     * исполнения инструкций и вывода.
+     *
+     * NoHooks не делает ничего и после встраивания не оставляет в коде интерпретатора ни одной
+     * инструкции. DispatchHooks передаёт события зарегистрированным получателям, а пока их нет,
+     * обходится одной проверкой на событие.
+     */
+    struct NoHooks {
+        static constexpr bool ENABLED = false;
+
+        static void AddListener(ExecutionListener& /*listener*/) {
+        }
+        static void RemoveListener(ExecutionListener& /*listener*/) {
+        }
+
+        static void OnCall(const ClassInstance& /*self*/, const Method& /*method*/,
+            const std::vector<ObjectHolder>& /*args*/) {
+        }
+        static void OnReturn(const ClassInstance& /*self*/, const Method& /*method*/) {
+        }
+        static void OnAlloc(const Object& /*object*/, ObjectKind /*kind*/) {
+        }
+        static void OnStatement(const Executable& /*statement*/, size_t /*line*/) {
+        }
+        static void OnStatementEnd(const Executable& /*statement*/, size_t /*line*/) {
+        }
+        static void OnPrint() {
+        }
+    };
+
+    class DispatchHooks {
+    public:
+        static constexpr bool ENABLED = true;
+
+        static void AddListener(ExecutionListener& listener) {
+            listeners_.push_back(&listener);
+        }
+
+        static void RemoveListener(ExecutionListener& listener) {
+            listeners_.erase(std::remove(listeners_.begin(), listeners_.end(), &listener), listeners_.end());
+        }
+
+        static void OnCall(const ClassInstance& self, const Method& method, const std::vector<ObjectHolder>& args) {
+            for (ExecutionListener* listener : listeners_) {
+                listener->OnCall(self, method, args);
+            }
+        }
+
+        static void OnReturn(const ClassInstance& self, const Method& method) {
+            for (ExecutionListener* listener : listeners_) {
+                listener->OnReturn(self, method);
+            }
+        }
+
+        static void OnAlloc(const Object& object, ObjectKind kind) {
+            for (ExecutionListener* listener : listeners_) {
+                listener->OnAlloc(object, kind);
+            }
+        }
+
+        static void OnStatement(const Executable& statement, size_t line) {
+            for (ExecutionListener* listener : listeners_) {
+                listener->OnStatement(statement, line);
+            }
+        }
+
+        static void OnStatementEnd(const Executable& statement, size_t line) {
+            for (ExecutionListener* listener : listeners_) {
+                listener->OnStatementEnd(statement, line);
+            }
+        }
+
+        static void OnPrint() {
+            for (ExecutionListener* listener : listeners_) {
+                listener->OnPrint();
+            }
+        }
+
+    private:
+        inline static std::vector<ExecutionListener*> listeners_;
+    };
+
+    /*
+     * Политика, с которой собран интерпретатор. По умолчанию выбрана NoHooks, и код интерпретатора
+     * не содержит точек расширения. Инструменты, построенные на получателях событий (события --trace,
+     * отчёт --heap-census по SIGUSR2, --slow-calls=, --stack-dump, бюджет mython_perf_fuzz),
+     * требуют сборки с -DMYTHON_HOOKS, которая выбирает DispatchHooks
+     */
+#ifdef MYTHON_HOOKS
+    using ExecutionHooks = DispatchHooks;
+#else
+    using ExecutionHooks = NoHooks;
+#endif
+
+    // Сообщает политике Hooks о вызове метода и о его завершении по выходу из области видимости
+    template <typename Hooks>
+    class CallHooksScope {
+    public:
+        CallHooksScope(const ClassInstance& self, const Method& method, const std::vector<ObjectHolder>& args)
+            : self_(self), method_(method) {
+            Hooks::OnCall(self_, method_, args);
+        }
+
+        CallHooksScope(const CallHooksScope&) = delete;
+        CallHooksScope& operator=(const CallHooksScope&) = delete;
+
+        ~CallHooksScope() {
+            Hooks::OnReturn(self_, method_);
+        }
+
+    private:
+        const ClassInstance& self_;
+        const Method& method_;
+    };
+
+    // Сообщает политике Hooks о начале исполнения инструкции и о его завершении по выходу из области видимости
+    template <typename Hooks>
+    class StatementHooksScope {
+    public:
+        StatementHooksScope(const Executable& statement, size_t line)
+            : statement_(statement), line_(line) {
+            Hooks::OnStatement(statement_, line_);
+        }
+
+        StatementHooksScope(const StatementHooksScope&) = delete;
+        StatementHooksScope& operator=(const StatementHooksScope&) = delete;
+
+        ~StatementHooksScope() {
+            Hooks::OnStatementEnd(statement_, line_);
+        }
+
+    private:
+        const Executable& statement_;
+        size_t line_;
+    };
+
+}  // namespace runtime
@@ -0,0 +1,109 @@
+#include "hotspots.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <vector>
+
+using namespace std;
+
+namespace ast {
+
+	namespace {
+		struct LineCounters {
+			uint64_t count = 0;
+			chrono::nanoseconds time{ 0 };
+		};
+
+		struct Collected {
+			vector<LineCounters> lines;
+			vector<const IfElse*> branches;
+			vector<const MethodCall*> calls;
+		};
+
+		// Обходит дерево, суммируя счётчики инструкций блоков по строкам
+		void Collect(Statement& node, Collected& collected) {
+			if (const auto* branch = dynamic_cast<const IfElse*>(&node)) {
+				collected.branches.push_back(branch);
+			}
+			else if (const auto* call = dynamic_cast<const MethodCall*>(&node)) {
+				collected.calls.push_back(call);
+			}
+			// Разделяемое поддерево учитывается в месте, которое им владеет
+			if (dynamic_cast<const SharedNode*>(&node) != nullptr) {
+				return;
+			}
+			const bool is_block = dynamic_cast<const Compound*>(&node) != nullptr;
+			node.ForEachChild([&collected, is_block](Statement& child) {
+				if (is_block) {
+					const auto& counters = child.GetExecutionCounters();
+					if (collected.lines.size() <= child.GetLine()) {
+						collected.lines.resize(child.GetLine() + 1);
+					}
+					collected.lines[child.GetLine()].count += counters.count;
+					collected.lines[child.GetLine()].time += counters.time;
+				}
+				Collect(child, collected);
+				});
+		}
+
+		double ToMilliseconds(chrono::nanoseconds duration) {
+			return chrono::duration<double, milli>(duration).count();
+		}
+	}  // namespace
+
+	void HotSpots::WriteReport(ostream& out, Statement& program, string_view source, size_t top_n) {
+		Collected collected;
+		Collect(program, collected);
+
+		out << "    hits    time_ms | source\n"sv;
+		size_t line_number = 1;
+		while (!source.empty()) {
+			const size_t end = source.find('\n');
+			const string_view line = source.substr(0, end);
+			source.remove_prefix(end == string_view::npos ? source.size() : end + 1);
+
+			const LineCounters counters = line_number < collected.lines.size()
+				? collected.lines[line_number] : LineCounters{};
+			if (counters.count > 0) {
+				out << setw(8) << counters.count << ' ' << setw(10) << fixed << setprecision(3)
+					<< ToMilliseconds(counters.time);
+			}
+			else {
+				out << setw(19) << ""sv;
+			}
+			out << " | "sv << line << '\n';
+			++line_number;
+		}
+
+		auto& branches = collected.branches;
+		sort(branches.begin(), branches.end(), [](const IfElse* lhs, const IfElse* rhs) {
+			return lhs->GetTakenCount() + lhs->GetNotTakenCount() > rhs->GetTakenCount() + rhs->GetNotTakenCount();
+			});
+		out << "\nhottest branches:\n"sv;
+		for (size_t i = 0; i < min(top_n, branches.size()); ++i) {
+			const uint64_t total = branches[i]->GetTakenCount() + branches[i]->GetNotTakenCount();
+			if (total == 0) {
+				break;
+			}
+			out << "  line "sv << branches[i]->GetLine() << ": "sv << total << " evaluations, taken "sv
+				<< setprecision(1) << 100.0 * branches[i]->GetTakenCount() / total << "%, not taken "sv
+				<< 100.0 * branches[i]->GetNotTakenCount() / total << "%\n"sv;
+		}
+
+		auto& calls = collected.calls;
+		sort(calls.begin(), calls.end(), [](const MethodCall* lhs, const MethodCall* rhs) {
+			return lhs->GetExecutionCounters().count > rhs->GetExecutionCounters().count;
+			});
+		out << "\nhottest call sites:\n"sv;
+		for (size_t i = 0; i < min(top_n, calls.size()); ++i) {
+			const auto& counters = calls[i]->GetExecutionCounters();
+			if (counters.count == 0) {
+				break;
+			}
+			out << "  line "sv << calls[i]->GetLine() << ": "sv << calls[i]->GetMethodName() << "() "sv
+				<< counters.count << " calls, "sv << setprecision(3) << ToMilliseconds(counters.time) << " ms\n"sv;
+		}
+	}
+
+}  // namespace ast
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "statement.h"
+
+#include <chrono>
+#include <iosfwd>
+#include <string_view>
+
+namespace ast {
+
+    /*
+     * Сбор горячих точек программы. Пока сбор включён, инструкции блоков и вызовы методов
+     * увеличивают свои счётчики исполнений и суммарное время исполнения, а условные
+     * инструкции считают, сколько раз выполнялась каждая из веток.
+     */
+    class HotSpots {
+    public:
+        static void Enable() {
+            enabled_ = true;
+        }
+
+        static void Disable() {
+            enabled_ = false;
+        }
+
+        [[nodiscard]] static bool IsEnabled() {
+            return enabled_;
+        }
+
+        // Учитывает исполнение узла node за время своей жизни. Вызов метода, который является
+        // инструкцией блока, открывают и Compound, и сам MethodCall: учитывается только внешний
+        class Scope {
+        public:
+            explicit Scope(Statement& node)
+                : counters_(enabled_ && active_ != &node ? &node.GetExecutionCounters() : nullptr) {
+                if (counters_) {
+                    ++counters_->count;
+                    parent_ = active_;
+                    active_ = &node;
+                    start_ = std::chrono::steady_clock::now();
+                }
+            }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+            ~Scope() {
+                if (counters_) {
+                    counters_->time += std::chrono::steady_clock::now() - start_;
+                    active_ = parent_;
+                }
+            }
+
+        private:
+            Statement::ExecutionCounters* counters_;
+            const Statement* parent_ = nullptr;
+            std::chrono::steady_clock::time_point start_;
+        };
+
+        // Выводит текст программы source, каждая строка которого снабжена количеством исполнений
+        // и суммарным временем, а также top_n самых часто исполняемых условий и вызовов методов
+        static void WriteReport(std::ostream& out, Statement& program, std::string_view source, size_t top_n = 10);
+
+    private:
+        inline static bool enabled_ = false;
+        // Узел самого внутреннего учитываемого исполнения
+        inline static const Statement* active_ = nullptr;
+    };
+
+}  // namespace ast
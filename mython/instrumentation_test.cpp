@@ -0,0 +1,714 @@
+#include "heap_census.h"
+#include "hooks.h"
+#include "hotspots.h"
+#include "lexer.h"
+#include "output_cache.h"
+#include "parse.h"
+#include "perf_lint.h"
+#include "profiler.h"
+#include "runtime.h"
+#include "slow_log.h"
+#include "stack_dump.h"
+#include "statement.h"
+#include "stats.h"
+#include "str_cache.h"
+#include "test_runner_p.h"
+#include "trace.h"
+
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace runtime {
+
+    namespace {
+        void RunProgram(const string& program, DummyContext& context) {
+            istringstream input(program);
+            parse::Lexer lexer(input);
+            auto tree = ParseProgram(lexer);
+            Closure closure;
+            tree->Execute(closure, context);
+        }
+
+        void TestStatsCounters() {
+            const string program = R"(
+class Base:
+  def get():
+    return 1
+
+class Derived(Base):
+  def twice():
+    return self.get() + self.get()
+
+d = Derived()
+print d.twice()
+)"s;
+            Stats::Reset();
+            DummyContext context;
+            RunProgram(program, context);
+            ASSERT_EQUAL(context.output.str(), "2\n"s);
+
+            const Counters& counters = Stats::Get();
+            ASSERT_EQUAL(counters.method_calls, 3u);
+            ASSERT_EQUAL(counters.returns, 3u);
+            // Метод get находится только в родительском классе
+            ASSERT(counters.method_lookup_hops >= 2u);
+            ASSERT(counters.method_lookups >= counters.method_calls);
+            ASSERT_EQUAL(counters.objects_allocated[static_cast<size_t>(ObjectKind::CLASS)], 2u);
+            ASSERT_EQUAL(counters.objects_allocated[static_cast<size_t>(ObjectKind::CLASS_INSTANCE)], 1u);
+            ASSERT(counters.tokens_lexed > 0);
+            ASSERT(counters.ast_nodes > 0);
+        }
+
+        void TestScriptCountersAndTimers() {
+            const string program = R"(
+class Work:
+  def run(n):
+    timer_start('run')
+    counter_add('items', n)
+    return timer_stop('run')
+
+w = Work()
+start = clock_ns()
+w.run(3)
+w.run(4)
+print clock_ns() - start >= 0, w.run(0) >= 0
+)"s;
+            Stats::Reset();
+            DummyContext context;
+            RunProgram(program, context);
+
+            ASSERT_EQUAL(context.output.str(), "True True\n"s);
+            ASSERT_EQUAL(Stats::GetUserCounter("items"s), 7);
+            ASSERT_EQUAL(Stats::GetUserTimer("run"s).count, 3u);
+            ASSERT(Stats::GetUserTimer("run"s).started.empty());
+
+            ostringstream text;
+            Stats::WriteText(text);
+            ASSERT(text.str().find("user counters:\n  items: 7\n"s) != string::npos);
+            ASSERT(text.str().find("  run: "s) != string::npos);
+
+            try {
+                DummyContext error_context;
+                RunProgram("timer_stop('never')\n"s, error_context);
+                ASSERT(false);
+            }
+            catch (const runtime_error&) {
+            }
+        }
+
+        void TestSamplingProfiler() {
+            const string program = R"(
+class Spin:
+  def run(n):
+    if n > 0:
+      return self.run(n - 1)
+    return 0
+
+s = Spin()
+x = s.run(300)
+)"s;
+            // Семплы ссылаются на классы программы, поэтому дерево живёт до вывода профиля
+            istringstream input(program);
+            parse::Lexer lexer(input);
+            auto tree = ParseProgram(lexer);
+
+            // Обработчик SIGPROF, установленный до профилировщика, восстанавливается после Stop
+            void (*const previous_handler)(int) = [](int) {};
+            struct sigaction previous {};
+            previous.sa_handler = previous_handler;
+            sigemptyset(&previous.sa_mask);
+            sigaction(SIGPROF, &previous, nullptr);
+
+            SamplingProfiler profiler(chrono::microseconds{ 100 });
+            profiler.Start();
+            SamplingProfiler other;
+            ASSERT_THROWS(other.Start(), runtime_error);
+            // Таймер считает процессорное время, поэтому программа повторяется до первых семплов
+            DummyContext context;
+            for (int i = 0; i < 2000 && profiler.GetSampleCount() < 5; ++i) {
+                Closure closure;
+                tree->Execute(closure, context);
+            }
+            profiler.Stop();
+            const size_t samples = profiler.GetSampleCount();
+            ASSERT(samples >= 5u);
+            struct sigaction restored {};
+            sigaction(SIGPROF, nullptr, &restored);
+            ASSERT(restored.sa_handler == previous_handler);
+            previous.sa_handler = SIG_DFL;
+            sigaction(SIGPROF, &previous, nullptr);
+
+            ostringstream out;
+            profiler.WriteFolded(out);
+            ASSERT_EQUAL(profiler.GetSampleCount(), samples);
+            // Каждая строка - стек от верхнего уровня программы и количество его семплов
+            istringstream lines(out.str());
+            size_t total = 0;
+            for (string line; getline(lines, line);) {
+                ASSERT(line.rfind("<module>:"s, 0) == 0);
+                total += stoul(line.substr(line.rfind(' ') + 1));
+            }
+            ASSERT_EQUAL(total, samples);
+        }
+
+        void TestHeapCensus() {
+            const string program = R"(
+class Node:
+  def link(other):
+    self.next = other
+
+class Maker:
+  def cycle():
+    a = Node()
+    b = Node()
+    a.link(b)
+    b.link(a)
+
+m = Maker()
+m.cycle()
+n = Node()
+)"s;
+            HeapCensus::Enable();
+            ostringstream report;
+            {
+                istringstream input(program);
+                parse::Lexer lexer(input);
+                auto tree = ParseProgram(lexer);
+                DummyContext context;
+                Closure closure;
+                tree->Execute(closure, context);
+                HeapCensus::WriteReport(report, &closure);
+            }
+            const size_t leaked = HeapCensus::GetLiveCount();
+            HeapCensus::Disable();
+
+            const string text = report.str();
+            ASSERT(text.find("Node: 3 objects"s) != string::npos);
+            ASSERT(text.find("NewInstance line 8: 1 objects"s) != string::npos);
+            ASSERT(text.find("NewInstance line 15: 1 objects"s) != string::npos);
+            ASSERT(text.find("held by cycles):\n  Node: 2 objects"s) != string::npos);
+            // Экземпляры из цикла переживают разрушение программы
+            ASSERT_EQUAL(leaked, 2u);
+        }
+
+        void TestTraceKeepsLastEvents() {
+            Class cls{ "Point"s, {}, nullptr };
+            TraceRecorder recorder{ 3 };
+            recorder.BeginPhase("execute");
+            recorder.NewInstance(cls);
+            recorder.PrintFlush();
+            recorder.EndPhase("execute");
+            recorder.PrintFlush();
+            ASSERT_EQUAL(recorder.GetDroppedCount(), 2u);
+
+            ostringstream out;
+            recorder.WriteJson(out);
+            const string json = out.str();
+            // Конец фазы без начала не выводится
+            ASSERT(json.find("\"execute\""s) == string::npos);
+            ASSERT(json.find("\"Point\""s) == string::npos);
+            ASSERT(json.find("\"print\",\"cat\":\"io\",\"ph\":\"i\""s) != string::npos);
+        }
+
+        void TestTraceRecordsOnlyWhenActive() {
+            TraceRecorder recorder;
+            ASSERT(TraceRecorder::Active() == nullptr);
+            {
+                TraceRecorder::PhaseScope phase("lex");
+            }
+            recorder.Activate();
+            {
+                TraceRecorder::PhaseScope phase("parse");
+            }
+            recorder.Deactivate();
+
+            ostringstream out;
+            recorder.WriteJson(out);
+            ASSERT(out.str().find("\"lex\""s) == string::npos);
+            ASSERT(out.str().find("\"parse\",\"cat\":\"phase\",\"ph\":\"E\""s) != string::npos);
+        }
+
+        void TestHotSpots() {
+            const string program = R"(
+class Sign:
+  def of(n):
+    if n < 0:
+      return -1
+    return 1
+
+s = Sign()
+print s.of(-5), s.of(3), s.of(7)
+)"s;
+            istringstream input(program);
+            parse::Lexer lexer(input);
+            auto tree = ParseProgram(lexer);
+            Closure closure;
+            DummyContext context;
+            ast::HotSpots::Enable();
+            tree->Execute(closure, context);
+            ast::HotSpots::Disable();
+
+            ostringstream out;
+            ast::HotSpots::WriteReport(out, *tree, program);
+            const string report = out.str();
+            ASSERT(report.find("line 4: 3 evaluations, taken 33.3%, not taken 66.7%"s) != string::npos);
+            ASSERT(report.find("line 9: of() 1 calls"s) != string::npos);
+            ASSERT(report.find("       2 "s) != string::npos);
+        }
+
+        void TestHotSpotsCountStatementCallOnce() {
+            const string program = R"(
+class Counter:
+  def bump():
+    self.n = 1
+
+c = Counter()
+c.bump()
+)"s;
+            istringstream input(program);
+            parse::Lexer lexer(input);
+            auto tree = ParseProgram(lexer);
+            Closure closure;
+            DummyContext context;
+            ast::HotSpots::Enable();
+            tree->Execute(closure, context);
+            ast::HotSpots::Disable();
+
+            // Вызов - инструкция блока: его исполнение учитывают и блок, и сам вызов
+            size_t calls = 0;
+            ast::ForEachNode(*tree, [&calls](ast::Statement& node) {
+                if (dynamic_cast<ast::MethodCall*>(&node)) {
+                    ASSERT_EQUAL(node.GetExecutionCounters().count, 1u);
+                    ++calls;
+                }
+            });
+            ASSERT_EQUAL(calls, 1u);
+
+            ostringstream out;
+            ast::HotSpots::WriteReport(out, *tree, program);
+            ASSERT(out.str().find("bump() 1 calls"s) != string::npos);
+        }
+
+        class CountingListener : public ExecutionListener {
+        public:
+            void OnCall(const ClassInstance& /*self*/, const Method& method, const std::vector<ObjectHolder>& args) override {
+                ++calls;
+                args_passed += args.size();
+                last_method = method.name;
+            }
+            void OnReturn(const ClassInstance& /*self*/, const Method& /*method*/) override {
+                ++returns;
+            }
+            void OnAlloc(const Object& /*object*/, ObjectKind kind) override {
+                instances += kind == ObjectKind::CLASS_INSTANCE ? 1 : 0;
+            }
+            void OnStatement(const Executable& /*statement*/, size_t line) override {
+                lines.push_back(line);
+            }
+            void OnPrint() override {
+                ++prints;
+            }
+
+            int calls = 0;
+            int returns = 0;
+            size_t args_passed = 0;
+            int instances = 0;
+            int prints = 0;
+            vector<size_t> lines;
+            string last_method;
+        };
+
+        void TestExecutionHooks() {
+            const string program = R"(
+class Adder:
+  def add(a, b):
+    return a + b
+
+x = Adder()
+print x.add(2, 3)
+print x.add(1, 1)
+)"s;
+            CountingListener listener;
+            ExecutionHooks::AddListener(listener);
+            DummyContext context;
+            RunProgram(program, context);
+            ExecutionHooks::RemoveListener(listener);
+
+            if constexpr (ExecutionHooks::ENABLED) {
+                ASSERT_EQUAL(listener.calls, 2);
+                ASSERT_EQUAL(listener.returns, 2);
+                ASSERT_EQUAL(listener.args_passed, 4u);
+                ASSERT_EQUAL(listener.last_method, "add"s);
+                ASSERT_EQUAL(listener.instances, 1);
+                ASSERT_EQUAL(listener.prints, 2);
+                // Инструкции программы и тела метода при каждом из двух вызовов
+                ASSERT_EQUAL(listener.lines, (vector<size_t>{ 2, 6, 7, 4, 8, 4 }));
+            }
+            else {
+                ASSERT_EQUAL(listener.calls + listener.prints + listener.instances, 0);
+            }
+        }
+
+        // Выводит дамп стека при исполнении строки line
+        class DumpAtLine : public ExecutionListener {
+        public:
+            explicit DumpAtLine(size_t line)
+                : line_(line) {
+            }
+
+            void OnStatement(const Executable& /*statement*/, size_t line) override {
+                if (line == line_) {
+                    StackDump::Write(dump);
+                }
+            }
+
+            ostringstream dump;
+
+        private:
+            size_t line_;
+        };
+
+        void TestStackDump() {
+            const string program = R"(
+class Greeter:
+  def greet(name, times):
+    return self.inner(name)
+
+  def inner(who):
+    return who
+
+g = Greeter()
+print g.greet('world', 2)
+)"s;
+            DumpAtLine listener(7);
+            ExecutionHooks::AddListener(listener);
+            DummyContext context;
+            RunProgram(program, context);
+            ExecutionHooks::RemoveListener(listener);
+
+            if constexpr (ExecutionHooks::ENABLED) {
+                const string dump = listener.dump.str();
+                ASSERT(dump.find("depth 2:\n"
+                                 "  Greeter.inner(who='world') line 7\n"
+                                 "  Greeter.greet(name='world', times=2) line 4\n"
+                                 "  <module> line 10\n"s) != string::npos);
+                ASSERT(dump.find("method_calls: "s) != string::npos);
+            }
+        }
+
+        void TestSignalRequests() {
+            // Обработчики, действовавшие до установки, восстанавливаются при удалении
+            const auto set_handler = [](int signal, void (*handler)(int)) {
+                struct sigaction action {};
+                action.sa_handler = handler;
+                sigemptyset(&action.sa_mask);
+                sigaction(signal, &action, nullptr);
+            };
+            set_handler(SIGUSR1, SIG_IGN);
+            set_handler(SIGUSR2, SIG_IGN);
+            const auto restored_handler = [](int signal) {
+                struct sigaction action {};
+                sigaction(signal, nullptr, &action);
+                return action.sa_handler;
+            };
+
+            ostringstream dump;
+            ostringstream census;
+            StackDump::InstallSignalHandler(dump);
+            HeapCensus::InstallSignalHandler(census);
+            raise(SIGUSR1);
+            raise(SIGUSR2);
+            // Запросы выполняются на границе инструкций, а не в обработчике сигнала
+            ASSERT(dump.str().empty());
+            ASSERT(census.str().empty());
+
+            DummyContext context;
+            RunProgram("x = 1\n"s, context);
+            StackDump::RemoveSignalHandler();
+            HeapCensus::RemoveSignalHandler();
+            ASSERT(restored_handler(SIGUSR1) == SIG_IGN);
+            ASSERT(restored_handler(SIGUSR2) == SIG_IGN);
+            set_handler(SIGUSR1, SIG_DFL);
+            set_handler(SIGUSR2, SIG_DFL);
+
+            if constexpr (ExecutionHooks::ENABLED) {
+                ASSERT(dump.str().find("mython stack dump after "s) == 0);
+                ASSERT(!census.str().empty());
+            }
+        }
+
+        void TestSlowCallLog() {
+            const string program = R"(
+class Greeter:
+  def greet(name):
+    return self.inner(name)
+
+  def inner(who):
+    return who
+
+g = Greeter()
+if True:
+  print g.greet('world')
+)"s;
+            ostringstream log;
+            SlowCallLog::Enable(chrono::nanoseconds{ 0 }, log);
+            DummyContext context;
+            RunProgram(program, context);
+            SlowCallLog::Disable();
+            if constexpr (!ExecutionHooks::ENABLED) {
+                ASSERT(log.str().empty());
+                return;
+            }
+
+            const string text = log.str();
+            ASSERT(text.find("slow call: Greeter.inner(who='world') depth 2 "s) < text.find("slow call: Greeter.greet(name='world') depth 1 "s));
+            ASSERT(text.find("slow statement: line 10 depth 0 "s) != string::npos);
+            // Инструкция, вложенная в учтённую инструкцию верхнего уровня, не записывается отдельно
+            ASSERT(text.find("slow statement: line 11"s) == string::npos);
+
+            ostringstream quiet_log;
+            SlowCallLog::Enable(chrono::hours{ 1 }, quiet_log);
+            RunProgram(program, context);
+            SlowCallLog::Disable();
+            ASSERT(quiet_log.str().empty());
+        }
+
+        void TestOutputCache() {
+            namespace fs = std::filesystem;
+
+            const auto is_cacheable = [](const string& program) {
+                istringstream input(program);
+                parse::Lexer lexer(input);
+                return OutputCache::IsCacheable(*ParseProgram(lexer));
+            };
+            ASSERT(is_cacheable("x = 1\nprint x\n"s));
+            ASSERT(!is_cacheable("class A:\n  def f():\n    return clock_ns()\na = A()\nprint a.f()\n"s));
+            ASSERT(!is_cacheable("timer_start('t')\nx = timer_stop('t')\n"s));
+
+            // Адрес экземпляра без __str__ различается в разных запусках
+            const auto is_reproducible = [](const string& program) {
+                Stats::Reset();
+                DummyContext context;
+                RunProgram(program, context);
+                return OutputCache::IsOutputReproducible();
+            };
+            ASSERT(is_reproducible("class A:\n  def __str__():\n    return 'a'\nprint A()\n"s));
+            ASSERT(!is_reproducible("class A:\n  def f():\n    return 1\nprint A()\n"s));
+            ASSERT(!is_reproducible("class A:\n  def f():\n    return 1\nx = str(A())\n"s));
+            Stats::Reset();
+
+            const string key_a = OutputCache::MakeKey("print 1\n"s);
+            const string key_b = OutputCache::MakeKey("print 2\n"s);
+            const string key_c = OutputCache::MakeKey("print 3\n"s);
+            ASSERT(key_a != key_b);
+            ASSERT_EQUAL(key_a, OutputCache::MakeKey("print 1\n"s));
+
+            const fs::path directory = fs::temp_directory_path() / ("mython_output_cache_test_"s + to_string(getpid()));
+            fs::remove_all(directory);
+            {
+                // Между обращениями к записям проходит время, чтобы их порядок был виден по времени изменения
+                const auto tick = [] {
+                    this_thread::sleep_for(chrono::milliseconds(20));
+                };
+                OutputCache cache(directory, 2);
+                ASSERT(!cache.Lookup(key_a, "print 1\n"s));
+                cache.Store(key_a, "print 1\n"s, "1\n"s);
+                tick();
+                cache.Store(key_b, "print 2\n"s, "2\n"s);
+                tick();
+                ASSERT_EQUAL(cache.Lookup(key_a, "print 1\n"s).value_or(""s), "1\n"s);
+                tick();
+
+                // Вытесняется давно не использованная запись b
+                cache.Store(key_c, "print 3\n"s, "3\n"s);
+                ASSERT_EQUAL(cache.Lookup(key_a, "print 1\n"s).value_or(""s), "1\n"s);
+                ASSERT(!cache.Lookup(key_b, "print 2\n"s));
+                ASSERT_EQUAL(cache.Lookup(key_c, "print 3\n"s).value_or(""s), "3\n"s);
+
+                // Запись с тем же ключом, но другим текстом программы (коллизия хэша) не выдаётся
+                ASSERT(!cache.Lookup(key_a, "print 4\n"s));
+                ASSERT(!cache.Lookup(key_a, "print 1\n\n"s));
+            }
+            fs::remove_all(directory);
+
+            ostringstream target;
+            RecordingStreamBuf recording(target.rdbuf());
+            ostream out(&recording);
+            out << "value "s << 42 << '\n';
+            out.flush();
+            ASSERT_EQUAL(target.str(), "value 42\n"s);
+            ASSERT_EQUAL(recording.GetRecorded(), "value 42\n"s);
+        }
+
+        void TestPerfLint() {
+            const string program = R"(
+class Helper:
+  def twice(x):
+    return x * 2
+
+class Node:
+  def __init__(v):
+    self.v = v
+    self.next = None
+
+  def __lt__(other):
+    return self.v < other.v
+
+  def sum(n):
+    if n < 1:
+      return 0
+    return n + self.sum(n - 1)
+
+  def join(n, s):
+    if n < 1:
+      return s
+    h = Helper()
+    return self.join(n - 1, s + str(h.twice(n)))
+
+  def depth():
+    return self.next.next.v + self.next.next.v
+
+a = Node(1)
+b = Node(2)
+print a > b, a <= b, a < b, 1 > 2
+print str('x' + 'y')
+)"s;
+            istringstream input(program);
+            parse::Lexer lexer(input);
+            auto tree = ParseProgram(lexer);
+            const vector<ast::PerfLintWarning> warnings = ast::PerfLint(*tree);
+
+            vector<pair<size_t, string>> found;
+            for (const ast::PerfLintWarning& warning : warnings) {
+                found.emplace_back(warning.line, warning.check);
+            }
+            // Строки считаются с учётом пустой первой строки программы. Хвостовой рекурсивный вызов,
+            // сравнения < и сравнения чисел замечаний не дают
+            const vector<pair<size_t, string>> expected = {
+                { 17, "non-tail-recursion"s },
+                { 22, "dummy-instance"s },
+                { 23, "quadratic-concat"s },
+                { 26, "repeated-chain"s },
+                { 30, "double-compare"s },
+                { 30, "double-compare"s },
+                { 31, "redundant-str"s },
+            };
+            ASSERT(found == expected);
+
+            ostringstream report;
+            ast::WritePerfLintReport(report, warnings);
+            ASSERT(report.str().find("line 26: [repeated-chain] self.next.next.v is evaluated 2 times in Node.depth"s) != string::npos);
+        }
+
+        void TestStrCache() {
+            const string program = R"(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def __str__():
+    return '(' + str(self.x) + ', ' + str(self.y) + ')'
+
+class Segment:
+  def __init__(a, b):
+    self.a = a
+    self.b = b
+
+  def __str__():
+    return str(self.a) + '-' + str(self.b)
+
+class Clock:
+  def __str__():
+    print 'tick'
+    return 'clock'
+
+a = Point(1, 2)
+s = Segment(a, Point(3, 4))
+print s, s
+a.x = 5
+print s, a
+s.b = a
+print s
+c = Clock()
+print c, c
+)"s;
+            Stats::Reset();
+            StrCache::Enable();
+            DummyContext context;
+            RunProgram(program, context);
+            StrCache::Disable();
+
+            ASSERT_EQUAL(context.output.str(),
+                "(1, 2)-(3, 4) (1, 2)-(3, 4)\n(5, 2)-(3, 4) (5, 2)\n(5, 2)-(5, 2)\ntick\nclock tick\nclock\n"s);
+            const Counters& counters = Stats::Get();
+            // Повторный вывод s берётся из кэша целиком. После изменения поля a заново вычисляются
+            // a и s, но не вторая точка; после изменения s.b - только s, а обе точки берутся из кэша
+            ASSERT_EQUAL(counters.str_cache_hits, 5u);
+            // Результат __str__, выводящий текст, не кэшируется
+            ASSERT_EQUAL(counters.str_cache_misses, 8u);
+        }
+
+        void TestStrCacheKeepsNoCycles() {
+            const string program = R"(
+class Link:
+  def __init__(node):
+    self.node = node
+
+class Node:
+  def __init__(name):
+    self.name = name
+
+  def __str__():
+    return self.name + '>' + self.link.node.name
+
+a = Node('a')
+b = Node('b')
+a.link = Link(b)
+b.link = Link(a)
+print a, b, a
+a.link.node = None
+b.link.node = None
+)"s;
+            // Кэш a зависит от b, а кэш b - от a. Цикл полей разорван без присваивания полям a и b,
+            // поэтому их кэши сохраняются, но объекты всё равно разрушаются вместе с программой
+            HeapCensus::Enable();
+            StrCache::Enable();
+            DummyContext context;
+            RunProgram(program, context);
+            StrCache::Disable();
+            const size_t leaked = HeapCensus::GetLiveCount();
+            HeapCensus::Disable();
+
+            ASSERT_EQUAL(context.output.str(), "a>b b>a a>b\n"s);
+            ASSERT_EQUAL(leaked, 0u);
+        }
+    }  // namespace
+
+    void RunInstrumentationTests(TestRunner& tr) {
+        RUN_TEST(tr, runtime::TestStatsCounters);
+        RUN_TEST(tr, runtime::TestScriptCountersAndTimers);
+        RUN_TEST(tr, runtime::TestSamplingProfiler);
+        RUN_TEST(tr, runtime::TestHeapCensus);
+        RUN_TEST(tr, runtime::TestHotSpots);
+        RUN_TEST(tr, runtime::TestHotSpotsCountStatementCallOnce);
+        RUN_TEST(tr, runtime::TestExecutionHooks);
+        RUN_TEST(tr, runtime::TestStackDump);
+        RUN_TEST(tr, runtime::TestSignalRequests);
+        RUN_TEST(tr, runtime::TestSlowCallLog);
+        RUN_TEST(tr, runtime::TestOutputCache);
+        RUN_TEST(tr, runtime::TestPerfLint);
+        RUN_TEST(tr, runtime::TestStrCache);
+        RUN_TEST(tr, runtime::TestStrCacheKeepsNoCycles);
+        RUN_TEST(tr, runtime::TestTraceKeepsLastEvents);
+        RUN_TEST(tr, runtime::TestTraceRecordsOnlyWhenActive);
+    }
+
+}  // namespace runtime
@@ -1,141 +1,454 @@
-#include "lexer.h"
-#include "parse.h"
-#include "runtime.h"
-#include "statement.h"
-#include "test_runner_p.h"
-
-#include <iostream>
-
-using namespace std;
-
-namespace parse {
-    void RunOpenLexerTests(TestRunner& tr);
-}  // namespace parse
-
-namespace ast {
-    void RunUnitTests(TestRunner& tr);
-}
-namespace runtime {
-    void RunObjectHolderTests(TestRunner& tr);
-    void RunObjectsTests(TestRunner& tr);
-}  // namespace runtime
-
-void TestParseProgram(TestRunner& tr);
-
-namespace {
-
-    void RunMythonProgram(istream& input, ostream& output) {
-        parse::Lexer lexer(input);
-        auto program = ParseProgram(lexer);
-
-        runtime::SimpleContext context{ output };
-        runtime::Closure closure;
-        program->Execute(closure, context);
-    }
-
-    void TestSimplePrints() {
-        istringstream input(R"(
-print 57
-print 10, 24, -8
-print 'hello'
-print "world"
-print True, False
-print
-print None
-)");
-
-        ostringstream output;
-        RunMythonProgram(input, output);
-
-        ASSERT_EQUAL(output.str(), "57\n10 24 -8\nhello\nworld\nTrue False\n\nNone\n");
-    }
-
-    void TestAssignments() {
-        istringstream input(R"(
-x = 57
-print x
-x = 'C++ black belt'
-print x
-y = False
-x = y
-print x
-x = None
-print x, y
-)");
-
-        ostringstream output;
-        RunMythonProgram(input, output);
-
-        ASSERT_EQUAL(output.str(), "57\nC++ black belt\nFalse\nNone False\n");
-    }
-
-    void TestArithmetics() {
-        istringstream input("print 1+2+3+4+5, 1*2*3*4*5, 1-2-3-4-5, 36/4/3, 2*5+10/2");
-
-        ostringstream output;
-        RunMythonProgram(input, output);
-
-        ASSERT_EQUAL(output.str(), "15 120 -13 3 15\n");
-    }
-
-    void TestVariablesArePointers() {
-        istringstream input(R"(
-class Counter:
-  def __init__():
-    self.value = 0
-
-  def add():
-    self.value = self.value + 1
-
-class Dummy:
-  def do_add(counter):
-    counter.add()
-
-x = Counter()
-y = x
-
-x.add()
-y.add()
-
-print x.value
-
-d = Dummy()
-d.do_add(x)
-
-print y.value
-)");
-
-        ostringstream output;
-        RunMythonProgram(input, output);
-
-        ASSERT_EQUAL(output.str(), "2\n3\n");
-    }
-
-    void TestAll() {
-        TestRunner tr;
-        parse::RunOpenLexerTests(tr);
-        runtime::RunObjectHolderTests(tr);
-        runtime::RunObjectsTests(tr);
-        ast::RunUnitTests(tr);
-        TestParseProgram(tr);
-
-        RUN_TEST(tr, TestSimplePrints);
-        RUN_TEST(tr, TestAssignments);
-        RUN_TEST(tr, TestArithmetics);
-        RUN_TEST(tr, TestVariablesArePointers);
-    }
-
-}  // namespace
-
-int main() {
-    try {
-        TestAll();
-
-        RunMythonProgram(cin, cout);
-    }
-    catch (const std::exception& e) {
-        std::cerr << e.what() << std::endl;
-        return 1;
-    }
-    return 0;
+#include "hooks.h"
+#include "hotspots.h"
+#include "lexer.h"
+#include "output_cache.h"
+#include "parse.h"
+#include "perf_lint.h"
+#include "profiler.h"
+#include "runtime.h"
+#include "slow_log.h"
+#include "stack_dump.h"
+#include "statement.h"
+#include "stats.h"
+#include "str_cache.h"
+#include "test_runner_p.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace parse {
+    void RunOpenLexerTests(TestRunner& tr);
+}  // namespace parse
+
+namespace ast {
+    void RunUnitTests(TestRunner& tr);
+}
+namespace runtime {
+    void RunObjectHolderTests(TestRunner& tr);
+    void RunObjectsTests(TestRunner& tr);
+    void RunInstrumentationTests(TestRunner& tr);
+}  // namespace runtime
+
+void TestParseProgram(TestRunner& tr);
+
+namespace {
+
+    void RunMythonProgram(istream& input, ostream& output) {
+        parse::Lexer lexer(input);
+        auto program = ParseProgram(lexer);
+
+        runtime::SimpleContext context{ output };
+        runtime::Closure closure;
+        program->Execute(closure, context);
+    }
+
+    void TestSimplePrints() {
+        istringstream input(R"(
+print 57
+print 10, 24, -8
+print 'hello'
+print "world"
+print True, False
+print
+print None
+)");
+
+        ostringstream output;
+        RunMythonProgram(input, output);
+
+        ASSERT_EQUAL(output.str(), "57\n10 24 -8\nhello\nworld\nTrue False\n\nNone\n");
+    }
+
+    void TestAssignments() {
+        istringstream input(R"(
+x = 57
+print x
+x = 'C++ black belt'
+print x
+y = False
+x = y
+print x
+x = None
+print x, y
+)");
+
+        ostringstream output;
+        RunMythonProgram(input, output);
+
+        ASSERT_EQUAL(output.str(), "57\nC++ black belt\nFalse\nNone False\n");
+    }
+
+    void TestArithmetics() {
+        istringstream input("print 1+2+3+4+5, 1*2*3*4*5, 1-2-3-4-5, 36/4/3, 2*5+10/2");
+
+        ostringstream output;
+        RunMythonProgram(input, output);
+
+        ASSERT_EQUAL(output.str(), "15 120 -13 3 15\n");
+    }
+
+    void TestVariablesArePointers() {
+        istringstream input(R"(
+class Counter:
+  def __init__():
+    self.value = 0
+
+  def add():
+    self.value = self.value + 1
+
+class Dummy:
+  def do_add(counter):
+    counter.add()
+
+x = Counter()
+y = x
+
+x.add()
+y.add()
+
+print x.value
+
+d = Dummy()
+d.do_add(x)
+
+print y.value
+)");
+
+        ostringstream output;
+        RunMythonProgram(input, output);
+
+        ASSERT_EQUAL(output.str(), "2\n3\n");
+    }
+
+    void TestAll() {
+        TestRunner tr;
+        parse::RunOpenLexerTests(tr);
+        runtime::RunObjectHolderTests(tr);
+        runtime::RunObjectsTests(tr);
+        runtime::RunInstrumentationTests(tr);
+        ast::RunUnitTests(tr);
+        TestParseProgram(tr);
+
+        RUN_TEST(tr, TestSimplePrints);
+        RUN_TEST(tr, TestAssignments);
+        RUN_TEST(tr, TestArithmetics);
+        RUN_TEST(tr, TestVariablesArePointers);
+    }
+
+    struct Options {
+        // Файл для вывода профиля в формате folded stacks. Пустая строка - профилирование выключено
+        string profile_path;
+        int profile_interval_us = 1000;
+        // Файл для вывода временной шкалы в формате Chrome trace-event. Пустая строка - запись выключена
+        string trace_path;
+        size_t trace_buffer = size_t{ 1 } << 20;
+        // Формат вывода счётчиков интерпретатора в stderr: "text" или "json". Пустая строка - не выводить
+        string stats_format;
+        // Заменять повторы выражений и методов ссылкой на первое вхождение (ParserOptions)
+        bool share_subtrees = false;
+        // Связывать вызовы методов с методом при разборе (ParserOptions)
+        bool bind_methods = false;
+        // Повторно использовать экземпляры, не покидающие вызов метода, из слотов кадров (ParserOptions)
+        bool frame_slots = false;
+        // Каталоги поиска модулей инструкции import
+        vector<filesystem::path> module_path{ "."s };
+        // Выводить в stderr перепись живых объектов при завершении и по сигналу SIGUSR2
+        bool heap_census = false;
+        // Выводить в stderr текст программы с количеством исполнений строк и самые горячие условия и вызовы
+        bool hotspots = false;
+        size_t hotspots_top = 10;
+        // Выводить стек вызовов по сигналу SIGUSR1 в файл stack_dump_path. Пустая строка - вывод в stderr
+        bool stack_dump = false;
+        string stack_dump_path;
+        // Порог длительности вызова в миллисекундах, начиная с которого вызов записывается
+        // в журнал медленных вызовов в stderr. Отрицательное значение - журнал выключен
+        double slow_call_ms = -1;
+        // Кэшировать результаты __str__ до изменения прочитанных им полей
+        bool cache_str = false;
+        // Вывести в stdout замечания статического анализа производительности вместо исполнения программы
+        bool perf_lint = false;
+        // Каталог кэша вывода программ. Пустая строка - кэш выключен
+        string output_cache_dir;
+        size_t output_cache_size = 1000;
+
+        // Включён инструмент, которому нужно исполнение программы
+        [[nodiscard]] bool HasTools() const {
+            return !profile_path.empty() || !trace_path.empty() || !stats_format.empty() || heap_census || hotspots
+                || slow_call_ms >= 0;
+        }
+    };
+
+    Options ParseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            string_view arg = argv[i];
+            auto value_of = [arg](string_view prefix) -> optional<string_view> {
+                if (arg.substr(0, prefix.size()) == prefix) {
+                    return arg.substr(prefix.size());
+                }
+                return nullopt;
+            };
+
+            if (auto value = value_of("--profile="sv)) {
+                options.profile_path = string(*value);
+            }
+            else if (auto value = value_of("--profile-interval="sv)) {
+                options.profile_interval_us = stoi(string(*value));
+            }
+            else if (auto value = value_of("--trace="sv)) {
+                options.trace_path = string(*value);
+            }
+            else if (auto value = value_of("--trace-buffer="sv)) {
+                options.trace_buffer = stoul(string(*value));
+            }
+            else if (arg == "--heap-census"sv) {
+                options.heap_census = true;
+            }
+            else if (arg == "--hotspots"sv) {
+                options.hotspots = true;
+            }
+            else if (auto value = value_of("--hotspots="sv)) {
+                options.hotspots = true;
+                options.hotspots_top = stoul(string(*value));
+            }
+            else if (arg == "--stack-dump"sv) {
+                options.stack_dump = true;
+            }
+            else if (auto value = value_of("--stack-dump="sv)) {
+                options.stack_dump = true;
+                options.stack_dump_path = string(*value);
+            }
+            else if (auto value = value_of("--slow-calls="sv)) {
+                options.slow_call_ms = stod(string(*value));
+            }
+            else if (arg == "--cache-str"sv) {
+                options.cache_str = true;
+            }
+            else if (auto value = value_of("--module-path="sv)) {
+                // Каталоги перечисляются через ':', как в PATH
+                options.module_path.clear();
+                while (!value->empty()) {
+                    const size_t end = min(value->find(':'), value->size());
+                    if (end > 0) {
+                        options.module_path.emplace_back(value->substr(0, end));
+                    }
+                    value->remove_prefix(min(end + 1, value->size()));
+                }
+            }
+            else if (arg == "--share-subtrees"sv) {
+                options.share_subtrees = true;
+            }
+            else if (arg == "--bind-methods"sv) {
+                options.bind_methods = true;
+            }
+            else if (arg == "--frame-slots"sv) {
+                options.frame_slots = true;
+            }
+            else if (arg == "--perf-lint"sv) {
+                options.perf_lint = true;
+            }
+            else if (auto value = value_of("--output-cache="sv)) {
+                options.output_cache_dir = string(*value);
+            }
+            else if (auto value = value_of("--output-cache-size="sv)) {
+                options.output_cache_size = stoul(string(*value));
+            }
+            else if (arg == "--stats"sv) {
+                options.stats_format = "text"s;
+            }
+            else if (auto value = value_of("--stats="sv)) {
+                if (*value != "text"sv && *value != "json"sv) {
+                    throw invalid_argument("Unknown stats format "s + string(*value));
+                }
+                options.stats_format = string(*value);
+            }
+            else {
+                throw invalid_argument("Unknown option "s + string(arg));
+            }
+        }
+        // Дамп стека и журнал медленных вызовов получают события исполнения (см. hooks.h)
+        if (!runtime::ExecutionHooks::ENABLED && (options.stack_dump || options.slow_call_ms >= 0)) {
+            throw invalid_argument("--stack-dump and --slow-calls= require a build with -DMYTHON_HOOKS"s);
+        }
+        return options;
+    }
+
+    ofstream OpenOutputFile(const string& path) {
+        ofstream out(path);
+        if (!out) {
+            throw runtime_error("Cannot open file "s + path);
+        }
+        return out;
+    }
+
+    // Отмечает фазу работы интерпретатора на временной шкале и в счётчиках
+    struct PhaseScope {
+        PhaseScope(runtime::Phase phase)
+            : trace(runtime::PhaseName(phase)), timer(phase) {
+        }
+
+        runtime::TraceRecorder::PhaseScope trace;
+        runtime::Stats::PhaseTimer timer;
+    };
+
+    unique_ptr<ast::Statement> LoadProgram(const string& source, const Options& options) {
+        istringstream input(source);
+        parse::Lexer lexer(input);
+        {
+            PhaseScope phase(runtime::Phase::LEX);
+            lexer.TokenizeAll();
+        }
+
+        PhaseScope phase(runtime::Phase::PARSE);
+        ParserOptions parser_options;
+        parser_options.share_identical_subtrees = options.share_subtrees;
+        parser_options.bind_static_methods = options.bind_methods;
+        parser_options.frame_slots = options.frame_slots;
+        parser_options.module_path = options.module_path;
+        return ParseProgram(lexer, parser_options);
+    }
+
+    // Инструменты анализа программы, включённые параметрами командной строки
+    class Tools {
+    public:
+        explicit Tools(const Options& options)
+            : options_(options) {
+            runtime::Stats::Reset();
+            if (options_.stack_dump && options_.stack_dump_path.empty()) {
+                runtime::StackDump::InstallSignalHandler(cerr);
+            }
+            else if (options_.stack_dump) {
+                stack_dump_out_ = OpenOutputFile(options_.stack_dump_path);
+                runtime::StackDump::InstallSignalHandler(stack_dump_out_);
+            }
+            if (!options_.trace_path.empty()) {
+                recorder_.emplace(options_.trace_buffer);
+                recorder_->Activate();
+            }
+            if (!options_.profile_path.empty()) {
+                profiler_.emplace(chrono::microseconds{ options_.profile_interval_us });
+            }
+            if (options_.heap_census) {
+                runtime::HeapCensus::Enable();
+                runtime::HeapCensus::InstallSignalHandler(cerr);
+            }
+            if (options_.hotspots) {
+                ast::HotSpots::Enable();
+            }
+            if (options_.slow_call_ms >= 0) {
+                runtime::SlowCallLog::Enable(chrono::duration_cast<chrono::nanoseconds>(
+                    chrono::duration<double, milli>(options_.slow_call_ms)), cerr);
+            }
+            if (options_.cache_str) {
+                runtime::StrCache::Enable();
+            }
+        }
+
+        void StartExecution() {
+            if (profiler_) {
+                profiler_->Start();
+            }
+        }
+
+        // Выводит отчёты инструментов. Отчёты ссылаются на классы программы,
+        // поэтому выводятся до разрушения дерева program, которое может отсутствовать
+        void WriteReports(ast::Statement* program, const string& source, const runtime::Closure& globals) {
+            if (profiler_) {
+                profiler_->Stop();
+                ofstream profile_out = OpenOutputFile(options_.profile_path);
+                profiler_->WriteFolded(profile_out);
+            }
+            if (options_.heap_census) {
+                runtime::HeapCensus::WriteReport(cerr, &globals);
+            }
+            if (options_.hotspots && program) {
+                ast::HotSpots::WriteReport(cerr, *program, source, options_.hotspots_top);
+            }
+            if (recorder_) {
+                recorder_->Deactivate();
+                ofstream trace_out = OpenOutputFile(options_.trace_path);
+                recorder_->WriteJson(trace_out);
+            }
+            if (options_.stats_format == "json"sv) {
+                runtime::Stats::WriteJson(cerr);
+            }
+            else if (!options_.stats_format.empty()) {
+                runtime::Stats::WriteText(cerr);
+            }
+        }
+
+    private:
+        const Options& options_;
+        optional<runtime::TraceRecorder> recorder_;
+        optional<runtime::SamplingProfiler> profiler_;
+        ofstream stack_dump_out_;
+    };
+
+    void RunMythonProgram(istream& input, ostream& output, const Options& options) {
+        const string source{ istreambuf_iterator<char>(input), istreambuf_iterator<char>() };
+
+        if (options.perf_lint) {
+            ast::WritePerfLintReport(output, ast::PerfLint(*LoadProgram(source, options)));
+            return;
+        }
+
+        // Инструменты анализа требуют исполнения, поэтому с ними кэш вывода не используется
+        optional<runtime::OutputCache> cache;
+        string cache_key;
+        if (!options.output_cache_dir.empty() && !options.HasTools()) {
+            cache.emplace(options.output_cache_dir, options.output_cache_size);
+            cache_key = runtime::OutputCache::MakeKey(source);
+            if (auto cached_output = cache->Lookup(cache_key, source)) {
+                output << *cached_output;
+                return;
+            }
+        }
+        runtime::RecordingStreamBuf recording(output.rdbuf());
+        ostream recorded_output(&recording);
+
+        Tools tools(options);
+        runtime::SimpleContext context{ cache ? recorded_output : output };
+        runtime::Closure closure;
+        unique_ptr<ast::Statement> program;
+        try {
+            program = LoadProgram(source, options);
+
+            PhaseScope phase(runtime::Phase::EXECUTE);
+            tools.StartExecution();
+            program->Execute(closure, context);
+        }
+        catch (...) {
+            tools.WriteReports(program.get(), source, closure);
+            throw;
+        }
+        tools.WriteReports(program.get(), source, closure);
+        // Вывод программы, завершившейся ошибкой, не сохраняется: сообщение об ошибке не входит в него
+        if (cache && runtime::OutputCache::IsCacheable(*program) && runtime::OutputCache::IsOutputReproducible()) {
+            cache->Store(cache_key, source, recording.GetRecorded());
+        }
+    }
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+
+        TestAll();
+
+        RunMythonProgram(cin, cout, options);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "module_cache.h"
+
+#include "lexer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace parse {
+
+    namespace {
+        constexpr string_view MODULE_EXTENSION = ".my"sv;
+
+        fs::path FindModule(const string& name, const vector<fs::path>& module_path) {
+            for (const fs::path& directory : module_path) {
+                fs::path path = directory / (name + string(MODULE_EXTENSION));
+                error_code error;
+                if (fs::is_regular_file(path, error)) {
+                    return fs::weakly_canonical(path);
+                }
+            }
+            throw ParseError("Module "s + name + " not found"s);
+        }
+
+        // Файлы модуля не изменились после разбора
+        bool IsUpToDate(const Module& module) {
+            return all_of(module.files.begin(), module.files.end(), [](const auto& file) {
+                error_code error;
+                return fs::last_write_time(file.first, error) == file.second && !error;
+            });
+        }
+
+        // Ключ модуля в кэше: путь к файлу и параметры разбора, от которых зависит дерево модуля
+        string MakeKey(const fs::path& path, const ParserOptions& options) {
+            string key = path.string();
+            key += options.share_identical_subtrees ? "\n1"s : "\n0"s;
+            for (const fs::path& directory : options.module_path) {
+                key += '\n';
+                key += directory.string();
+            }
+            return key;
+        }
+
+        // Удаляет путь модуля из списка разбираемых при выходе из области видимости
+        class LoadingGuard {
+        public:
+            explicit LoadingGuard(vector<string>& loading)
+                : loading_(loading) {
+            }
+
+            LoadingGuard(const LoadingGuard&) = delete;
+            LoadingGuard& operator=(const LoadingGuard&) = delete;
+
+            ~LoadingGuard() {
+                loading_.pop_back();
+            }
+
+        private:
+            vector<string>& loading_;
+        };
+    }  // namespace
+
+    shared_ptr<const Module> ModuleCache::Load(const string& name, const ParserOptions& options) {
+        const fs::path path = FindModule(name, options.module_path);
+        const string key = MakeKey(path, options);
+        if (auto it = modules_.find(key); it != modules_.end() && IsUpToDate(*it->second)) {
+            ++runtime::Stats::Get().module_cache_hits;
+            return it->second;
+        }
+        if (find(loading_.begin(), loading_.end(), path.string()) != loading_.end()) {
+            throw ParseError("Module "s + name + " imports itself"s);
+        }
+        loading_.push_back(path.string());
+        LoadingGuard guard(loading_);
+
+        auto module = make_shared<Module>();
+        module->name = name;
+        // Время изменения запоминается до чтения, чтобы изменение во время разбора обнаружилось
+        module->files.emplace_back(path, fs::last_write_time(path));
+        ifstream input(path);
+        if (!input) {
+            throw ParseError("Cannot read module "s + name);
+        }
+        try {
+            Lexer lexer(input);
+            // Классы модуля может унаследовать импортирующая программа, поэтому вызовы в модуле не связываются.
+            // Слоты кадров хранили бы экземпляры одной программы в дереве, общем для всех
+            ParserOptions module_options = options;
+            module_options.bind_static_methods = false;
+            module_options.frame_slots = false;
+            module->tree = ParseProgram(lexer, module_options);
+        }
+        catch (const exception& e) {
+            throw ParseError("Module "s + name + ": "s + e.what());
+        }
+        module->tree->ForEachChild([&module](ast::Statement& statement) {
+            if (const auto* definition = dynamic_cast<const ast::ClassDefinition*>(&statement)) {
+                module->classes.push_back(definition->GetClassHolder());
+            }
+            else if (const auto* import = dynamic_cast<const ast::Import*>(&statement)) {
+                const auto& files = import->GetModule().files;
+                module->files.insert(module->files.end(), files.begin(), files.end());
+            }
+            else {
+                throw ParseError("Module "s + module->name + " may contain only classes and imports"s);
+            }
+        });
+        ++runtime::Stats::Get().modules_parsed;
+        modules_[key] = module;
+        return module;
+    }
+
+    void ModuleCache::Clear() {
+        modules_.clear();
+    }
+
+}  // namespace parse
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "parse.h"
+#include "statement.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace parse {
+
+    // Разобранный модуль Mython - файл, содержащий только определения классов и инструкции import
+    struct Module {
+        std::string name;
+        // Файлы модуля и импортированных им модулей со временем изменения, которое они имели при разборе
+        std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> files;
+        // Дерево модуля. Владеет классами модуля и через инструкции import - импортированными модулями
+        std::unique_ptr<ast::Statement> tree;
+        // Классы, определённые в модуле, в порядке определения
+        std::vector<runtime::ObjectHolder> classes;
+    };
+
+    /*
+     * Кэш модулей процесса. Модуль name ищется в каталогах ParserOptions::module_path как файл name.my.
+     * Модуль разбирается один раз для каждого набора параметров разбора, влияющих на его дерево
+     * (share_identical_subtrees, module_path): пока не изменилось время изменения его файла и файлов модулей,
+     * которые он импортирует, все программы процесса с теми же параметрами получают один и тот же
+     * разобранный модуль. Программы владеют полученными модулями, поэтому замена модуля в кэше их не затрагивает.
+     *
+     * Дерево модуля общее для программ, поэтому в нём не включаются слоты кадров и не связываются вызовы
+     * методов. Ячейки, запомненные узлами при исполнении другой программой, не сбрасываются: поколения
+     * таблиц Closure глобально уникальны, поэтому такая ячейка не совпадёт ни с одной таблицей новой программы.
+     * Счётчики исполнения узлов модуля накапливаются по всем программам
+     */
+    class ModuleCache {
+    public:
+        // Возвращает модуль name. Выбрасывает ParseError, если модуль не найден, содержит ошибку,
+        // инструкции кроме определений классов и import или импортирует сам себя
+        [[nodiscard]] static std::shared_ptr<const Module> Load(const std::string& name, const ParserOptions& options);
+
+        // Удаляет все модули из кэша
+        static void Clear();
+
+    private:
+        // Модули по пути к файлу и параметрам разбора
+        inline static std::unordered_map<std::string, std::shared_ptr<const Module>> modules_;
+        // Пути модулей, которые разбираются сейчас
+        inline static std::vector<std::string> loading_;
+    };
+
+}  // namespace parse
@@ -0,0 +1,161 @@
+#include "output_cache.h"
+
+#include "statement.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace runtime {
+
+    namespace {
+        // Меняется, когда меняется вывод интерпретатора для тех же программ
+        constexpr string_view CACHE_FORMAT = "mython-output-2\n"sv;
+        constexpr string_view ENTRY_EXTENSION = ".out"sv;
+
+        // Хэш FNV-1a
+        uint64_t Hash(string_view data, uint64_t hash = 14695981039346656037ull) {
+            for (const char ch : data) {
+                hash ^= static_cast<unsigned char>(ch);
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        // Вывод зависит не только от текста программы: от часов или от файлов импортированных модулей
+        bool IsNondeterministic(ast::Statement& node) {
+            return dynamic_cast<ast::ClockNs*>(&node) != nullptr
+                || dynamic_cast<ast::TimerStart*>(&node) != nullptr
+                || dynamic_cast<ast::TimerStop*>(&node) != nullptr
+                || dynamic_cast<ast::Import*>(&node) != nullptr;
+        }
+    }  // namespace
+
+    OutputCache::OutputCache(fs::path directory, size_t capacity)
+        : directory_(move(directory)), capacity_(capacity) {
+        fs::create_directories(directory_);
+    }
+
+    string OutputCache::MakeKey(string_view source) {
+        ostringstream key;
+        key << hex << setw(16) << setfill('0') << Hash(source, Hash(CACHE_FORMAT)) << dec << '-' << source.size();
+        return key.str();
+    }
+
+    bool OutputCache::IsCacheable(ast::Statement& program) {
+        bool cacheable = true;
+        function<void(ast::Statement&)> visit = [&cacheable, &visit](ast::Statement& node) {
+            if (cacheable && IsNondeterministic(node)) {
+                cacheable = false;
+            }
+            if (cacheable) {
+                node.ForEachChild(visit);
+            }
+        };
+        visit(program);
+        return cacheable;
+    }
+
+    bool OutputCache::IsOutputReproducible() {
+        return Stats::Get().addresses_printed == 0;
+    }
+
+    optional<string> OutputCache::Lookup(const string& key, string_view source) const {
+        const fs::path path = EntryPath(key);
+        ifstream in(path, ios::binary);
+        if (!in) {
+            return nullopt;
+        }
+        // Запись: длина текста программы, перевод строки, текст программы, вывод
+        size_t source_size = 0;
+        if (!(in >> source_size) || in.get() != '\n' || source_size != source.size()) {
+            return nullopt;
+        }
+        string stored_source(source_size, '\0');
+        if (!in.read(stored_source.data(), static_cast<streamsize>(source_size)) || stored_source != source) {
+            // Другая программа с тем же хэшем
+            return nullopt;
+        }
+        string output{ istreambuf_iterator<char>(in), istreambuf_iterator<char>() };
+        if (in.bad()) {
+            return nullopt;
+        }
+        // Запись использована последней
+        error_code ignored;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), ignored);
+        return output;
+    }
+
+    void OutputCache::Store(const string& key, string_view source, string_view output) const {
+        const fs::path path = EntryPath(key);
+        // Запись создаётся под временным именем и переименовывается, чтобы параллельный запуск
+        // той же программы не прочитал её недописанной
+        fs::path temporary = path;
+        temporary += ".tmp"s + to_string(getpid());
+        {
+            ofstream out(temporary, ios::binary | ios::trunc);
+            out << source.size() << '\n';
+            out.write(source.data(), static_cast<streamsize>(source.size()));
+            out.write(output.data(), static_cast<streamsize>(output.size()));
+            if (!out.flush()) {
+                error_code ignored;
+                fs::remove(temporary, ignored);
+                throw runtime_error("Cannot write output cache entry "s + temporary.string());
+            }
+        }
+        fs::rename(temporary, path);
+        Evict();
+    }
+
+    fs::path OutputCache::EntryPath(const string& key) const {
+        return directory_ / (key + string(ENTRY_EXTENSION));
+    }
+
+    void OutputCache::Evict() const {
+        vector<pair<fs::file_time_type, fs::path>> entries;
+        for (const fs::directory_entry& entry : fs::directory_iterator(directory_)) {
+            if (entry.is_regular_file() && entry.path().extension() == ENTRY_EXTENSION) {
+                entries.emplace_back(entry.last_write_time(), entry.path());
+            }
+        }
+        if (entries.size() <= capacity_) {
+            return;
+        }
+        const auto excess = static_cast<ptrdiff_t>(entries.size() - capacity_);
+        nth_element(entries.begin(), entries.begin() + excess - 1, entries.end());
+        for (auto it = entries.begin(); it != entries.begin() + excess; ++it) {
+            // Запись могла удалить другая копия интерпретатора
+            error_code ignored;
+            fs::remove(it->second, ignored);
+        }
+    }
+
+    RecordingStreamBuf::int_type RecordingStreamBuf::overflow(int_type ch) {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) {
+            return traits_type::not_eof(ch);
+        }
+        recorded_.push_back(traits_type::to_char_type(ch));
+        return target_->sputc(traits_type::to_char_type(ch));
+    }
+
+    streamsize RecordingStreamBuf::xsputn(const char* data, streamsize count) {
+        recorded_.append(data, static_cast<size_t>(count));
+        return target_->sputn(data, count);
+    }
+
+    int RecordingStreamBuf::sync() {
+        return target_->pubsync();
+    }
+
+}  // namespace runtime
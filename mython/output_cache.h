@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace ast {
+    class Statement;
+}  // namespace ast
+
+namespace runtime {
+
+    /*
+     * Кэш вывода программ на диске. Программа Mython без clock_ns, таймеров и import выводит одно и то же
+     * при каждом исполнении, поэтому её вывод можно сохранить под ключом, вычисленным по тексту
+     * программы, и при повторном запуске вывести сохранённое, не исполняя программу.
+     *
+     * Каждая запись - отдельный файл каталога, хранящий текст программы и её вывод. Ключ - хэш текста,
+     * поэтому вывод выдаётся, только если сохранённый текст совпадает с текстом программы.
+     * Время изменения файла обновляется при каждом обращении к записи; когда записей становится больше
+     * capacity, удаляются давно не использованные.
+     */
+    class OutputCache {
+    public:
+        OutputCache(std::filesystem::path directory, size_t capacity);
+
+        // Возвращает ключ записи для программы с текстом source
+        [[nodiscard]] static std::string MakeKey(std::string_view source);
+
+        // Возвращает true, если вывод программы зависит только от её текста:
+        // программа не читает часы, не использует таймеры и не импортирует модули
+        [[nodiscard]] static bool IsCacheable(ast::Statement& program);
+
+        // Возвращает true, если исполненная программа не выводила адреса экземпляров классов без __str__:
+        // адреса меняются от запуска к запуску, поэтому такой вывод не сохраняется.
+        // Учитывается вывод с последнего Stats::Reset
+        [[nodiscard]] static bool IsOutputReproducible();
+
+        // Возвращает сохранённый вывод программы с текстом source и ключом key
+        [[nodiscard]] std::optional<std::string> Lookup(const std::string& key, std::string_view source) const;
+
+        // Сохраняет вывод программы с текстом source и ключом key и удаляет лишние записи
+        void Store(const std::string& key, std::string_view source, std::string_view output) const;
+
+    private:
+        [[nodiscard]] std::filesystem::path EntryPath(const std::string& key) const;
+        void Evict() const;
+
+        std::filesystem::path directory_;
+        size_t capacity_;
+    };
+
+    // Буфер потока, передающий вывод в буфер target и запоминающий его
+    class RecordingStreamBuf : public std::streambuf {
+    public:
+        explicit RecordingStreamBuf(std::streambuf* target)
+            : target_(target) {
+        }
+
+        [[nodiscard]] const std::string& GetRecorded() const {
+            return recorded_;
+        }
+
+    protected:
+        int_type overflow(int_type ch) override;
+        std::streamsize xsputn(const char* data, std::streamsize count) override;
+        int sync() override;
+
+    private:
+        std::streambuf* target_;
+        std::string recorded_;
+    };
+
+}  // namespace runtime
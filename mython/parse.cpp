@@ -1,450 +1,679 @@
-#include "parse.h"
-
-#include "lexer.h"
-#include "statement.h"
-
-using namespace std;
-
-namespace TokenType = parse::token_type;
-
-namespace {
-    bool operator==(const parse::Token& token, char c) {
-        const auto* p = token.TryAs<TokenType::Char>();
-        return p != nullptr && p->value == c;
-    }
-
-    bool operator!=(const parse::Token& token, char c) {
-        return !(token == c);
-    }
-
-    class Parser {
-    public:
-        explicit Parser(parse::Lexer& lexer)
-            : lexer_(lexer) {
-        }
-
-        // Program -> eps
-        //          | Statement \n Program
-        unique_ptr<ast::Statement> ParseProgram() {
-            auto result = make_unique<ast::Compound>();
-            while (!lexer_.CurrentToken().Is<TokenType::Eof>()) {
-                result->AddStatement(ParseStatement());
-            }
-
-            return result;
-        }
-
-    private:
-        // Suite -> NEWLINE INDENT (Statement)+ DEDENT
-        unique_ptr<ast::Statement> ParseSuite()  // NOLINT
-        {
-            lexer_.Expect<TokenType::Newline>();
-            lexer_.ExpectNext<TokenType::Indent>();
-
-            lexer_.NextToken();
-
-            auto result = make_unique<ast::Compound>();
-            while (!lexer_.CurrentToken().Is<TokenType::Dedent>()) {
-                result->AddStatement(ParseStatement());  // NOLINT
-            }
-
-            lexer_.Expect<TokenType::Dedent>();
-            lexer_.NextToken();
-
-            return result;
-        }
-
-        // Methods -> [def id(Params) : Suite]*
-        vector<runtime::Method> ParseMethods()  // NOLINT
-        {
-            vector<runtime::Method> result;
-
-            while (lexer_.CurrentToken().Is<TokenType::Def>()) {
-                runtime::Method m;
-
-                m.name = lexer_.ExpectNext<TokenType::Id>().value;
-                lexer_.ExpectNext<TokenType::Char>('(');
-
-                if (lexer_.NextToken().Is<TokenType::Id>()) {
-                    m.formal_params.push_back(lexer_.Expect<TokenType::Id>().value);
-                    while (lexer_.NextToken() == ',') {
-                        m.formal_params.push_back(lexer_.ExpectNext<TokenType::Id>().value);
-                    }
-                }
-
-                lexer_.Expect<TokenType::Char>(')');
-                lexer_.ExpectNext<TokenType::Char>(':');
-                lexer_.NextToken();
-
-                m.body = std::make_unique<ast::MethodBody>(ParseSuite());  // NOLINT
-
-                result.push_back(std::move(m));
-            }
-            return result;
-        }
-
-        // ClassDefinition -> Id ['(' Id ')'] : new_line indent MethodList dedent
-        unique_ptr<ast::Statement> ParseClassDefinition()  // NOLINT
-        {
-            string class_name = lexer_.Expect<TokenType::Id>().value;
-
-            lexer_.NextToken();
-
-            const runtime::Class* base_class = nullptr;
-            if (lexer_.CurrentToken() == '(') {
-                auto name = lexer_.ExpectNext<TokenType::Id>().value;
-                lexer_.ExpectNext<TokenType::Char>(')');
-                lexer_.NextToken();
-
-                auto it = declared_classes_.find(name);
-                if (it == declared_classes_.end()) {
-                    throw ParseError("Base class "s + name + " not found for class "s + class_name);
-                }
-                base_class = static_cast<const runtime::Class*>(it->second.Get());  // NOLINT
-            }
-
-            lexer_.Expect<TokenType::Char>(':');
-            lexer_.ExpectNext<TokenType::Newline>();
-            lexer_.ExpectNext<TokenType::Indent>();
-            lexer_.ExpectNext<TokenType::Def>();
-            vector<runtime::Method> methods = ParseMethods();  // NOLINT
-
-            lexer_.Expect<TokenType::Dedent>();
-            lexer_.NextToken();
-
-            auto [it, inserted] = declared_classes_.insert({
-                class_name,
-                runtime::ObjectHolder::Own(runtime::Class(class_name, std::move(methods), base_class)),
-                });
-
-            if (!inserted) {
-                throw ParseError("Class "s + class_name + " already exists"s);
-            }
-
-            return make_unique<ast::ClassDefinition>(it->second);
-        }
-
-        vector<string> ParseDottedIds() {
-            vector<string> result(1, lexer_.Expect<TokenType::Id>().value);
-
-            while (lexer_.NextToken() == '.') {
-                result.push_back(lexer_.ExpectNext<TokenType::Id>().value);
-            }
-
-            return result;
-        }
-
-        //  AssgnOrCall -> DottedIds = Expr
-        //               | DottedIds '(' ExprList ')'
-        unique_ptr<ast::Statement> ParseAssignmentOrCall() {
-            lexer_.Expect<TokenType::Id>();
-
-            vector<string> id_list = ParseDottedIds();
-            string last_name = id_list.back();
-            id_list.pop_back();
-
-            if (lexer_.CurrentToken() == '=') {
-                lexer_.NextToken();
-
-                if (id_list.empty()) {
-                    return make_unique<ast::Assignment>(std::move(last_name), ParseTest());
-                }
-                return make_unique<ast::FieldAssignment>(ast::VariableValue{ std::move(id_list) },
-                    std::move(last_name), ParseTest());
-            }
-            lexer_.Expect<TokenType::Char>('(');
-            lexer_.NextToken();
-
-            if (id_list.empty()) {
-                throw ParseError("Mython doesn't support functions, only methods: "s + last_name);
-            }
-
-            vector<unique_ptr<ast::Statement>> args;
-            if (lexer_.CurrentToken() != ')') {
-                args = ParseTestList();
-            }
-            lexer_.Expect<TokenType::Char>(')');
-            lexer_.NextToken();
-
-            return make_unique<ast::MethodCall>(make_unique<ast::VariableValue>(std::move(id_list)),
-                std::move(last_name), std::move(args));
-        }
-
-        // Expr -> Adder ['+'/'-' Adder]*
-        unique_ptr<ast::Statement> ParseExpression()  // NOLINT
-        {
-            unique_ptr<ast::Statement> result = ParseAdder();
-            while (lexer_.CurrentToken() == '+' || lexer_.CurrentToken() == '-') {
-                char op = lexer_.CurrentToken().As<TokenType::Char>().value;
-                lexer_.NextToken();
-
-                if (op == '+') {
-                    result = make_unique<ast::Add>(std::move(result), ParseAdder());
-                }
-                else {
-                    result = make_unique<ast::Sub>(std::move(result), ParseAdder());
-                }
-            }
-            return result;
-        }
-
-        // Adder -> Mult ['*'/'/' Mult]*
-        unique_ptr<ast::Statement> ParseAdder()  // NOLINT
-        {
-            unique_ptr<ast::Statement> result = ParseMult();
-            while (lexer_.CurrentToken() == '*' || lexer_.CurrentToken() == '/') {
-                char op = lexer_.CurrentToken().As<TokenType::Char>().value;
-                lexer_.NextToken();
-
-                if (op == '*') {
-                    result = make_unique<ast::Mult>(std::move(result), ParseMult());
-                }
-                else {
-                    result = make_unique<ast::Div>(std::move(result), ParseMult());
-                }
-            }
-            return result;
-        }
-
-        // Mult -> '(' Expr ')'
-        //       | NUMBER
-        //       | '-' Mult
-        //       | STRING
-        //       | NONE
-        //       | TRUE
-        //       | FALSE
-        //       | DottedIds '(' ExprList ')'
-        //       | DottedIds
-        unique_ptr<ast::Statement> ParseMult()  // NOLINT
-        {
-            if (lexer_.CurrentToken() == '(') {
-                lexer_.NextToken();
-                auto result = ParseTest();
-                lexer_.Expect<TokenType::Char>(')');
-                lexer_.NextToken();
-                return result;
-            }
-            if (lexer_.CurrentToken() == '-') {
-                lexer_.NextToken();
-                return make_unique<ast::Mult>(ParseMult(), make_unique<ast::NumericConst>(-1));
-            }
-            if (const auto* num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
-                int result = num->value;
-                lexer_.NextToken();
-                return make_unique<ast::NumericConst>(result);
-            }
-            if (const auto* str = lexer_.CurrentToken().TryAs<TokenType::String>()) {
-                string result = str->value;
-                lexer_.NextToken();
-                return make_unique<ast::StringConst>(std::move(result));
-            }
-            if (lexer_.CurrentToken().Is<TokenType::True>()) {
-                lexer_.NextToken();
-                return make_unique<ast::BoolConst>(runtime::Bool(true));
-            }
-            if (lexer_.CurrentToken().Is<TokenType::False>()) {
-                lexer_.NextToken();
-                return make_unique<ast::BoolConst>(runtime::Bool(false));
-            }
-            if (lexer_.CurrentToken().Is<TokenType::None>()) {
-                lexer_.NextToken();
-                return make_unique<ast::None>();
-            }
-
-            return ParseDottedIdsInMultExpr();
-        }
-
-        std::unique_ptr<ast::Statement> ParseDottedIdsInMultExpr() {
-            vector<string> names = ParseDottedIds();
-
-            if (lexer_.CurrentToken() == '(') {
-                // various calls
-                vector<unique_ptr<ast::Statement>> args;
-                if (lexer_.NextToken() != ')') {
-                    args = ParseTestList();
-                }
-                lexer_.Expect<TokenType::Char>(')');
-                lexer_.NextToken();
-
-                auto method_name = names.back();
-                names.pop_back();
-
-                if (!names.empty()) {
-                    return make_unique<ast::MethodCall>(
-                        make_unique<ast::VariableValue>(std::move(names)), std::move(method_name),
-                        std::move(args));
-                }
-                if (auto it = declared_classes_.find(method_name); it != declared_classes_.end()) {
-                    return make_unique<ast::NewInstance>(
-                        static_cast<const runtime::Class&>(*it->second), std::move(args));  // NOLINT
-                }
-                if (method_name == "str"sv) {
-                    if (args.size() != 1) {
-                        throw ParseError("Function str takes exactly one argument"s);
-                    }
-                    return make_unique<ast::Stringify>(std::move(args.front()));
-                }
-                throw ParseError("Unknown call to "s + method_name + "()"s);
-            }
-            return make_unique<ast::VariableValue>(std::move(names));
-        }
-
-        vector<unique_ptr<ast::Statement>> ParseTestList()  // NOLINT
-        {
-            vector<unique_ptr<ast::Statement>> result;
-            result.push_back(ParseTest());
-
-            while (lexer_.CurrentToken() == ',') {
-                lexer_.NextToken();
-                result.push_back(ParseTest());
-            }
-            return result;
-        }
-
-        // Condition -> if LogicalExpr: Suite [else: Suite]
-        unique_ptr<ast::Statement> ParseCondition()  // NOLINT
-        {
-            lexer_.Expect<TokenType::If>();
-            lexer_.NextToken();
-
-            auto condition = ParseTest();
-
-            lexer_.Expect<TokenType::Char>(':');
-            lexer_.NextToken();
-
-            auto if_body = ParseSuite();
-
-            unique_ptr<ast::Statement> else_body;
-            if (lexer_.CurrentToken().Is<TokenType::Else>()) {
-                lexer_.ExpectNext<TokenType::Char>(':');
-                lexer_.NextToken();
-                else_body = ParseSuite();
-            }
-
-            return make_unique<ast::IfElse>(std::move(condition), std::move(if_body),
-                std::move(else_body));
-        }
-
-        // LogicalExpr -> AndTest [OR AndTest]
-        // AndTest -> NotTest [AND NotTest]
-        // NotTest -> [NOT] NotTest
-        //          | Comparison
-        unique_ptr<ast::Statement> ParseTest()  // NOLINT
-        {
-            auto result = ParseAndTest();
-            while (lexer_.CurrentToken().Is<TokenType::Or>()) {
-                lexer_.NextToken();
-                result = make_unique<ast::Or>(std::move(result), ParseAndTest());
-            }
-            return result;
-        }
-
-        unique_ptr<ast::Statement> ParseAndTest()  // NOLINT
-        {
-            auto result = ParseNotTest();
-            while (lexer_.CurrentToken().Is<TokenType::And>()) {
-                lexer_.NextToken();
-                result = make_unique<ast::And>(std::move(result), ParseNotTest());
-            }
-            return result;
-        }
-
-        unique_ptr<ast::Statement> ParseNotTest()  // NOLINT
-        {
-            if (lexer_.CurrentToken().Is<TokenType::Not>()) {
-                lexer_.NextToken();
-                return make_unique<ast::Not>(ParseNotTest());  // NOLINT
-            }
-            return ParseComparison();
-        }
-
-        // Comparison -> Expr [COMP_OP Expr]
-        unique_ptr<ast::Statement> ParseComparison()  // NOLINT
-        {
-            auto result = ParseExpression();
-
-            const auto tok = lexer_.CurrentToken();
-
-            if (tok == '<') {
-                lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::Less, std::move(result),
-                    ParseExpression());
-            }
-            if (tok == '>') {
-                lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::Greater, std::move(result),
-                    ParseExpression());
-            }
-            if (tok.Is<TokenType::Eq>()) {
-                lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::Equal, std::move(result),
-                    ParseExpression());
-            }
-            if (tok.Is<TokenType::NotEq>()) {
-                lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::NotEqual, std::move(result),
-                    ParseExpression());
-            }
-            if (tok.Is<TokenType::LessOrEq>()) {
-                lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::LessOrEqual, std::move(result),
-                    ParseExpression());
-            }
-            if (tok.Is<TokenType::GreaterOrEq>()) {
-                lexer_.NextToken();
-                return make_unique<ast::Comparison>(runtime::GreaterOrEqual, std::move(result),
-                    ParseExpression());
-            }
-            return result;
-        }
-
-        // Statement -> SimpleStatement Newline
-        //           | class ClassDefinition
-        //           | if Condition
-        unique_ptr<ast::Statement> ParseStatement()  // NOLINT
-        {
-            const auto& tok = lexer_.CurrentToken();
-
-            if (tok.Is<TokenType::Class>()) {
-                lexer_.NextToken();
-                return ParseClassDefinition();  // NOLINT
-            }
-            if (tok.Is<TokenType::If>()) {
-                return ParseCondition();
-            }
-            auto result = ParseSimpleStatement();
-            lexer_.Expect<TokenType::Newline>();
-            lexer_.NextToken();
-            return result;
-        }
-
-        // StatementBody -> return Expression
-        //               | print ExpressionList
-        //               | AssignmentOrCall
-        unique_ptr<ast::Statement> ParseSimpleStatement() {
-            const auto& tok = lexer_.CurrentToken();
-
-            if (tok.Is<TokenType::Return>()) {
-                lexer_.NextToken();
-                return make_unique<ast::Return>(ParseTest());
-            }
-            if (tok.Is<TokenType::Print>()) {
-                lexer_.NextToken();
-                vector<unique_ptr<ast::Statement>> args;
-                if (!lexer_.CurrentToken().Is<TokenType::Newline>()) {
-                    args = ParseTestList();
-                }
-                return make_unique<ast::Print>(std::move(args));
-            }
-            return ParseAssignmentOrCall();
-        }
-
-        parse::Lexer& lexer_;
-        runtime::Closure declared_classes_;
-    };
-
-}  // namespace
-
-unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer) {
-    return Parser{ lexer }.ParseProgram();
+#include "parse.h"
+
+#include "class_hierarchy.h"
+#include "escape_analysis.h"
+#include "lexer.h"
+#include "module_cache.h"
+#include "statement.h"
+
+#include <sstream>
+#include <unordered_map>
+
+using namespace std;
+
+namespace TokenType = parse::token_type;
+
+namespace {
+    bool operator==(const parse::Token& token, char c) {
+        const auto* p = token.TryAs<TokenType::Char>();
+        return p != nullptr && p->value == c;
+    }
+
+    bool operator!=(const parse::Token& token, char c) {
+        return !(token == c);
+    }
+
+    // Узлы поддерева не хранят изменяемого состояния, от которого зависит результат, поэтому поддерево
+    // можно исполнять из нескольких мест программы. Операции над объектами классов могут вызывать
+    // __eq__, __lt__, __add__ и другие методы: узел лишь передаёт им значения, как и при каждом исполнении.
+    // Ячейки VariableValue проверяются по поколению таблицы и в состояние не входят
+    bool HasNoNodeState(ast::Statement& node) {
+        bool result = true;
+        ast::ForEachNode(node, [&result](ast::Statement& child) {
+            result = result && (dynamic_cast<ast::NumericConst*>(&child) || dynamic_cast<ast::StringConst*>(&child)
+                || dynamic_cast<ast::BoolConst*>(&child) || dynamic_cast<ast::None*>(&child)
+                || dynamic_cast<ast::VariableValue*>(&child) || dynamic_cast<ast::BinaryOperation*>(&child)
+                || dynamic_cast<ast::FusedArithmetic*>(&child) || dynamic_cast<ast::Not*>(&child)
+                || dynamic_cast<ast::SharedNode*>(&child));
+        });
+        return result;
+    }
+
+    class Parser {
+    public:
+        Parser(parse::Lexer& lexer, const ParserOptions& options)
+            : lexer_(lexer), options_(options) {
+        }
+
+        // Program -> eps
+        //          | Statement \n Program
+        unique_ptr<ast::Statement> ParseProgram() {
+            auto result = MakeNode<ast::Compound>();
+            while (!lexer_.CurrentToken().Is<TokenType::Eof>()) {
+                result->AddStatement(ParseStatement());
+            }
+            // Иерархия классов известна только после разбора всей программы
+            if (options_.bind_static_methods) {
+                ast::BindStaticMethodCalls(*result, declared_classes_);
+            }
+
+            return result;
+        }
+
+    private:
+        // Наибольшая глубина вложенности выражений и блоков. Более глубокое дерево
+        // переполнило бы стек при разборе, исполнении или разрушении
+        static constexpr size_t MAX_NESTING = 3000;
+        // Более короткие выражения дешевле повторить, чем заменить ссылкой
+        static constexpr size_t MIN_SHARED_TOKENS = 3;
+
+        // Учитывает уровни вложенности, добавленные за время своей жизни
+        class NestingGuard {
+        public:
+            explicit NestingGuard(Parser& parser)
+                : parser_(parser) {
+            }
+
+            NestingGuard(const NestingGuard&) = delete;
+            NestingGuard& operator=(const NestingGuard&) = delete;
+
+            ~NestingGuard() {
+                parser_.nesting_ -= levels_;
+            }
+
+            // Добавляет уровень вложенности: скобки, унарную операцию, блок
+            // или очередной операнд цепочки вида a + b + c
+            void Enter() {
+                ++levels_;
+                if (++parser_.nesting_ > MAX_NESTING) {
+                    throw ParseError("Program is nested too deeply"s);
+                }
+            }
+
+        private:
+            Parser& parser_;
+            size_t levels_ = 0;
+        };
+
+        // Создаёт узел дерева, помечая его строкой текущего токена
+        template <typename Node, typename... Args>
+        unique_ptr<Node> MakeNode(Args&&... args) {
+            auto node = make_unique<Node>(std::forward<Args>(args)...);
+            node->SetLine(lexer_.CurrentLine());
+            return node;
+        }
+
+        // Suite -> NEWLINE INDENT (Statement)+ DEDENT
+        unique_ptr<ast::Statement> ParseSuite()  // NOLINT
+        {
+            NestingGuard nesting(*this);
+            nesting.Enter();
+            lexer_.Expect<TokenType::Newline>();
+            lexer_.ExpectNext<TokenType::Indent>();
+
+            lexer_.NextToken();
+
+            auto result = MakeNode<ast::Compound>();
+            while (!lexer_.CurrentToken().Is<TokenType::Dedent>()) {
+                result->AddStatement(ParseStatement());  // NOLINT
+            }
+
+            lexer_.Expect<TokenType::Dedent>();
+            lexer_.NextToken();
+
+            return result;
+        }
+
+        // Methods -> [def id(Params) : Suite]*
+        vector<runtime::Method> ParseMethods()  // NOLINT
+        {
+            vector<runtime::Method> result;
+
+            while (lexer_.CurrentToken().Is<TokenType::Def>()) {
+                runtime::Method m;
+
+                m.name = lexer_.ExpectNext<TokenType::Id>().value;
+                lexer_.ExpectNext<TokenType::Char>('(');
+                // Текст метода без имени: параметры и тело
+                const size_t first_token = lexer_.CurrentTokenIndex();
+                const size_t bytes = ast::Statement::GetLiveBytes();
+
+                if (lexer_.NextToken().Is<TokenType::Id>()) {
+                    m.formal_params.push_back(lexer_.Expect<TokenType::Id>().value);
+                    while (lexer_.NextToken() == ',') {
+                        m.formal_params.push_back(lexer_.ExpectNext<TokenType::Id>().value);
+                    }
+                }
+
+                lexer_.Expect<TokenType::Char>(')');
+                lexer_.ExpectNext<TokenType::Char>(':');
+                size_t line = lexer_.CurrentLine();
+                lexer_.NextToken();
+
+                auto body = make_unique<ast::MethodBody>(ParseSuite());  // NOLINT
+                body->SetLine(line);
+                ast::Statement* shared = options_.share_identical_subtrees
+                    ? FindSharedSubtree(shared_methods_, first_token, *body) : nullptr;
+                if (shared != nullptr) {
+                    m.body = ReplaceWithShared(*shared, bytes, line);
+                }
+                else {
+                    if (options_.frame_slots) {
+                        ast::MarkNonEscapingInstances(*body, m.formal_params);
+                    }
+                    m.body = std::move(body);
+                }
+
+                result.push_back(std::move(m));
+            }
+            return result;
+        }
+
+        // ClassDefinition -> Id ['(' Id ')'] : new_line indent MethodList dedent
+        unique_ptr<ast::Statement> ParseClassDefinition()  // NOLINT
+        {
+            string class_name = lexer_.Expect<TokenType::Id>().value;
+            const size_t line = lexer_.CurrentLine();
+
+            lexer_.NextToken();
+
+            const runtime::Class* base_class = nullptr;
+            if (lexer_.CurrentToken() == '(') {
+                auto name = lexer_.ExpectNext<TokenType::Id>().value;
+                lexer_.ExpectNext<TokenType::Char>(')');
+                lexer_.NextToken();
+
+                auto it = declared_classes_.find(name);
+                if (it == declared_classes_.end()) {
+                    throw ParseError("Base class "s + name + " not found for class "s + class_name);
+                }
+                base_class = static_cast<const runtime::Class*>(it->second.Get());  // NOLINT
+            }
+
+            lexer_.Expect<TokenType::Char>(':');
+            lexer_.ExpectNext<TokenType::Newline>();
+            lexer_.ExpectNext<TokenType::Indent>();
+            lexer_.ExpectNext<TokenType::Def>();
+            vector<runtime::Method> methods = ParseMethods();  // NOLINT
+
+            lexer_.Expect<TokenType::Dedent>();
+            lexer_.NextToken();
+
+            runtime::HeapCensus::SetSite("ClassDefinition", line);
+            auto [it, inserted] = declared_classes_.insert({
+                class_name,
+                runtime::ObjectHolder::Own(runtime::Class(class_name, std::move(methods), base_class)),
+                });
+
+            if (!inserted) {
+                throw ParseError("Class "s + class_name + " already exists"s);
+            }
+
+            return MakeNode<ast::ClassDefinition>(it->second);
+        }
+
+        vector<string> ParseDottedIds() {
+            vector<string> result(1, lexer_.Expect<TokenType::Id>().value);
+
+            while (lexer_.NextToken() == '.') {
+                result.push_back(lexer_.ExpectNext<TokenType::Id>().value);
+            }
+
+            return result;
+        }
+
+        //  AssgnOrCall -> DottedIds = Expr
+        //               | DottedIds '(' ExprList ')'
+        unique_ptr<ast::Statement> ParseAssignmentOrCall() {
+            lexer_.Expect<TokenType::Id>();
+
+            vector<string> id_list = ParseDottedIds();
+            string last_name = id_list.back();
+            id_list.pop_back();
+
+            if (lexer_.CurrentToken() == '=') {
+                lexer_.NextToken();
+
+                if (id_list.empty()) {
+                    return MakeNode<ast::Assignment>(std::move(last_name), ParseTest());
+                }
+                return MakeNode<ast::FieldAssignment>(ast::VariableValue{ std::move(id_list) },
+                    std::move(last_name), ParseTest());
+            }
+            lexer_.Expect<TokenType::Char>('(');
+            lexer_.NextToken();
+
+            vector<unique_ptr<ast::Statement>> args;
+            if (lexer_.CurrentToken() != ')') {
+                args = ParseTestList();
+            }
+            lexer_.Expect<TokenType::Char>(')');
+            lexer_.NextToken();
+
+            if (id_list.empty()) {
+                if (auto builtin = ParseBuiltinCall(last_name, args)) {
+                    return builtin;
+                }
+                throw ParseError("Mython doesn't support functions, only methods: "s + last_name);
+            }
+
+            return MakeNode<ast::MethodCall>(MakeNode<ast::VariableValue>(std::move(id_list)),
+                std::move(last_name), std::move(args));
+        }
+
+        // Expr -> Adder ['+'/'-' Adder]*
+        unique_ptr<ast::Statement> ParseExpression()  // NOLINT
+        {
+            unique_ptr<ast::Statement> result = ParseAdder();
+            NestingGuard nesting(*this);
+            while (lexer_.CurrentToken() == '+' || lexer_.CurrentToken() == '-') {
+                nesting.Enter();
+                char op = lexer_.CurrentToken().As<TokenType::Char>().value;
+                lexer_.NextToken();
+
+                if (op == '+') {
+                    result = MakeNode<ast::Add>(std::move(result), ParseAdder());
+                }
+                else {
+                    result = MakeNode<ast::Sub>(std::move(result), ParseAdder());
+                }
+            }
+            return ast::FusedArithmetic::Fuse(std::move(result));
+        }
+
+        // Adder -> Mult ['*'/'/' Mult]*
+        unique_ptr<ast::Statement> ParseAdder()  // NOLINT
+        {
+            unique_ptr<ast::Statement> result = ParseMult();
+            NestingGuard nesting(*this);
+            while (lexer_.CurrentToken() == '*' || lexer_.CurrentToken() == '/') {
+                nesting.Enter();
+                char op = lexer_.CurrentToken().As<TokenType::Char>().value;
+                lexer_.NextToken();
+
+                if (op == '*') {
+                    result = MakeNode<ast::Mult>(std::move(result), ParseMult());
+                }
+                else {
+                    result = MakeNode<ast::Div>(std::move(result), ParseMult());
+                }
+            }
+            return result;
+        }
+
+        // Mult -> '(' Expr ')'
+        //       | NUMBER
+        //       | '-' Mult
+        //       | STRING
+        //       | NONE
+        //       | TRUE
+        //       | FALSE
+        //       | DottedIds '(' ExprList ')'
+        //       | DottedIds
+        unique_ptr<ast::Statement> ParseMult()  // NOLINT
+        {
+            NestingGuard nesting(*this);
+            if (lexer_.CurrentToken() == '(') {
+                nesting.Enter();
+                lexer_.NextToken();
+                auto result = ParseTest();
+                lexer_.Expect<TokenType::Char>(')');
+                lexer_.NextToken();
+                return result;
+            }
+            if (lexer_.CurrentToken() == '-') {
+                nesting.Enter();
+                lexer_.NextToken();
+                return MakeNode<ast::Mult>(ParseMult(), MakeNode<ast::NumericConst>(-1));
+            }
+            if (const auto* num = lexer_.CurrentToken().TryAs<TokenType::Number>()) {
+                int64_t result = num->value;
+                lexer_.NextToken();
+                return MakeNode<ast::NumericConst>(result);
+            }
+            if (const auto* str = lexer_.CurrentToken().TryAs<TokenType::String>()) {
+                string result = str->value;
+                lexer_.NextToken();
+                return MakeNode<ast::StringConst>(std::move(result));
+            }
+            if (lexer_.CurrentToken().Is<TokenType::True>()) {
+                lexer_.NextToken();
+                return MakeNode<ast::BoolConst>(runtime::Bool(true));
+            }
+            if (lexer_.CurrentToken().Is<TokenType::False>()) {
+                lexer_.NextToken();
+                return MakeNode<ast::BoolConst>(runtime::Bool(false));
+            }
+            if (lexer_.CurrentToken().Is<TokenType::None>()) {
+                lexer_.NextToken();
+                return MakeNode<ast::None>();
+            }
+
+            return ParseDottedIdsInMultExpr();
+        }
+
+        std::unique_ptr<ast::Statement> ParseDottedIdsInMultExpr() {
+            vector<string> names = ParseDottedIds();
+
+            if (lexer_.CurrentToken() == '(') {
+                // various calls
+                NestingGuard nesting(*this);
+                nesting.Enter();
+                vector<unique_ptr<ast::Statement>> args;
+                if (lexer_.NextToken() != ')') {
+                    args = ParseTestList();
+                }
+                lexer_.Expect<TokenType::Char>(')');
+                lexer_.NextToken();
+
+                auto method_name = names.back();
+                names.pop_back();
+
+                if (!names.empty()) {
+                    return MakeNode<ast::MethodCall>(
+                        MakeNode<ast::VariableValue>(std::move(names)), std::move(method_name),
+                        std::move(args));
+                }
+                if (auto it = declared_classes_.find(method_name); it != declared_classes_.end()) {
+                    return MakeNode<ast::NewInstance>(
+                        static_cast<const runtime::Class&>(*it->second), std::move(args));  // NOLINT
+                }
+                if (auto builtin = ParseBuiltinCall(method_name, args)) {
+                    return builtin;
+                }
+                throw ParseError("Unknown call to "s + method_name + "()"s);
+            }
+            return MakeNode<ast::VariableValue>(std::move(names));
+        }
+
+        // Builtin -> 'str' '(' Test ')'
+        //          | 'copy' '(' Test ')'
+        //          | 'clock_ns' '(' ')'
+        //          | 'counter_add' '(' Test ',' Test ')'
+        //          | 'timer_start' '(' Test ')'
+        //          | 'timer_stop' '(' Test ')'
+        // Возвращает nullptr, если name не является встроенной функцией
+        unique_ptr<ast::Statement> ParseBuiltinCall(const string& name, vector<unique_ptr<ast::Statement>>& args) {
+            auto expect_args = [&](size_t count) {
+                if (args.size() != count) {
+                    throw ParseError("Function "s + name + " takes "s + to_string(count) + " argument(s)"s);
+                }
+            };
+
+            if (name == "str"sv) {
+                if (args.size() != 1) {
+                    throw ParseError("Function str takes exactly one argument"s);
+                }
+                return MakeNode<ast::Stringify>(std::move(args.front()));
+            }
+            if (name == "copy"sv) {
+                expect_args(1);
+                return MakeNode<ast::Copy>(std::move(args.front()));
+            }
+            if (name == "clock_ns"sv) {
+                expect_args(0);
+                return MakeNode<ast::ClockNs>();
+            }
+            if (name == "counter_add"sv) {
+                expect_args(2);
+                return MakeNode<ast::CounterAdd>(std::move(args[0]), std::move(args[1]));
+            }
+            if (name == "timer_start"sv) {
+                expect_args(1);
+                return MakeNode<ast::TimerStart>(std::move(args.front()));
+            }
+            if (name == "timer_stop"sv) {
+                expect_args(1);
+                return MakeNode<ast::TimerStop>(std::move(args.front()));
+            }
+            return nullptr;
+        }
+
+        vector<unique_ptr<ast::Statement>> ParseTestList()  // NOLINT
+        {
+            vector<unique_ptr<ast::Statement>> result;
+            result.push_back(ParseTest());
+
+            while (lexer_.CurrentToken() == ',') {
+                lexer_.NextToken();
+                result.push_back(ParseTest());
+            }
+            return result;
+        }
+
+        // Condition -> if LogicalExpr: Suite [else: Suite]
+        unique_ptr<ast::Statement> ParseCondition()  // NOLINT
+        {
+            lexer_.Expect<TokenType::If>();
+            lexer_.NextToken();
+
+            auto condition = ParseTest();
+
+            lexer_.Expect<TokenType::Char>(':');
+            lexer_.NextToken();
+
+            auto if_body = ParseSuite();
+
+            unique_ptr<ast::Statement> else_body;
+            if (lexer_.CurrentToken().Is<TokenType::Else>()) {
+                lexer_.ExpectNext<TokenType::Char>(':');
+                lexer_.NextToken();
+                else_body = ParseSuite();
+            }
+
+            return MakeNode<ast::IfElse>(std::move(condition), std::move(if_body),
+                std::move(else_body));
+        }
+
+        // Повтор выражения без вызовов методов заменяется ссылкой на первое (см. ParserOptions)
+        unique_ptr<ast::Statement> ParseTest()  // NOLINT
+        {
+            if (!options_.share_identical_subtrees) {
+                return ParseOrTest();
+            }
+            const size_t first_token = lexer_.CurrentTokenIndex();
+            const size_t line = lexer_.CurrentLine();
+            const size_t bytes = ast::Statement::GetLiveBytes();
+            auto result = ParseOrTest();
+            if (lexer_.CurrentTokenIndex() - first_token < MIN_SHARED_TOKENS || !HasNoNodeState(*result)) {
+                return result;
+            }
+            if (ast::Statement* shared = FindSharedSubtree(shared_expressions_, first_token, *result)) {
+                return ReplaceWithShared(*shared, bytes, line);
+            }
+            return result;
+        }
+
+        // LogicalExpr -> AndTest [OR AndTest]
+        // AndTest -> NotTest [AND NotTest]
+        // NotTest -> [NOT] NotTest
+        //          | Comparison
+        unique_ptr<ast::Statement> ParseOrTest()  // NOLINT
+        {
+            auto result = ParseAndTest();
+            NestingGuard nesting(*this);
+            while (lexer_.CurrentToken().Is<TokenType::Or>()) {
+                nesting.Enter();
+                lexer_.NextToken();
+                result = MakeNode<ast::Or>(std::move(result), ParseAndTest());
+            }
+            return result;
+        }
+
+        unique_ptr<ast::Statement> ParseAndTest()  // NOLINT
+        {
+            auto result = ParseNotTest();
+            NestingGuard nesting(*this);
+            while (lexer_.CurrentToken().Is<TokenType::And>()) {
+                nesting.Enter();
+                lexer_.NextToken();
+                result = MakeNode<ast::And>(std::move(result), ParseNotTest());
+            }
+            return result;
+        }
+
+        unique_ptr<ast::Statement> ParseNotTest()  // NOLINT
+        {
+            if (lexer_.CurrentToken().Is<TokenType::Not>()) {
+                NestingGuard nesting(*this);
+                nesting.Enter();
+                lexer_.NextToken();
+                return MakeNode<ast::Not>(ParseNotTest());  // NOLINT
+            }
+            return ParseComparison();
+        }
+
+        // Comparison -> Expr [COMP_OP Expr]
+        unique_ptr<ast::Statement> ParseComparison()  // NOLINT
+        {
+            auto result = ParseExpression();
+
+            const auto tok = lexer_.CurrentToken();
+
+            if (tok == '<') {
+                lexer_.NextToken();
+                return MakeNode<ast::Comparison>(runtime::Less, std::move(result),
+                    ParseExpression());
+            }
+            if (tok == '>') {
+                lexer_.NextToken();
+                return MakeNode<ast::Comparison>(runtime::Greater, std::move(result),
+                    ParseExpression());
+            }
+            if (tok.Is<TokenType::Eq>()) {
+                lexer_.NextToken();
+                return MakeNode<ast::Comparison>(runtime::Equal, std::move(result),
+                    ParseExpression());
+            }
+            if (tok.Is<TokenType::NotEq>()) {
+                lexer_.NextToken();
+                return MakeNode<ast::Comparison>(runtime::NotEqual, std::move(result),
+                    ParseExpression());
+            }
+            if (tok.Is<TokenType::LessOrEq>()) {
+                lexer_.NextToken();
+                return MakeNode<ast::Comparison>(runtime::LessOrEqual, std::move(result),
+                    ParseExpression());
+            }
+            if (tok.Is<TokenType::GreaterOrEq>()) {
+                lexer_.NextToken();
+                return MakeNode<ast::Comparison>(runtime::GreaterOrEqual, std::move(result),
+                    ParseExpression());
+            }
+            return result;
+        }
+
+        // Statement -> SimpleStatement Newline
+        //           | class ClassDefinition
+        //           | if Condition
+        //           | import Id Newline
+        unique_ptr<ast::Statement> ParseStatement()  // NOLINT
+        {
+            const auto& tok = lexer_.CurrentToken();
+            const size_t line = lexer_.CurrentLine();
+
+            unique_ptr<ast::Statement> result;
+            if (tok.Is<TokenType::Class>()) {
+                lexer_.NextToken();
+                result = ParseClassDefinition();  // NOLINT
+            }
+            else if (tok.Is<TokenType::If>()) {
+                result = ParseCondition();
+            }
+            else if (tok.Is<TokenType::Import>()) {
+                result = ParseImport();
+                lexer_.Expect<TokenType::Newline>();
+                lexer_.NextToken();
+            }
+            else {
+                result = ParseSimpleStatement();
+                lexer_.Expect<TokenType::Newline>();
+                lexer_.NextToken();
+            }
+            result->SetLine(line);
+            return result;
+        }
+
+        // Классы модуля становятся известны разбору программы, как если бы они были определены в ней
+        unique_ptr<ast::Statement> ParseImport() {
+            const string name = lexer_.ExpectNext<TokenType::Id>().value;
+            lexer_.NextToken();
+            if (options_.module_path.empty()) {
+                throw ParseError("Cannot import "s + name + ": module path is not set"s);
+            }
+            shared_ptr<const parse::Module> module = parse::ModuleCache::Load(name, options_);
+            for (const runtime::ObjectHolder& cls : module->classes) {
+                const string& class_name = cls.TryAs<runtime::Class>()->GetName();
+                auto [it, inserted] = declared_classes_.emplace(class_name, cls);
+                if (!inserted && it->second.Get() != cls.Get()) {
+                    throw ParseError("Class "s + class_name + " already exists"s);
+                }
+            }
+            return MakeNode<ast::Import>(std::move(module));
+        }
+
+        // StatementBody -> return Expression
+        //               | print ExpressionList
+        //               | AssignmentOrCall
+        unique_ptr<ast::Statement> ParseSimpleStatement() {
+            const auto& tok = lexer_.CurrentToken();
+
+            if (tok.Is<TokenType::Return>()) {
+                lexer_.NextToken();
+                return MakeNode<ast::Return>(ParseTest());
+            }
+            if (tok.Is<TokenType::Print>()) {
+                lexer_.NextToken();
+                vector<unique_ptr<ast::Statement>> args;
+                if (!lexer_.CurrentToken().Is<TokenType::Newline>()) {
+                    args = ParseTestList();
+                }
+                return MakeNode<ast::Print>(std::move(args));
+            }
+            return ParseAssignmentOrCall();
+        }
+
+        // Возвращает ранее разобранное поддерево с тем же текстом, что у токенов от first_token
+        // до текущего. Если такого нет, запоминает node и возвращает nullptr
+        ast::Statement* FindSharedSubtree(unordered_map<string, ast::Statement*>& subtrees, size_t first_token,
+            ast::Statement& node) {
+            string key;
+            ostringstream text;
+            for (size_t i = first_token; i < lexer_.CurrentTokenIndex(); ++i) {
+                text.str({});
+                text << lexer_.TokenAt(i);
+                // Длина отделяет токены, текст которых может содержать любые символы
+                key += to_string(text.tellp());
+                key += ':';
+                key += text.str();
+            }
+            auto [it, inserted] = subtrees.emplace(std::move(key), &node);
+            return inserted ? nullptr : it->second;
+        }
+
+        // Создаёт ссылку на поддерево target вместо только что разобранного повтора.
+        // bytes - память узлов перед разбором повтора (Statement::GetLiveBytes)
+        unique_ptr<ast::SharedNode> ReplaceWithShared(ast::Statement& target, size_t bytes, size_t line) {
+            const size_t subtree_bytes = ast::Statement::GetLiveBytes() - bytes;
+            auto shared = make_unique<ast::SharedNode>(target);
+            shared->SetLine(line);
+            runtime::Counters& counters = runtime::Stats::Get();
+            ++counters.ast_shared_subtrees;
+            counters.ast_bytes_saved += subtree_bytes - min(subtree_bytes, sizeof(ast::SharedNode));
+            return shared;
+        }
+
+        parse::Lexer& lexer_;
+        const ParserOptions& options_;
+        runtime::Closure declared_classes_;
+        size_t nesting_ = 0;
+        // Первые вхождения выражений и методов по их тексту (см. ParserOptions)
+        unordered_map<string, ast::Statement*> shared_expressions_;
+        unordered_map<string, ast::Statement*> shared_methods_;
+    };
+
+}  // namespace
+
+unique_ptr<ast::Statement> ParseProgram(parse::Lexer& lexer, const ParserOptions& options) {
+    return Parser{ lexer, options }.ParseProgram();
 }
\ No newline at end of file
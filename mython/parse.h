@@ -1,18 +1,36 @@
-#pragma once
-
-#include <memory>
-#include <stdexcept>
-
-namespace parse {
-    class Lexer;
-}
-
-namespace runtime {
-    class Executable;
-}
-
-struct ParseError : std::runtime_error {
-    using std::runtime_error::runtime_error;
-};
-
-std::unique_ptr<runtime::Executable> ParseProgram(parse::Lexer& lexer);
\ No newline at end of file
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace parse {
+    class Lexer;
+}
+
+namespace ast {
+    class Statement;
+}
+
+struct ParseError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+struct ParserOptions {
+    // Заменять повторы поддеревьев с тем же текстом ссылкой на первое (ast::SharedNode):
+    // выражения без инструкций вызова методов (obj.method(...)) из трёх и более токенов и тела методов с теми же параметрами.
+    // Уменьшает дерево программ с многократно повторёнными фрагментами; счётчики исполнения
+    // повторов при этом относятся к первому месту
+    bool share_identical_subtrees = false;
+    // Связать вызовы методов, класс объекта которых известен после разбора всей программы,
+    // с вызываемым методом (см. class_hierarchy.h)
+    bool bind_static_methods = false;
+    // Включать слоты кадров для экземпляров, не покидающих вызов метода (см. escape_analysis.h).
+    // Слоты хранят экземпляры в узлах дерева, поэтому в деревьях, общих для нескольких программ, отключаются
+    bool frame_slots = false;
+    // Каталоги, в которых инструкция import ищет файл модуля <name>.my. Пустой список - import запрещён
+    std::vector<std::filesystem::path> module_path;
+};
+
+std::unique_ptr<ast::Statement> ParseProgram(parse::Lexer& lexer, const ParserOptions& options = {});
\ No newline at end of file
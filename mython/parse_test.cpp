@@ -1,281 +1,1027 @@
-#include "lexer.h"
-#include "parse.h"
-#include "statement.h"
-#include "test_runner_p.h"
-
-using namespace std;
-
-namespace parse {
-
-    unique_ptr<ast::Statement> ParseProgramFromString(const string& program) {
-        istringstream is(program);
-        parse::Lexer lexer(is);
-        return ParseProgram(lexer);
-    }
-
-    void TestSimpleProgram() {
-        const string program = R"(
-x = 4
-y = 5
-z = "hello, "
-n = "world"
-print x + y, z + n
-)"s;
-
-        runtime::DummyContext context;
-
-        runtime::Closure closure;
-        auto tree = ParseProgramFromString(program);
-        tree->Execute(closure, context);
-
-        ASSERT_EQUAL(context.output.str(), "9 hello, world\n"s);
-    }
-
-    void TestProgramWithClasses() {
-        const string program = R"(
-program_name = "Classes test"
-
-class Empty:
-  def __init__():
-    x = 0
-
-class Point:
-  def __init__(x, y):
-    self.x = x
-    self.y = y
-
-  def SetX(value):
-    self.x = value
-  def SetY(value):
-    self.y = value
-
-  def __str__():
-    return '(' + str(self.x) + '; ' + str(self.y) + ')'
-
-origin = Empty()
-origin = Point(0, 0)
-
-far_far_away = Point(10000, 50000)
-
-print program_name, origin, far_far_away, origin.SetX(1)
-)"s;
-
-        runtime::DummyContext context;
-
-        runtime::Closure closure;
-        auto tree = ParseProgramFromString(program);
-        tree->Execute(closure, context);
-
-        ASSERT_EQUAL(context.output.str(), "Classes test (0; 0) (10000; 50000) None\n"s);
-    }
-
-    void TestProgramWithIf() {
-        const string program = R"(
-x = 4
-y = 5
-if x > y:
-  print "x > y"
-else:
-  print "x <= y"
-if x > 0:
-  if y < 0:
-    print "y < 0"
-  else:
-    print "y >= 0"
-else:
-  print 'x <= 0'
-)"s;
-
-        runtime::DummyContext context;
-
-        runtime::Closure closure;
-        auto tree = ParseProgramFromString(program);
-        tree->Execute(closure, context);
-
-        ASSERT_EQUAL(context.output.str(), "x <= y\ny >= 0\n"s);
-    }
-
-    void TestReturnFromIf() {
-        const string program = R"(
-class Abs:
-  def calc(n):
-    if n > 0:
-      return n
-    else:
-      return -n
-
-x = Abs()
-print x.calc(2)
-)"s;
-
-        runtime::DummyContext context;
-
-        runtime::Closure closure;
-        auto tree = ParseProgramFromString(program);
-        tree->Execute(closure, context);
-
-        ASSERT_EQUAL(context.output.str(), "2\n"s);
-    }
-
-    void TestRecursion() {
-        const string program = R"(
-class ArithmeticProgression:
-  def calc(n):
-    self.result = 0
-    self.calc_impl(n)
-
-  def calc_impl(n):
-    value = n
-    if value > 0:
-      self.result = self.result + value
-      self.calc_impl(value - 1)
-
-x = ArithmeticProgression()
-x.calc(10)
-print x.result
-)"s;
-
-        runtime::DummyContext context;
-
-        runtime::Closure closure;
-        auto tree = ParseProgramFromString(program);
-        tree->Execute(closure, context);
-
-        ASSERT_EQUAL(context.output.str(), "55\n"s);
-    }
-
-    void TestRecursion2() {
-        const string program = R"(
-class GCD:
-  def __init__():
-    self.call_count = 0
-
-  def calc(a, b):
-    self.call_count = self.call_count + 1
-    if a < b:
-      return self.calc(b, a)
-    if b == 0:
-      return a
-    return self.calc(a - b, b)
-
-x = GCD()
-print x.calc(510510, 18629977)
-print x.calc(22, 17)
-print x.call_count
-)"s;
-
-        runtime::DummyContext context;
-
-        runtime::Closure closure;
-        auto tree = ParseProgramFromString(program);
-        tree->Execute(closure, context);
-
-        ASSERT_EQUAL(context.output.str(), "17\n1\n115\n"s);
-    }
-
-    void TestComplexLogicalExpression() {
-        const string program = R"(
-a = 1
-b = 2
-c = 3
-ok = a + b > c and a + c > b and b + c > a
-print ok
-)"s;
-
-        runtime::DummyContext context;
-
-        runtime::Closure closure;
-        auto tree = ParseProgramFromString(program);
-        tree->Execute(closure, context);
-
-        ASSERT_EQUAL(context.output.str(), "False\n"s);
-    }
-
-    void TestClassicalPolymorphism() {
-        const string program = R"(
-class Shape:
-  def __str__():
-    return "Shape"
-
-class Rect(Shape):
-  def __init__(w, h):
-    self.w = w
-    self.h = h
-
-  def __str__():
-    return "Rect(" + str(self.w) + 'x' + str(self.h) + ')'
-
-class Circle(Shape):
-  def __init__(r):
-    self.r = r
-
-  def __str__():
-    return 'Circle(' + str(self.r) + ')'
-
-class Triangle(Shape):
-  def __init__(a, b, c):
-    self.ok = a + b > c and a + c > b and b + c > a
-    if (self.ok):
-      self.a = a
-      self.b = b
-      self.c = c
-
-  def __str__():
-    if self.ok:
-      return 'Triangle(' + str(self.a) + ', ' + str(self.b) + ', ' + str(self.c) + ')'
-    else:
-      return 'Wrong triangle'
-
-r = Rect(10, 20)
-c = Circle(52)
-t1 = Triangle(3, 4, 5)
-t2 = Triangle(125, 1, 2)
-
-print r, c, t1, t2
-)"s;
-
-        runtime::DummyContext context;
-
-        runtime::Closure closure;
-        auto tree = ParseProgramFromString(program);
-        tree->Execute(closure, context);
-
-        ASSERT_EQUAL(context.output.str(),
-            "Rect(10x20) Circle(52) Triangle(3, 4, 5) Wrong triangle\n"s);
-    }
-
-    void TestSelfInConstructor() {
-        const string program = (R"--(
-class X:
-  def __init__(p):
-    p.x = self
-class XHolder:
-  def __init__():
-    dummy = 0
-xh = XHolder()
-x = X(xh)
-)--");
-
-        runtime::DummyContext context;
-        runtime::Closure closure;
-        auto tree = ParseProgramFromString(program);
-        tree->Execute(closure, context);
-
-        const auto* xh = closure.at("xh"s).TryAs<runtime::ClassInstance>();
-        ASSERT(xh != nullptr);
-        ASSERT_EQUAL(xh->Fields().at("x"s).Get(), closure.at("x"s).Get());
-    }
-
-}  // namespace parse
-
-void TestParseProgram(TestRunner& tr) {
-    RUN_TEST(tr, parse::TestSimpleProgram);
-    RUN_TEST(tr, parse::TestProgramWithClasses);
-    RUN_TEST(tr, parse::TestProgramWithIf);
-    RUN_TEST(tr, parse::TestReturnFromIf);
-    RUN_TEST(tr, parse::TestRecursion);
-    RUN_TEST(tr, parse::TestRecursion2);
-    RUN_TEST(tr, parse::TestComplexLogicalExpression);
-    RUN_TEST(tr, parse::TestClassicalPolymorphism);
-    RUN_TEST(tr, parse::TestSelfInConstructor);
+#include "call_stack.h"
+#include "heap_census.h"
+#include "lexer.h"
+#include "module_cache.h"
+#include "parse.h"
+#include "statement.h"
+#include "stats.h"
+#include "test_runner_p.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace parse {
+
+    unique_ptr<ast::Statement> ParseProgramFromString(const string& program, const ParserOptions& options = {}) {
+        istringstream is(program);
+        parse::Lexer lexer(is);
+        return ParseProgram(lexer, options);
+    }
+
+    void TestSimpleProgram() {
+        const string program = R"(
+x = 4
+y = 5
+z = "hello, "
+n = "world"
+print x + y, z + n
+)"s;
+
+        runtime::DummyContext context;
+
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+
+        ASSERT_EQUAL(context.output.str(), "9 hello, world\n"s);
+    }
+
+    void TestProgramWithClasses() {
+        const string program = R"(
+program_name = "Classes test"
+
+class Empty:
+  def __init__():
+    x = 0
+
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+
+  def SetX(value):
+    self.x = value
+  def SetY(value):
+    self.y = value
+
+  def __str__():
+    return '(' + str(self.x) + '; ' + str(self.y) + ')'
+
+origin = Empty()
+origin = Point(0, 0)
+
+far_far_away = Point(10000, 50000)
+
+print program_name, origin, far_far_away, origin.SetX(1)
+)"s;
+
+        runtime::DummyContext context;
+
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+
+        ASSERT_EQUAL(context.output.str(), "Classes test (0; 0) (10000; 50000) None\n"s);
+    }
+
+    void TestProgramWithIf() {
+        const string program = R"(
+x = 4
+y = 5
+if x > y:
+  print "x > y"
+else:
+  print "x <= y"
+if x > 0:
+  if y < 0:
+    print "y < 0"
+  else:
+    print "y >= 0"
+else:
+  print 'x <= 0'
+)"s;
+
+        runtime::DummyContext context;
+
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+
+        ASSERT_EQUAL(context.output.str(), "x <= y\ny >= 0\n"s);
+    }
+
+    void TestReturnFromIf() {
+        const string program = R"(
+class Abs:
+  def calc(n):
+    if n > 0:
+      return n
+    else:
+      return -n
+
+x = Abs()
+print x.calc(2)
+)"s;
+
+        runtime::DummyContext context;
+
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+
+        ASSERT_EQUAL(context.output.str(), "2\n"s);
+    }
+
+    void TestRecursion() {
+        const string program = R"(
+class ArithmeticProgression:
+  def calc(n):
+    self.result = 0
+    self.calc_impl(n)
+
+  def calc_impl(n):
+    value = n
+    if value > 0:
+      self.result = self.result + value
+      self.calc_impl(value - 1)
+
+x = ArithmeticProgression()
+x.calc(10)
+print x.result
+)"s;
+
+        runtime::DummyContext context;
+
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+
+        ASSERT_EQUAL(context.output.str(), "55\n"s);
+    }
+
+    void TestRecursion2() {
+        const string program = R"(
+class GCD:
+  def __init__():
+    self.call_count = 0
+
+  def calc(a, b):
+    self.call_count = self.call_count + 1
+    if a < b:
+      return self.calc(b, a)
+    if b == 0:
+      return a
+    return self.calc(a - b, b)
+
+x = GCD()
+print x.calc(510510, 18629977)
+print x.calc(22, 17)
+print x.call_count
+)"s;
+
+        runtime::DummyContext context;
+
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+
+        ASSERT_EQUAL(context.output.str(), "17\n1\n115\n"s);
+    }
+
+    void TestComplexLogicalExpression() {
+        const string program = R"(
+a = 1
+b = 2
+c = 3
+ok = a + b > c and a + c > b and b + c > a
+print ok
+)"s;
+
+        runtime::DummyContext context;
+
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+
+        ASSERT_EQUAL(context.output.str(), "False\n"s);
+    }
+
+    void TestClassicalPolymorphism() {
+        const string program = R"(
+class Shape:
+  def __str__():
+    return "Shape"
+
+class Rect(Shape):
+  def __init__(w, h):
+    self.w = w
+    self.h = h
+
+  def __str__():
+    return "Rect(" + str(self.w) + 'x' + str(self.h) + ')'
+
+class Circle(Shape):
+  def __init__(r):
+    self.r = r
+
+  def __str__():
+    return 'Circle(' + str(self.r) + ')'
+
+class Triangle(Shape):
+  def __init__(a, b, c):
+    self.ok = a + b > c and a + c > b and b + c > a
+    if (self.ok):
+      self.a = a
+      self.b = b
+      self.c = c
+
+  def __str__():
+    if self.ok:
+      return 'Triangle(' + str(self.a) + ', ' + str(self.b) + ', ' + str(self.c) + ')'
+    else:
+      return 'Wrong triangle'
+
+r = Rect(10, 20)
+c = Circle(52)
+t1 = Triangle(3, 4, 5)
+t2 = Triangle(125, 1, 2)
+
+print r, c, t1, t2
+)"s;
+
+        runtime::DummyContext context;
+
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+
+        ASSERT_EQUAL(context.output.str(),
+            "Rect(10x20) Circle(52) Triangle(3, 4, 5) Wrong triangle\n"s);
+    }
+
+    void TestSelfInConstructor() {
+        const string program = (R"--(
+class X:
+  def __init__(p):
+    p.x = self
+class XHolder:
+  def __init__():
+    dummy = 0
+xh = XHolder()
+x = X(xh)
+)--");
+
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+
+        const auto* xh = closure.at("xh"s).TryAs<runtime::ClassInstance>();
+        ASSERT(xh != nullptr);
+        ASSERT_EQUAL(xh->Fields().at("x"s).Get(), closure.at("x"s).Get());
+    }
+
+    void TestBorrowedReads() {
+        const string program = (R"--(
+class Node:
+  def __init__(value):
+    self.value = value
+    self.next = None
+  def Self():
+    return self
+a = Node(1)
+a.next = Node(2)
+a.next.next = Node(3)
+s = a.Self()
+a = None
+x = s.next.next.value + s.next.value * s.value
+print s.next.next.value == 3, s.next.value < s.next.next.value
+)--");
+
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+        ASSERT_EQUAL(context.output.str(), "True True\n"s);
+        ASSERT_EQUAL(closure.at("x"s).TryAs<runtime::Number>()->GetValue(), 5);
+
+        // Чтение переменных и полей в выражении не копирует ObjectHolder:
+        // копий не больше, чем при присваивании константы
+        // Константы программы принадлежат её дереву, поэтому деревья живут до конца теста
+        vector<unique_ptr<ast::Statement>> programs;
+        const auto count_copies = [&closure, &context, &programs](const string& assignment) {
+            auto& statement = programs.emplace_back(ParseProgramFromString(assignment));
+            runtime::Stats::Reset();
+            statement->Execute(closure, context);
+            const uint64_t copies = runtime::Stats::Get().holder_copies;
+            runtime::Stats::Reset();
+            return copies;
+        };
+        ASSERT(count_copies("y = s.next.next.value + s.next.value * s.value\n"s) <= count_copies("y = 5\n"s));
+        ASSERT_EQUAL(closure.at("y"s).TryAs<runtime::Number>()->GetValue(), 5);
+    }
+
+    void TestFusedArithmetic() {
+        const string program = (R"--(
+class Logged:
+  def __init__(value):
+    self.value = value
+  def get(name):
+    print name
+    return self.value
+class Money:
+  def __init__(amount):
+    self.amount = amount
+  def __add__(other):
+    self.amount = self.amount + other * 100
+    return self
+  def __str__():
+    return str(self.amount) + ' cents'
+a = 7
+b = 5
+c = 3
+x = (a + b) * (c - 1) / 2 - -a
+l = Logged(4)
+y = l.get('first') * 3 - l.get('second') / (l.get('third') - 2)
+s = 'a' + 'b' + str(a * 2 + 1) + 'c'
+m = Money(50) + a * 2
+print x, y, s, m
+)--");
+
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        tree->Execute(closure, context);
+        ASSERT_EQUAL(context.output.str(), "first\nsecond\nthird\n19 10 ab15c 1450 cents\n"s);
+
+        // Промежуточные результаты над числами не создают объектов
+        const auto count_numbers = [&closure, &context](const string& statement) {
+            auto tree = ParseProgramFromString(statement);
+            runtime::Stats::Reset();
+            tree->Execute(closure, context);
+            const uint64_t numbers = runtime::Stats::Get().objects_allocated[static_cast<size_t>(runtime::ObjectKind::NUMBER)];
+            runtime::Stats::Reset();
+            return numbers;
+        };
+        ASSERT_EQUAL(count_numbers("z = (a + b) * (c - 1) / 2\n"s), 1u);
+        ASSERT_EQUAL(closure.at("z"s).TryAs<runtime::Number>()->GetValue(), 12);
+
+        ASSERT_THROWS(ParseProgramFromString("z = a + b / (c - 3)\n"s)->Execute(closure, context), runtime_error);
+        ASSERT_THROWS(ParseProgramFromString("z = a * 2 - 'x'\n"s)->Execute(closure, context), runtime_error);
+    }
+
+    void TestCopyBuiltin() {
+        const string program = (R"--(
+class State:
+  def __init__(a, b):
+    self.a = a
+    self.b = b
+    print 'init'
+  def __str__():
+    return str(self.a) + ',' + str(self.b)
+s = State(1, 2)
+t = copy(s)
+u = copy(t)
+print s, t, u
+t.a = 10
+print s, t, u
+s.b = 20
+print s, t, u
+print copy(5), copy('x'), copy(None)
+)--");
+
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        runtime::Stats::Reset();
+        tree->Execute(closure, context);
+        ASSERT_EQUAL(context.output.str(), "init\n1,2 1,2 1,2\n1,2 10,2 1,2\n1,20 10,2 1,2\n5 x None\n"s);
+        // Поля копируются только при первом присваивании полю разделяющего их объекта.
+        // Последний владелец (u) продолжает пользоваться исходными полями
+        ASSERT_EQUAL(runtime::Stats::Get().field_copies, 2u);
+        runtime::Stats::Reset();
+
+        ASSERT_EQUAL(closure.at("t"s).TryAs<runtime::ClassInstance>()->GetClass().GetName(), "State"s);
+        ASSERT(&closure.at("u"s).TryAs<runtime::ClassInstance>()->Fields()
+            != &closure.at("s"s).TryAs<runtime::ClassInstance>()->Fields());
+
+        try {
+            ParseProgramFromString("x = copy(1, 2)\n"s);
+            ASSERT(false);
+        }
+        catch (const ParseError&) {
+        }
+    }
+
+    void TestNonEscapingInstances() {
+        const string program = (R"--(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+  def norm():
+    return self.x * self.x + self.y * self.y
+  def me():
+    return self
+  def __str__():
+    return str(self.x)
+class Geo:
+  def dist(ax, ay, bx, by):
+    d = Point(bx - ax, by - ay)
+    return d.norm()
+  def printed(x):
+    p = Point(x, x)
+    print p
+  def returned(x):
+    p = Point(x, x)
+    return p
+  def passed(x):
+    p = Point(x, x)
+    return self.take(p)
+  def take(p):
+    return p.x
+  def via_me(x):
+    p = Point(x, x)
+    q = p.me()
+    return q.x
+  def reassigned(x):
+    p = Point(x, x)
+    p = self.make(x)
+    return p.x
+  def make(x):
+    return Point(x, x)
+g = Geo()
+print g.dist(0, 0, 3, 4), g.dist(1, 1, 2, 2)
+g.printed(1)
+g.printed(2)
+a = g.returned(3)
+b = g.returned(4)
+print a.x, b.x, g.passed(5), g.passed(6), g.via_me(7), g.via_me(8), g.reassigned(9), g.reassigned(10)
+)--");
+
+        ParserOptions options;
+        options.frame_slots = true;
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program, options);
+
+        // Слоты кадров получает только экземпляр d метода dist: остальные экземпляры выводятся,
+        // возвращаются, передаются в другой метод или выпускаются методом me
+        size_t frame_slot_sites = 0;
+        ast::ForEachNode(*tree, [&frame_slot_sites](ast::Statement& node) {
+            if (auto* instance = dynamic_cast<ast::NewInstance*>(&node); instance && instance->HasFrameSlots()) {
+                ++frame_slot_sites;
+            }
+        });
+        ASSERT_EQUAL(frame_slot_sites, 1u);
+
+        runtime::Stats::Reset();
+        tree->Execute(closure, context);
+        ASSERT_EQUAL(context.output.str(), "25 2\n1\n2\n3 4 5 6 7 8 9 10\n"s);
+        // Второй вызов dist берёт экземпляр из слота
+        ASSERT_EQUAL(runtime::Stats::Get().frame_slot_reuses, 1u);
+        ASSERT_EQUAL(runtime::Stats::Get().objects_allocated[static_cast<size_t>(runtime::ObjectKind::CLASS_INSTANCE)], 14u);
+        runtime::Stats::Reset();
+
+        // В рекурсии экземпляры всех активных вызовов существуют одновременно и не разделяют слот
+        runtime::DummyContext recursion_context;
+        runtime::Closure recursion_closure;
+        auto recursion = ParseProgramFromString(R"--(
+class Point:
+  def __init__(x):
+    self.x = x
+class Sum:
+  def rec(n):
+    if n < 1:
+      return 0
+    q = Point(n)
+    return q.x + self.rec(n - 1) + q.x
+s = Sum()
+print s.rec(20), s.rec(3)
+)--"s, options);
+        runtime::HeapCensus::Enable();
+        recursion->Execute(recursion_closure, recursion_context);
+        ASSERT_EQUAL(recursion_context.output.str(), "420 12\n"s);
+        ASSERT_EQUAL(runtime::Stats::Get().frame_slot_reuses, 3u);
+        runtime::Stats::Reset();
+
+        // После выхода из методов слоты хранят экземпляры без полей, и перепись не считает их утечкой
+        ostringstream census;
+        runtime::HeapCensus::WriteReport(census, &recursion_closure);
+        runtime::HeapCensus::Disable();
+        const string report = census.str();
+        ASSERT(report.find("(held by frame slots):\n  Point: 16 objects"s) != string::npos);
+        ASSERT(report.find("(held by cycles):\n"s) + "(held by cycles):\n"s.size() == report.size());
+    }
+
+    void TestFrameSlotsKeepBehaviour() {
+        const string classes = R"--(
+class Tag:
+  def __init__(n):
+    self.n = n
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+    self.tag = Tag(x)
+  def norm():
+    return self.x * self.x + self.y * self.y
+class Geo:
+  def dist(ax, ay, bx, by):
+    d = Point(bx - ax, by - ay)
+    return d.norm()
+  def rec(n):
+    if n < 1:
+      return 0
+    q = Point(n, n)
+    return q.x + self.rec(n - 1)
+  def kept(x):
+    p = Point(x, x)
+    return p
+g = Geo()
+)--"s;
+        const vector<string> steps = {
+            "print g.dist(0, 0, 3, 4), g.dist(1, 1, 2, 2)\n"s,
+            "print g.rec(5), g.rec(2)\n"s,
+            "k = g.kept(7)\nprint k.tag.n\n"s,
+            "k = None\nprint g.dist(2, 2, 2, 2)\n"s,
+        };
+
+        // Исполняет шаги программы по очереди и после каждого запоминает вывод и количество живых объектов,
+        // кроме экземпляров в слотах кадров. Поля таких экземпляров очищены, и они не продлевают жизнь других объектов
+        const auto run = [&classes, &steps](bool frame_slots) {
+            ParserOptions options;
+            options.frame_slots = frame_slots;
+            vector<pair<string, size_t>> trace;
+            runtime::Stats::Reset();
+            runtime::HeapCensus::Enable();
+            {
+                vector<unique_ptr<ast::Statement>> trees;
+                runtime::Closure closure;
+                trees.push_back(ParseProgramFromString(classes, options));
+                runtime::DummyContext context;
+                trees.back()->Execute(closure, context);
+                for (const string& step : steps) {
+                    runtime::DummyContext step_context;
+                    trees.push_back(ParseProgramFromString(step, options));
+                    trees.back()->Execute(closure, step_context);
+                    trace.emplace_back(step_context.output.str(),
+                        runtime::HeapCensus::GetLiveCount() - runtime::HeapCensus::GetFrameSlotCount());
+                }
+            }
+            trace.emplace_back(""s, runtime::HeapCensus::GetLiveCount());
+            runtime::HeapCensus::Disable();
+            const uint64_t reuses = runtime::Stats::Get().frame_slot_reuses;
+            runtime::Stats::Reset();
+            return make_pair(trace, reuses);
+        };
+
+        const auto [with_slots, reuses] = run(true);
+        const auto [without_slots, no_reuses] = run(false);
+        ASSERT(reuses > 0);
+        ASSERT_EQUAL(no_reuses, 0u);
+        ASSERT_EQUAL(with_slots.size(), without_slots.size());
+        for (size_t i = 0; i < with_slots.size(); ++i) {
+            ASSERT_EQUAL(with_slots[i].first, without_slots[i].first);
+            ASSERT_EQUAL(with_slots[i].second, without_slots[i].second);
+        }
+        ASSERT_EQUAL(with_slots.front().first, "25 2\n"s);
+        ASSERT_EQUAL(with_slots.back().second, 0u);
+    }
+
+    void TestSharedSubtrees() {
+        const string program = (R"--(
+class A:
+  def f(a, b):
+    return a * b + 1
+  def g(a):
+    return self.f(a, a) + 1
+class B:
+  def f(a, b):
+    return a * b + 1
+  def g(a):
+    return self.f(a, a) + 1
+x = 2
+y = 3
+a = A()
+b = B()
+print a.f(x, y), b.f(x, y), x * y + 1, a.g(x), b.g(x), x * y + 1
+)--");
+
+        const auto run = [&program](bool share) {
+            istringstream input(program);
+            parse::Lexer lexer(input);
+            ParserOptions options;
+            options.share_identical_subtrees = share;
+            const size_t bytes = ast::Statement::GetLiveBytes();
+            runtime::Stats::Reset();
+            auto tree = ParseProgram(lexer, options);
+            const size_t tree_bytes = ast::Statement::GetLiveBytes() - bytes;
+            const runtime::Counters counters = runtime::Stats::Get();
+            runtime::Stats::Reset();
+
+            runtime::DummyContext context;
+            runtime::Closure closure;
+            tree->Execute(closure, context);
+            ASSERT_EQUAL(context.output.str(), "7 7 7 6 6 7\n"s);
+            return tuple{ tree_bytes, counters.ast_shared_subtrees, counters.ast_bytes_saved };
+        };
+
+        const auto [plain_bytes, plain_shared, plain_saved] = run(false);
+        ASSERT_EQUAL(plain_shared, 0u);
+        ASSERT_EQUAL(plain_saved, 0u);
+
+        // Ссылками заменяются выражение a * b + 1 в B.f, сам метод B.f, метод B.g и второе
+        // выражение x * y + 1 в print. Выражение self.f(a, a) + 1 вызывает метод и не разделяется
+        const auto [shared_bytes, shared, saved] = run(true);
+        ASSERT_EQUAL(shared, 4u);
+        ASSERT(saved > 0);
+        ASSERT_EQUAL(shared_bytes + saved, plain_bytes);
+    }
+
+    void TestBoundCallChecksClass() {
+        auto tree = ParseProgramFromString(R"--(
+class A:
+  def f():
+    return 1
+class B:
+  def f():
+    return 2
+class C(B):
+  def g():
+    return 3
+b = B()
+print b.f()
+b = C()
+print b.f()
+b = None
+print b.f()
+)--"s);
+        vector<const runtime::Class*> classes;
+        vector<ast::MethodCall*> calls;
+        ast::ForEachNode(*tree, [&classes, &calls](ast::Statement& node) {
+            if (auto* definition = dynamic_cast<ast::ClassDefinition*>(&node)) {
+                classes.push_back(&definition->GetClass());
+            }
+            else if (auto* call = dynamic_cast<ast::MethodCall*>(&node)) {
+                calls.push_back(call);
+            }
+        });
+        ASSERT_EQUAL(classes.size(), 3u);
+        ASSERT_EQUAL(calls.size(), 3u);
+        const runtime::Class& a = *classes[0];
+        const runtime::Class& b = *classes[1];
+        // Связывания, которые анализ не мог бы доказать: класс объекта не совпадает с классом связывания
+        // или объекта нет. Вызов находит метод по имени
+        calls[0]->BindMethod(a, *a.GetMethod("f"s), true);
+        calls[1]->BindMethod(b, *b.GetMethod("f"s), false);
+        calls[2]->BindMethod(b, *b.GetMethod("f"s), true);
+
+        runtime::Stats::Reset();
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        tree->Execute(closure, context);
+        ASSERT_EQUAL(context.output.str(), "2\n2\nNone\n"s);
+        ASSERT_EQUAL(runtime::Stats::Get().bound_method_calls, 0u);
+
+        // Экземпляр наследника, не переопределяющего метод, вызывает связанный метод
+        calls[1]->BindMethod(b, *b.GetMethod("f"s), true);
+        runtime::Stats::Reset();
+        runtime::DummyContext bound_context;
+        runtime::Closure bound_closure;
+        tree->Execute(bound_closure, bound_context);
+        ASSERT_EQUAL(bound_context.output.str(), "2\n2\nNone\n"s);
+        ASSERT_EQUAL(runtime::Stats::Get().bound_method_calls, 1u);
+        runtime::Stats::Reset();
+    }
+
+    void TestStaticMethodBinding() {
+        const string program = R"--(
+class Shape:
+  def area():
+    return 0
+  def name():
+    return 'shape'
+  def describe():
+    return self.name() + ' ' + str(self.area())
+class Square(Shape):
+  def __init__(side):
+    self.side = side
+  def area():
+    return self.side * self.side
+class Greeter:
+  def hello(shape):
+    return shape.name()
+  def twice(shape):
+    return self.hello(shape) + self.hello(shape)
+class Left:
+  def tag():
+    return 'L'
+  def show():
+    return self.tag()
+class Right:
+  def tag():
+    return 'R'
+  def show():
+    return self.tag()
+class Other:
+  def area():
+    return 1
+  def swap():
+    self = Square(5)
+    return self.area()
+s = Square(2)
+g = Greeter()
+v = Shape()
+v = Square(3)
+l = Left()
+r = Right()
+o = Other()
+print s.describe(), g.twice(s), v.area(), l.show(), r.show(), o.swap()
+)--"s;
+
+        // Возвращает вызовы вида object.method, связанные с методом, и количество связанных вызовов при исполнении
+        const auto run = [&program](bool bind, bool share) {
+            istringstream input(program);
+            parse::Lexer lexer(input);
+            ParserOptions options;
+            options.bind_static_methods = bind;
+            options.share_identical_subtrees = share;
+            auto tree = ParseProgram(lexer, options);
+
+            set<string> bound;
+            ast::ForEachNode(*tree, [&bound](ast::Statement& node) {
+                auto* call = dynamic_cast<ast::MethodCall*>(&node);
+                if (call == nullptr || call->GetBoundMethod() == nullptr) {
+                    return;
+                }
+                ASSERT_EQUAL(call->GetBoundMethod()->name, call->GetMethodName());
+                const auto& ids = dynamic_cast<ast::VariableValue&>(call->GetObject()).GetIds();
+                bound.insert(ids.front() + '.' + call->GetMethodName());
+            });
+
+            runtime::Stats::Reset();
+            runtime::DummyContext context;
+            runtime::Closure closure;
+            tree->Execute(closure, context);
+            ASSERT_EQUAL(context.output.str(), "shape 4 shapeshape 9 L R 25\n"s);
+            const uint64_t bound_calls = runtime::Stats::Get().bound_method_calls;
+            runtime::Stats::Reset();
+            return pair{ bound, bound_calls };
+        };
+
+        const auto [unbound, unbound_calls] = run(false, false);
+        ASSERT(unbound.empty());
+        ASSERT_EQUAL(unbound_calls, 0u);
+
+        // self.area и v.area могут вызвать Shape.area или Square.area, shape.name - метод любого класса,
+        // а o.swap заменяет self экземпляром Square
+        const auto [bound, bound_calls] = run(true, false);
+        const set<string> expected{ "g.twice"s, "l.show"s, "o.swap"s, "r.show"s, "s.describe"s,
+            "self.hello"s, "self.name"s, "self.tag"s };
+        ASSERT_EQUAL(bound, expected);
+        ASSERT_EQUAL(bound_calls, 10u);
+
+        // Общее тело методов Left.show и Right.show вызывает разные методы tag
+        const auto [shared_bound, shared_calls] = run(true, true);
+        set<string> shared_expected = expected;
+        shared_expected.erase("self.tag"s);
+        ASSERT_EQUAL(shared_bound, shared_expected);
+        ASSERT_EQUAL(shared_calls, 8u);
+    }
+
+    void TestImport() {
+        namespace fs = std::filesystem;
+
+        const fs::path directory = fs::temp_directory_path() / ("mython_import_test_"s + to_string(getpid()));
+        fs::remove_all(directory);
+        fs::create_directories(directory);
+        const auto write = [&directory](const string& name, const string& text) {
+            ofstream(directory / (name + ".my"s)) << text;
+        };
+        write("geometry"s, R"--(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+  def __str__():
+    return '(' + str(self.x) + ', ' + str(self.y) + ')'
+)--"s);
+        write("shapes"s, R"--(
+import geometry
+class Segment:
+  def __init__(ax, ay, bx, by):
+    self.a = Point(ax, ay)
+    self.b = Point(bx, by)
+  def __str__():
+    return str(self.a) + '-' + str(self.b)
+)--"s);
+
+        ParserOptions options;
+        options.module_path = { directory / "missing"s, directory };
+        const auto run = [&options](const string& program) {
+            istringstream input(program);
+            parse::Lexer lexer(input);
+            auto tree = ParseProgram(lexer, options);
+            runtime::DummyContext context;
+            runtime::Closure closure;
+            tree->Execute(closure, context);
+            return context.output.str();
+        };
+        const string program = R"--(
+import shapes
+import geometry
+class Labeled(Point):
+  def __str__():
+    return 'L' + str(self.x)
+print Segment(1, 2, 3, 4), Point(5, 6), Labeled(7, 8)
+)--"s;
+
+        parse::ModuleCache::Clear();
+        runtime::Stats::Reset();
+        ASSERT_EQUAL(run(program), "(1, 2)-(3, 4) (5, 6) L7\n"s);
+        // geometry импортируют и shapes, и программа, но разбирается он один раз
+        ASSERT_EQUAL(runtime::Stats::Get().modules_parsed, 2u);
+        ASSERT_EQUAL(runtime::Stats::Get().module_cache_hits, 1u);
+
+        // Следующая программа процесса получает те же разобранные модули
+        runtime::Stats::Reset();
+        ASSERT_EQUAL(run(program), "(1, 2)-(3, 4) (5, 6) L7\n"s);
+        ASSERT_EQUAL(runtime::Stats::Get().modules_parsed, 0u);
+        ASSERT_EQUAL(runtime::Stats::Get().module_cache_hits, 2u);
+
+        // Изменение geometry заново разбирает и его, и импортирующий его shapes
+        write("geometry"s, R"--(
+class Point:
+  def __init__(x, y):
+    self.x = x
+    self.y = y
+  def __str__():
+    return str(self.x) + ':' + str(self.y)
+)--"s);
+        fs::last_write_time(directory / "geometry.my"s, fs::last_write_time(directory / "geometry.my"s) + 1h);
+        runtime::Stats::Reset();
+        ASSERT_EQUAL(run(program), "1:2-3:4 5:6 L7\n"s);
+        ASSERT_EQUAL(runtime::Stats::Get().modules_parsed, 2u);
+
+        // Программа с другими параметрами разбора получает модули, разобранные с её параметрами
+        options.share_identical_subtrees = true;
+        runtime::Stats::Reset();
+        ASSERT_EQUAL(run(program), "1:2-3:4 5:6 L7\n"s);
+        ASSERT_EQUAL(runtime::Stats::Get().modules_parsed, 2u);
+        options.share_identical_subtrees = false;
+        runtime::Stats::Reset();
+        ASSERT_EQUAL(run(program), "1:2-3:4 5:6 L7\n"s);
+        ASSERT_EQUAL(runtime::Stats::Get().modules_parsed, 0u);
+
+        // Экземпляры, не покидающие метод, получают слоты кадров в программе, но не в общем дереве модуля
+        const string local_instance = R"--(
+class Local:
+  def f():
+    p = Point(1, 2)
+    return p.x
+)--"s;
+        write("local"s, "import geometry\n"s + local_instance);
+        const auto count_frame_slots = [](ast::Statement& root) {
+            size_t count = 0;
+            ast::ForEachNode(root, [&count](ast::Statement& node) {
+                if (const auto* instance = dynamic_cast<const ast::NewInstance*>(&node)) {
+                    count += instance->HasFrameSlots() ? 1 : 0;
+                }
+            });
+            return count;
+        };
+        options.frame_slots = true;
+        {
+            istringstream input("import geometry\n"s + local_instance);
+            parse::Lexer lexer(input);
+            ASSERT_EQUAL(count_frame_slots(*ParseProgram(lexer, options)), 1u);
+        }
+        {
+            istringstream input("import local\n"s);
+            parse::Lexer lexer(input);
+            auto tree = ParseProgram(lexer, options);
+            ASSERT_EQUAL(count_frame_slots(*tree), 0u);
+            ASSERT_EQUAL(count_frame_slots(*parse::ModuleCache::Load("local"s, options)->tree), 0u);
+        }
+        runtime::Stats::Reset();
+
+        const auto parse_error = [&run](const string& program) {
+            try {
+                run(program);
+            }
+            catch (const ParseError& e) {
+                return string(e.what());
+            }
+            return ""s;
+        };
+        ASSERT_EQUAL(parse_error("import nothing\n"s), "Module nothing not found"s);
+        ASSERT_EQUAL(parse_error("import geometry\nclass Point:\n  def f():\n    return 1\n"s), "Class Point already exists"s);
+        write("loop"s, "import loop\n"s);
+        ASSERT_EQUAL(parse_error("import loop\n"s), "Module loop: Module loop imports itself"s);
+        write("script"s, "print 1\n"s);
+        ASSERT_EQUAL(parse_error("import script\n"s), "Module script may contain only classes and imports"s);
+
+        options.module_path.clear();
+        ASSERT_EQUAL(parse_error("import geometry\n"s), "Cannot import geometry: module path is not set"s);
+
+        parse::ModuleCache::Clear();
+        fs::remove_all(directory);
+    }
+
+    void TestDeepNesting() {
+        const auto repeat = [](string_view str, size_t count) {
+            string result;
+            for (size_t i = 0; i < count; ++i) {
+                result += str;
+            }
+            return result;
+        };
+
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString("print "s + repeat("("sv, 1000) + "1"s + repeat(")"sv, 1000) + ", "s
+            + repeat("not "sv, 1001) + "False, 1"s + repeat(" + 1"sv, 1000) + "\n"s);
+        tree->Execute(closure, context);
+        ASSERT_EQUAL(context.output.str(), "1 True 1001\n"s);
+
+        // Слишком глубокая вложенность переполнила бы стек при разборе и исполнении
+        ASSERT_THROWS(ParseProgramFromString("print "s + repeat("("sv, 100000) + "1"s + repeat(")"sv, 100000)),
+            ParseError);
+        ASSERT_THROWS(ParseProgramFromString("print "s + repeat("-"sv, 100000) + "1"s), ParseError);
+        ASSERT_THROWS(ParseProgramFromString("print 1"s + repeat(" + 1"sv, 100000)), ParseError);
+    }
+
+    void TestDeepRecursionIsAnError() {
+        const string program = R"(
+class R:
+  def f(n):
+    if n > 0:
+      return self.f(n - 1)
+    return 0
+
+r = R()
+print r.f(1000)
+print r.f(10000000)
+)"s;
+
+        runtime::DummyContext context;
+        runtime::Closure closure;
+        auto tree = ParseProgramFromString(program);
+        try {
+            tree->Execute(closure, context);
+            ASSERT(false);
+        }
+        catch (const runtime_error& e) {
+            ASSERT(string_view(e.what()).substr(0, 32) == "Maximum recursion depth exceeded"sv);
+        }
+        ASSERT_EQUAL(context.output.str(), "0\n"s);
+        ASSERT_EQUAL(runtime::CallStack::GetDepth(), 0u);
+    }
+
+    // Стек потока меньше стека основного потока: граница рекурсии вычисляется по стеку потока
+    void TestDeepRecursionInThread() {
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        pthread_attr_setstacksize(&attributes, size_t{ 4 } << 20);
+        exception_ptr error;
+        pthread_t thread;
+        const int created = pthread_create(&thread, &attributes, [](void* arg) -> void* {
+            try {
+                TestDeepRecursionIsAnError();
+            }
+            catch (...) {
+                *static_cast<exception_ptr*>(arg) = current_exception();
+            }
+            return nullptr;
+        }, &error);
+        pthread_attr_destroy(&attributes);
+        ASSERT_EQUAL(created, 0);
+        pthread_join(thread, nullptr);
+        if (error) {
+            rethrow_exception(error);
+        }
+    }
+
+}  // namespace parse
+
+void TestParseProgram(TestRunner& tr) {
+    RUN_TEST(tr, parse::TestSimpleProgram);
+    RUN_TEST(tr, parse::TestProgramWithClasses);
+    RUN_TEST(tr, parse::TestProgramWithIf);
+    RUN_TEST(tr, parse::TestReturnFromIf);
+    RUN_TEST(tr, parse::TestRecursion);
+    RUN_TEST(tr, parse::TestRecursion2);
+    RUN_TEST(tr, parse::TestComplexLogicalExpression);
+    RUN_TEST(tr, parse::TestClassicalPolymorphism);
+    RUN_TEST(tr, parse::TestSelfInConstructor);
+    RUN_TEST(tr, parse::TestBorrowedReads);
+    RUN_TEST(tr, parse::TestFusedArithmetic);
+    RUN_TEST(tr, parse::TestCopyBuiltin);
+    RUN_TEST(tr, parse::TestNonEscapingInstances);
+    RUN_TEST(tr, parse::TestFrameSlotsKeepBehaviour);
+    RUN_TEST(tr, parse::TestSharedSubtrees);
+    RUN_TEST(tr, parse::TestStaticMethodBinding);
+    RUN_TEST(tr, parse::TestBoundCallChecksClass);
+    RUN_TEST(tr, parse::TestImport);
+    RUN_TEST(tr, parse::TestDeepNesting);
+    RUN_TEST(tr, parse::TestDeepRecursionIsAnError);
+    RUN_TEST(tr, parse::TestDeepRecursionInThread);
 }
\ No newline at end of file
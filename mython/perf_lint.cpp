@@ -0,0 +1,318 @@
+#include "perf_lint.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+
+namespace ast {
+
+    namespace {
+        using ComparatorFunction = bool (*)(const runtime::ObjectHolder&, const runtime::ObjectHolder&, runtime::Context&);
+
+        const string SELF = "self"s;
+        const string INIT_METHOD = "__init__"s;
+        const string LT_METHOD = "__lt__"s;
+
+        // Возвращает исходное дерево операций объединённого арифметического выражения или поддерево,
+        // на которое ссылается SharedNode
+        Statement& Unwrap(Statement& node) {
+            if (auto* fused = dynamic_cast<FusedArithmetic*>(&node)) {
+                return Unwrap(fused->GetExpression());
+            }
+            if (auto* shared = dynamic_cast<SharedNode*>(&node)) {
+                return Unwrap(shared->GetTarget());
+            }
+            return node;
+        }
+
+        bool IsArithmetic(Statement& node) {
+            Statement& expression = Unwrap(node);
+            return dynamic_cast<Add*>(&expression) || dynamic_cast<Sub*>(&expression)
+                || dynamic_cast<Mult*>(&expression) || dynamic_cast<Div*>(&expression);
+        }
+
+        bool IsLiteral(Statement& node) {
+            return dynamic_cast<NumericConst*>(&node) || dynamic_cast<StringConst*>(&node)
+                || dynamic_cast<BoolConst*>(&node) || dynamic_cast<None*>(&node);
+        }
+
+        string JoinIds(const vector<string>& ids) {
+            string result;
+            for (const string& id : ids) {
+                if (!result.empty()) {
+                    result += '.';
+                }
+                result += id;
+            }
+            return result;
+        }
+
+        // Возвращает имена переменной node или пустой вектор, если node - не переменная
+        vector<string> GetIds(Statement& node) {
+            if (auto* variable = dynamic_cast<VariableValue*>(&node)) {
+                return variable->GetIds();
+            }
+            return {};
+        }
+
+        // node - вызов self.method(...)
+        bool IsSelfCall(Statement& node, const string& method) {
+            auto* call = dynamic_cast<MethodCall*>(&node);
+            return call && call->GetMethodName() == method && GetIds(call->GetObject()) == vector{ SELF };
+        }
+
+        bool ContainsSelfCall(Statement& node, const string& method) {
+            bool found = false;
+            ForEachNode(node, [&found, &method](Statement& child) {
+                found = found || IsSelfCall(child, method);
+            });
+            return found;
+        }
+
+        // Собирает слагаемые цепочки сложений слева направо
+        void CollectAddends(Statement& node, vector<Statement*>& addends) {
+            Statement& expression = Unwrap(node);
+            if (auto* add = dynamic_cast<Add*>(&expression)) {
+                CollectAddends(*add->lhs_, addends);
+                CollectAddends(*add->rhs_, addends);
+            }
+            else {
+                addends.push_back(&expression);
+            }
+        }
+
+        // Выражение заведомо строковое: строковая константа, str() или сложение с ними
+        bool IsString(Statement& node) {
+            vector<Statement*> addends;
+            CollectAddends(node, addends);
+            return any_of(addends.begin(), addends.end(), [](Statement* addend) {
+                return dynamic_cast<StringConst*>(addend) || dynamic_cast<Stringify*>(addend);
+            });
+        }
+
+        // value - строковое выражение вида target + ...
+        bool IsStringAccumulation(Statement& value, const vector<string>& target) {
+            vector<Statement*> addends;
+            CollectAddends(value, addends);
+            return addends.size() > 1 && GetIds(*addends.front()) == target && IsString(value);
+        }
+
+        // Класс и его родители не присваивают полям self
+        bool IsStateless(const runtime::Class& cls) {
+            for (const runtime::Class* current = &cls; current != nullptr; current = current->GetParent()) {
+                for (const runtime::Method& method : current->GetMethods()) {
+                    auto* body = dynamic_cast<Statement*>(method.body.get());
+                    if (body == nullptr) {
+                        continue;
+                    }
+                    bool assigns_fields = false;
+                    ForEachNode(*body, [&assigns_fields](Statement& node) {
+                        auto* assignment = dynamic_cast<FieldAssignment*>(&node);
+                        assigns_fields = assigns_fields || (assignment && assignment->GetObject().GetIds() == vector{ SELF });
+                    });
+                    if (assigns_fields) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        class Linter {
+        public:
+            vector<PerfLintWarning> Run(Statement& program) {
+                ForEachNode(program, [this](Statement& node) {
+                    if (auto* definition = dynamic_cast<ClassDefinition*>(&node)) {
+                        has_less_ = has_less_ || definition->GetClass().GetMethod(LT_METHOD) != nullptr;
+                    }
+                });
+                Lint(program, nullptr);
+                stable_sort(warnings_.begin(), warnings_.end(), [](const PerfLintWarning& lhs, const PerfLintWarning& rhs) {
+                    return lhs.line < rhs.line;
+                });
+                return move(warnings_);
+            }
+
+        private:
+            // Анализируемый метод
+            struct MethodScope {
+                const runtime::Class& cls;
+                const runtime::Method& method;
+                // Метод вызывает сам себя
+                bool recursive = false;
+                // Цепочки полей из трёх и более имён: количество вычислений и первая строка
+                map<string, pair<size_t, size_t>> chains;
+
+                [[nodiscard]] string GetName() const {
+                    return cls.GetName() + '.' + method.name;
+                }
+            };
+
+            void Warn(const Statement& node, string check, string message) {
+                warnings_.push_back({ node.GetLine(), move(check), move(message) });
+            }
+
+            void Lint(Statement& node, MethodScope* scope) {
+                if (auto* definition = dynamic_cast<ClassDefinition*>(&node)) {
+                    const runtime::Class& cls = definition->GetClass();
+                    for (const runtime::Method& method : cls.GetMethods()) {
+                        if (auto* body = dynamic_cast<Statement*>(method.body.get())) {
+                            MethodScope method_scope{ cls, method, ContainsSelfCall(*body, method.name), {} };
+                            Lint(*body, &method_scope);
+                            CheckDummyInstances(*body, method_scope);
+                            ReportChains(method_scope);
+                        }
+                    }
+                    return;
+                }
+                Check(node, scope);
+                node.ForEachChild([this, scope](Statement& child) {
+                    Lint(child, scope);
+                });
+            }
+
+            void Check(Statement& node, MethodScope* scope) {
+                if (auto* stringify = dynamic_cast<Stringify*>(&node); stringify && IsString(*stringify->arg_)) {
+                    Warn(node, "redundant-str"s, "str() of a value that is already a string makes a copy"s);
+                }
+                if (auto* comparison = dynamic_cast<Comparison*>(&node)) {
+                    CheckComparison(*comparison);
+                }
+                if (scope == nullptr) {
+                    return;
+                }
+                if (auto* ret = dynamic_cast<Return*>(&node)) {
+                    if (IsArithmetic(ret->GetValue()) && ContainsSelfCall(ret->GetValue(), scope->method.name)) {
+                        Warn(node, "non-tail-recursion"s, "the result of recursive call self."s + scope->method.name
+                            + " is used in arithmetic, so every level waits for the deeper ones; "
+                            "pass the partial result as a parameter and return the call itself"s);
+                    }
+                }
+                if (auto* variable = dynamic_cast<VariableValue*>(&node)) {
+                    const vector<string> ids = variable->GetIds();
+                    if (ids.size() >= 3) {
+                        auto [it, inserted] = scope->chains.emplace(JoinIds(ids), pair{ size_t{ 0 }, node.GetLine() });
+                        ++it->second.first;
+                    }
+                }
+                if (scope->recursive) {
+                    CheckAccumulation(node, *scope);
+                }
+            }
+
+            void CheckComparison(Comparison& comparison) {
+                const auto* function = comparison.GetComparator().target<ComparatorFunction>();
+                if (!has_less_ || function == nullptr) {
+                    return;
+                }
+                Statement& lhs = Unwrap(*comparison.lhs_);
+                Statement& rhs = Unwrap(*comparison.rhs_);
+                if (IsLiteral(lhs) || IsLiteral(rhs) || IsArithmetic(lhs) || IsArithmetic(rhs)) {
+                    return;
+                }
+                if (*function == &runtime::Greater) {
+                    Warn(comparison, "double-compare"s,
+                        "a > b calls both __lt__ and __eq__ for class instances; write b < a"s);
+                }
+                else if (*function == &runtime::LessOrEqual) {
+                    Warn(comparison, "double-compare"s,
+                        "a <= b calls both __lt__ and __eq__ for class instances; write not (b < a)"s);
+                }
+            }
+
+            void CheckAccumulation(Statement& node, const MethodScope& scope) {
+                const string message = " copies the whole accumulated string at every level of recursive method "s
+                    + scope.GetName() + ", so the total time grows quadratically with the depth"s;
+                if (auto* assignment = dynamic_cast<Assignment*>(&node)) {
+                    if (IsStringAccumulation(assignment->GetValue(), { assignment->GetName() })) {
+                        Warn(node, "quadratic-concat"s, assignment->GetName() + " = "s + assignment->GetName() + " + ..."s + message);
+                    }
+                }
+                else if (auto* field_assignment = dynamic_cast<FieldAssignment*>(&node)) {
+                    vector<string> target = field_assignment->GetObject().GetIds();
+                    target.push_back(field_assignment->GetFieldName());
+                    if (IsStringAccumulation(field_assignment->GetValue(), target)) {
+                        const string name = JoinIds(target);
+                        Warn(node, "quadratic-concat"s, name + " = "s + name + " + ..."s + message);
+                    }
+                }
+                else if (IsSelfCall(node, scope.method.name)) {
+                    for (const auto& arg : static_cast<MethodCall&>(node).GetArgs()) {
+                        for (const string& param : scope.method.formal_params) {
+                            if (IsStringAccumulation(*arg, { param })) {
+                                Warn(node, "quadratic-concat"s, "passing "s + param + " + ... to self."s + scope.method.name + message);
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Находит переменные, которым присваивается новый экземпляр класса без состояния и которые
+            // используются только для вызова методов
+            void CheckDummyInstances(Statement& body, const MethodScope& scope) {
+                vector<Assignment*> candidates;
+                ForEachNode(body, [&candidates](Statement& node) {
+                    auto* assignment = dynamic_cast<Assignment*>(&node);
+                    if (assignment == nullptr) {
+                        return;
+                    }
+                    auto* instance = dynamic_cast<NewInstance*>(&assignment->GetValue());
+                    if (instance && instance->GetArgCount() == 0 && instance->GetClass().GetMethod(INIT_METHOD) == nullptr
+                        && IsStateless(instance->GetClass())) {
+                        candidates.push_back(assignment);
+                    }
+                });
+
+                for (Assignment* assignment : candidates) {
+                    const string& name = assignment->GetName();
+                    size_t references = 0;
+                    size_t calls = 0;
+                    ForEachNode(body, [&name, &references, &calls](Statement& node) {
+                        const vector<string> ids = GetIds(node);
+                        if (!ids.empty() && ids.front() == name) {
+                            ++references;
+                        }
+                        if (auto* call = dynamic_cast<MethodCall*>(&node); call && GetIds(call->GetObject()) == vector{ name }) {
+                            ++calls;
+                        }
+                    });
+                    if (calls > 0 && references == calls) {
+                        const string& class_name = static_cast<NewInstance&>(assignment->GetValue()).GetClass().GetName();
+                        Warn(*assignment, "dummy-instance"s, "every call of "s + scope.GetName() + " creates an instance of "s
+                            + class_name + " only to call its methods; "s + class_name
+                            + " has no fields, so create one instance outside and reuse it"s);
+                    }
+                }
+            }
+
+            void ReportChains(const MethodScope& scope) {
+                for (const auto& [chain, usage] : scope.chains) {
+                    const auto [count, line] = usage;
+                    if (count > 1) {
+                        warnings_.push_back({ line, "repeated-chain"s, chain + " is evaluated "s + to_string(count)
+                            + " times in "s + scope.GetName() + "; store it in a local variable"s });
+                    }
+                }
+            }
+
+            bool has_less_ = false;
+            vector<PerfLintWarning> warnings_;
+        };
+    }  // namespace
+
+    vector<PerfLintWarning> PerfLint(Statement& program) {
+        return Linter().Run(program);
+    }
+
+    void WritePerfLintReport(ostream& out, const vector<PerfLintWarning>& warnings) {
+        for (const PerfLintWarning& warning : warnings) {
+            out << "line "sv << warning.line << ": ["sv << warning.check << "] "sv << warning.message << '\n';
+        }
+    }
+
+}  // namespace ast
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "statement.h"
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace ast {
+
+    // Замечание статического анализа производительности
+    struct PerfLintWarning {
+        size_t line = 0;
+        // Краткое имя проверки, например "non-tail-recursion"
+        std::string check;
+        std::string message;
+    };
+
+    /*
+     * Находит в дереве программы конструкции, которые заведомо исполняются медленно:
+     *  - рекурсивный вызов, результат которого используется в арифметике (не хвостовая рекурсия);
+     *  - накопление строки s = s + ... или передача s + ... в рекурсивный вызов (квадратичное копирование);
+     *  - создание экземпляра класса без состояния только для вызова его методов;
+     *  - str() от значения, которое уже является строкой;
+     *  - повторное вычисление одной и той же цепочки полей из трёх и более имён в методе;
+     *  - сравнения > и <=, которые для экземпляров классов вызывают и __lt__, и __eq__.
+     * Замечания упорядочены по номеру строки
+     */
+    [[nodiscard]] std::vector<PerfLintWarning> PerfLint(Statement& program);
+
+    // Выводит замечания в виде "line N: [check] message", по одному в строке
+    void WritePerfLintReport(std::ostream& out, const std::vector<PerfLintWarning>& warnings);
+
+}  // namespace ast
@@ -0,0 +1,121 @@
+#include "profiler.h"
+
+#include <atomic>
+#include <csignal>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/time.h>
+
+using namespace std;
+
+namespace runtime {
+
+	namespace {
+		std::atomic<SamplingProfiler*> active_profiler{ nullptr };
+
+		void SetTimer(std::chrono::microseconds interval) {
+			itimerval timer{};
+			timer.it_interval.tv_sec = static_cast<time_t>(interval.count() / 1'000'000);
+			timer.it_interval.tv_usec = static_cast<suseconds_t>(interval.count() % 1'000'000);
+			timer.it_value = timer.it_interval;
+			setitimer(ITIMER_PROF, &timer, nullptr);
+		}
+	}  // namespace
+
+	SamplingProfiler::SamplingProfiler(std::chrono::microseconds interval, size_t max_frames)
+		:interval_(interval), frames_(max_frames), sample_ends_(max_frames)
+	{
+	}
+
+	SamplingProfiler::~SamplingProfiler() {
+		Stop();
+	}
+
+	void SamplingProfiler::Start() {
+		if (running_) {
+			return;
+		}
+		SamplingProfiler* expected = nullptr;
+		if (!active_profiler.compare_exchange_strong(expected, this)) {
+			throw runtime_error("Another sampling profiler is already running"s);
+		}
+
+		struct sigaction action {};
+		action.sa_handler = &SamplingProfiler::HandleSignal;
+		action.sa_flags = SA_RESTART;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGPROF, &action, &previous_action_);
+
+		running_ = true;
+		SetTimer(interval_);
+	}
+
+	void SamplingProfiler::Stop() {
+		if (!running_) {
+			return;
+		}
+		SetTimer(std::chrono::microseconds{ 0 });
+		// Игнорирование сбрасывает SIGPROF, ожидающий доставки: прежний обработчик его не получит,
+		// а действие по умолчанию не завершит процесс
+		struct sigaction ignore {};
+		ignore.sa_handler = SIG_IGN;
+		sigemptyset(&ignore.sa_mask);
+		sigaction(SIGPROF, &ignore, nullptr);
+		sigaction(SIGPROF, &previous_action_, nullptr);
+		active_profiler.store(nullptr);
+		running_ = false;
+	}
+
+	void SamplingProfiler::HandleSignal(int /*signal*/) {
+		if (SamplingProfiler* profiler = active_profiler.load(std::memory_order_relaxed)) {
+			profiler->TakeSample();
+		}
+	}
+
+	void SamplingProfiler::TakeSample() {
+		// Вызывается из обработчика сигнала: никаких выделений памяти и блокировок
+		size_t frames_used = frames_used_.load(std::memory_order_relaxed);
+		const size_t available = frames_.size() - frames_used;
+		if (available < CallStack::MAX_DEPTH && available < CallStack::GetDepth() + 1) {
+			dropped_count_.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		frames_used += CallStack::Snapshot(frames_.data() + frames_used, available);
+		frames_used_.store(frames_used, std::memory_order_relaxed);
+		const size_t sample = sample_count_.load(std::memory_order_relaxed);
+		sample_ends_[sample] = frames_used;
+		sample_count_.store(sample + 1, std::memory_order_release);
+	}
+
+	void SamplingProfiler::WriteFolded(std::ostream& out) const {
+		map<string, size_t> stacks;
+		size_t begin = 0;
+		const size_t sample_count = sample_count_.load(std::memory_order_acquire);
+		for (size_t i = 0; i < sample_count; ++i) {
+			string stack;
+			for (size_t j = begin; j < sample_ends_[i]; ++j) {
+				if (j != begin) {
+					stack += ';';
+				}
+				stack += CallStack::FrameName(frames_[j]) + ':' + to_string(frames_[j].line);
+			}
+			++stacks[stack];
+			begin = sample_ends_[i];
+		}
+		for (const auto& [stack, count] : stacks) {
+			out << stack << ' ' << count << '\n';
+		}
+	}
+
+	size_t SamplingProfiler::GetSampleCount() const {
+		return sample_count_.load(std::memory_order_acquire);
+	}
+
+	size_t SamplingProfiler::GetDroppedCount() const {
+		return dropped_count_.load(std::memory_order_relaxed);
+	}
+
+}  // namespace runtime
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "call_stack.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iosfwd>
+#include <vector>
+
+namespace runtime {
+
+    /*
+     * Семплирующий профилировщик. По сигналу SIGPROF таймера setitimer сохраняет снимок теневого
+     * стека вызовов Mython (CallStack) в заранее выделенный буфер. Накопленные семплы выводятся
+     * в формате "folded stacks", который понимают flamegraph.pl и speedscope.
+     * Одновременно может работать только один профилировщик.
+     */
+    class SamplingProfiler {
+    public:
+        explicit SamplingProfiler(std::chrono::microseconds interval = std::chrono::microseconds{ 1000 },
+            size_t max_frames = size_t{ 1 } << 20);
+
+        SamplingProfiler(const SamplingProfiler&) = delete;
+        SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+        ~SamplingProfiler();
+
+        // Запускает таймер. Выбрасывает runtime_error, если уже работает другой профилировщик
+        void Start();
+        // Останавливает таймер и восстанавливает обработчик SIGPROF, действовавший до Start.
+        // Собранные семплы сохраняются
+        void Stop();
+
+        // Выводит в out по строке на каждый уникальный стек:
+        // "<module>:3;Point.Move:12;Point.Check:20 57"
+        // Семплы ссылаются на классы и методы программы, поэтому программа должна быть ещё жива
+        void WriteFolded(std::ostream& out) const;
+
+        [[nodiscard]] size_t GetSampleCount() const;
+        // Возвращает количество семплов, не поместившихся в буфер
+        [[nodiscard]] size_t GetDroppedCount() const;
+
+    private:
+        static void HandleSignal(int signal);
+        void TakeSample();
+
+        std::chrono::microseconds interval_;
+        std::vector<Frame> frames_;
+        // sample_ends_[i] - индекс в frames_, следующий за последним кадром i-го семпла
+        std::vector<size_t> sample_ends_;
+        // Счётчики изменяет обработчик сигнала, а читает основной код. Семпл становится видим
+        // читателю после увеличения sample_count_
+        std::atomic<size_t> frames_used_{ 0 };
+        std::atomic<size_t> sample_count_{ 0 };
+        std::atomic<size_t> dropped_count_{ 0 };
+        bool running_ = false;
+        struct sigaction previous_action_ {};
+
+        static_assert(std::atomic<size_t>::is_always_lock_free, "signal handler needs lock-free counters");
+    };
+
+}  // namespace runtime
@@ -1,197 +1,272 @@
-#include "runtime.h"
-
-#include <cassert>
-#include <optional>
-#include <sstream>
-
-using namespace std;
-
-namespace runtime {
-
-	ObjectHolder::ObjectHolder(std::shared_ptr<Object> data)
-		: data_(std::move(data)) {
-	}
-
-	void ObjectHolder::AssertIsValid() const {
-		assert(data_ != nullptr);
-	}
-
-	ObjectHolder ObjectHolder::Share(Object& object) {
-		//   shared_ptr ( deleter   )
-		return ObjectHolder(std::shared_ptr<Object>(&object, [](auto* /*p*/) { /* do nothing */ }));
-	}
-
-	ObjectHolder ObjectHolder::None() {
-		return ObjectHolder();
-	}
-
-	Object& ObjectHolder::operator*() const {
-		AssertIsValid();
-		return *Get();
-	}
-
-	Object* ObjectHolder::operator->() const {
-		AssertIsValid();
-		return Get();
-	}
-
-	Object* ObjectHolder::Get() const {
-		return data_.get();
-	}
-
-	ObjectHolder::operator bool() const {
-		return Get() != nullptr;
-	}
-
-	bool IsTrue(const ObjectHolder& obj) {
-		if (!obj) {
-			return false;
-		}
-		else {
-			if (obj.TryAs<Bool>()) {
-				return obj.TryAs<Bool>()->GetValue();
-			}
-			else if (obj.TryAs<Number>()) {
-				return obj.TryAs<Number>()->GetValue() != 0;
-			}
-			else if (obj.TryAs<String>()) {
-				return !obj.TryAs<String>()->GetValue().empty();
-			}
-			else if (obj.TryAs<Class>()) {
-				return false;
-			}
-			else if (obj.TryAs<ClassInstance>()) {
-				return false;
-			}
-
-		}
-		return true;
-	}
-
-	void ClassInstance::Print(std::ostream& os, Context& context) {
-		const string str_method = "__str__"s;
-		if (HasMethod(str_method, 0)) {
-			Call(str_method, {}, context)->Print(os, context);
-		}
-		else {
-			os << this;
-		}
-	}
-
-	bool ClassInstance::HasMethod(const std::string& method, size_t argument_count) const {
-		auto* p_method = cls_.GetMethod(method);
-		return p_method && p_method->formal_params.size() == argument_count;
-	}
-
-	Closure& ClassInstance::Fields() {
-		return closure_;
-	}
-
-	const Closure& ClassInstance::Fields() const {
-		return closure_;
-	}
-
-	ClassInstance::ClassInstance(const Class& cls)
-		:cls_(cls)
-	{
-	}
-
-	ObjectHolder ClassInstance::Call(const std::string& method,
-		const std::vector<ObjectHolder>& actual_args,
-		Context& context) {
-		if (!HasMethod(method, actual_args.size())) {
-			throw std::runtime_error("Error call "s + method + "."s);
-		}
-		auto* p_method = cls_.GetMethod(method);
-		Closure locals;
-		locals["self"s] = ObjectHolder::Share(*this);
-		for (size_t i = 0; i < p_method->formal_params.size(); ++i) {
-			locals[p_method->formal_params.at(i)] = actual_args.at(i);
-		}
-		return p_method->body->Execute(locals, context);
-	}
-
-	Class::Class(std::string name, std::vector<Method> methods, const Class* parent)
-		:name_(std::move(name)), methods_(std::move(methods)), parent_(parent)
-			{
-				for (size_t i = 0; i < methods_.size(); ++i) {
-					methods_map_[methods_.at(i).name] = i;
-				}
-			}
-
-			const Method* Class::GetMethod(const std::string& name) const {
-				if (methods_map_.count(name)) {
-					return &methods_.at(methods_map_.at(name));
-				}
-				else if (parent_) {
-					return parent_->GetMethod(name);
-				}
-				return nullptr;
-			}
-
-			[[nodiscard]] const std::string& Class::GetName() const {
-				return name_;
-			}
-
-			void Class::Print(ostream& os, [[maybe_unused]] Context& context) {
-				os << "Class "sv << name_;
-			}
-
-			void Bool::Print(std::ostream & os, [[maybe_unused]] Context & context) {
-				os << (GetValue() ? "True"sv : "False"sv);
-			}
-
-			bool Equal(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
-				if (lhs.TryAs<Bool>() && rhs.TryAs<Bool>()) {
-					return lhs.TryAs<Bool>()->GetValue() == rhs.TryAs<Bool>()->GetValue();
-				}
-				if (lhs.TryAs<Number>() && rhs.TryAs<Number>()) {
-					return lhs.TryAs<Number>()->GetValue() == rhs.TryAs<Number>()->GetValue();
-				}
-				if (lhs.TryAs<String>() && rhs.TryAs<String>()) {
-					return lhs.TryAs<String>()->GetValue() == rhs.TryAs<String>()->GetValue();
-				}
-				const string EQ_METHOD = "__eq__"s;
-				if (lhs.TryAs<ClassInstance>() && lhs.TryAs<ClassInstance>()->HasMethod(EQ_METHOD, 1)) {
-					return lhs.TryAs<ClassInstance>()->Call(EQ_METHOD, { rhs }, context).TryAs<Bool>()->GetValue();
-				}
-				if (!lhs.operator bool() && !rhs.operator bool()) {
-					return true;
-				}
-				throw std::runtime_error("Cannot compare objects for equality"s);
-			}
-
-			bool Less(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
-				if (lhs.TryAs<Bool>() && rhs.TryAs<Bool>()) {
-					return lhs.TryAs<Bool>()->GetValue() < rhs.TryAs<Bool>()->GetValue();
-				}
-				if (lhs.TryAs<Number>() && rhs.TryAs<Number>()) {
-					return lhs.TryAs<Number>()->GetValue() < rhs.TryAs<Number>()->GetValue();
-				}
-				if (lhs.TryAs<String>() && rhs.TryAs<String>()) {
-					return lhs.TryAs<String>()->GetValue() < rhs.TryAs<String>()->GetValue();
-				}
-				const string LT_METHOD = "__lt__"s;
-				if (lhs.TryAs<ClassInstance>() && lhs.TryAs<ClassInstance>()->HasMethod(LT_METHOD, 1)) {
-					return lhs.TryAs<ClassInstance>()->Call(LT_METHOD, { rhs }, context).TryAs<Bool>()->GetValue();
-				}
-				throw std::runtime_error("Cannot compare objects for less"s);
-			}
-
-			bool NotEqual(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
-				return !Equal(lhs, rhs, context);
-			}
-
-			bool Greater(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
-				return !Less(lhs, rhs, context) && NotEqual(lhs, rhs, context);
-			}
-
-			bool LessOrEqual(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
-				return !Greater(lhs, rhs, context);
-			}
-
-			bool GreaterOrEqual(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
-				return !Less(lhs, rhs, context);
-			}
-
+#include "runtime.h"
+
+#include "call_stack.h"
+#include "str_cache.h"
+
+#include <cassert>
+#include <optional>
+#include <sstream>
+
+using namespace std;
+
+namespace runtime {
+
+	ObjectHolder::ObjectHolder(std::shared_ptr<Object> data)
+		: data_(std::move(data)) {
+	}
+
+	void ObjectHolder::AssertIsValid() const {
+		assert(data_ != nullptr);
+	}
+
+	ObjectHolder ObjectHolder::Share(Object& object) {
+		// Невладеющий shared_ptr: конструктор псевдонима с пустым владельцем не создаёт блок управления
+		return ObjectHolder(std::shared_ptr<Object>(std::shared_ptr<Object>(), &object));
+	}
+
+	void ObjectHolder::Retain() {
+		if (data_ && data_.use_count() == 0) {
+			if (std::shared_ptr<Object> owner = data_->weak_from_this().lock()) {
+				data_ = std::move(owner);
+			}
+		}
+	}
+
+	ObjectHolder ObjectHolder::None() {
+		return ObjectHolder();
+	}
+
+	Object& ObjectHolder::operator*() const {
+		AssertIsValid();
+		return *Get();
+	}
+
+	Object* ObjectHolder::operator->() const {
+		AssertIsValid();
+		return Get();
+	}
+
+	Object* ObjectHolder::Get() const {
+		return data_.get();
+	}
+
+	ObjectHolder::operator bool() const {
+		return Get() != nullptr;
+	}
+
+	bool ObjectHolder::IsUnique() const {
+		return data_.use_count() == 1;
+	}
+
+	bool IsTrue(const ObjectHolder& obj) {
+		if (!obj) {
+			return false;
+		}
+		else {
+			if (obj.TryAs<Bool>()) {
+				return obj.TryAs<Bool>()->GetValue();
+			}
+			else if (obj.TryAs<Number>()) {
+				return obj.TryAs<Number>()->GetValue() != 0;
+			}
+			else if (obj.TryAs<String>()) {
+				return !obj.TryAs<String>()->GetValue().empty();
+			}
+			else if (obj.TryAs<Class>()) {
+				return false;
+			}
+			else if (obj.TryAs<ClassInstance>()) {
+				return false;
+			}
+
+		}
+		return true;
+	}
+
+	void ClassInstance::Print(std::ostream& os, Context& context) {
+		const string str_method = "__str__"s;
+		if (HasMethod(str_method, 0)) {
+			if (StrCache::IsEnabled()) {
+				StrCache::Print(*this, os, context);
+				return;
+			}
+			Call(str_method, {}, context)->Print(os, context);
+		}
+		else {
+			++Stats::Get().addresses_printed;
+			os << this;
+		}
+	}
+
+	bool ClassInstance::HasMethod(const std::string& method, size_t argument_count) const {
+		auto* p_method = cls_.GetMethod(method);
+		return p_method && p_method->formal_params.size() == argument_count;
+	}
+
+	const Class& ClassInstance::GetClass() const {
+		return cls_;
+	}
+
+	Closure& ClassInstance::Fields() {
+		if (closure_.use_count() > 1) {
+			++Stats::Get().field_copies;
+			closure_ = make_shared<Closure>(*closure_);
+		}
+		return *closure_;
+	}
+
+	const Closure& ClassInstance::Fields() const {
+		return *closure_;
+	}
+
+	void ClassInstance::ResetFields() {
+		if (closure_.use_count() > 1) {
+			closure_ = make_shared<Closure>();
+		}
+		else {
+			closure_->clear();
+		}
+		BumpFieldVersion();
+	}
+
+	ClassInstance::ClassInstance(const Class& cls)
+		:cls_(cls), closure_(make_shared<Closure>())
+	{
+	}
+
+	ClassInstance::ClassInstance(const ClassInstance& other)
+		:Object(other), cls_(other.cls_), closure_(other.closure_)
+	{
+	}
+
+	ClassInstance::ClassInstance(ClassInstance&& other) noexcept = default;
+
+	ClassInstance::~ClassInstance() = default;
+
+	void ClassInstance::SetStrCache(StrCacheEntry entry) {
+		str_cache_ = make_unique<StrCacheEntry>(move(entry));
+	}
+
+	void ClassInstance::ResetStrCache() {
+		str_cache_.reset();
+	}
+
+	ObjectHolder ClassInstance::Call(const std::string& method,
+		const std::vector<ObjectHolder>& actual_args,
+		Context& context) {
+		if (!HasMethod(method, actual_args.size())) {
+			throw std::runtime_error("Error call "s + method + "."s);
+		}
+		return Call(*cls_.GetMethod(method), actual_args, context);
+	}
+
+	ObjectHolder ClassInstance::Call(const Method& method, const std::vector<ObjectHolder>& actual_args,
+		Context& context) {
+		CallStack::Guard frame(cls_, method, actual_args);
+		CallHooksScope<ExecutionHooks> hooks(*this, method, actual_args);
+		Counters& counters = Stats::Get();
+		++counters.method_calls;
+		Closure locals;
+		locals["self"s] = ObjectHolder::Share(*this);
+		for (size_t i = 0; i < method.formal_params.size(); ++i) {
+			locals[method.formal_params.at(i)] = actual_args.at(i);
+		}
+		counters.closure_inserts += method.formal_params.size() + 1;
+		return method.body->Execute(locals, context);
+	}
+
+	Class::Class(std::string name, std::vector<Method> methods, const Class* parent)
+		:name_(std::move(name)), methods_(std::move(methods)), parent_(parent)
+			{
+				for (size_t i = 0; i < methods_.size(); ++i) {
+					methods_map_[methods_.at(i).name] = i;
+				}
+			}
+
+			const Method* Class::GetMethod(const std::string& name) const {
+				++Stats::Get().method_lookups;
+				for (const Class* cls = this; cls != nullptr; cls = cls->parent_) {
+					if (cls->methods_map_.count(name)) {
+						return &cls->methods_.at(cls->methods_map_.at(name));
+					}
+					if (cls->parent_) {
+						++Stats::Get().method_lookup_hops;
+					}
+				}
+				return nullptr;
+			}
+
+			[[nodiscard]] const std::string& Class::GetName() const {
+				return name_;
+			}
+
+			const std::vector<Method>& Class::GetMethods() const {
+				return methods_;
+			}
+
+			const Class* Class::GetParent() const {
+				return parent_;
+			}
+
+			void Class::Print(ostream& os, [[maybe_unused]] Context& context) {
+				os << "Class "sv << name_;
+			}
+
+			void Bool::Print(std::ostream & os, [[maybe_unused]] Context & context) {
+				os << (GetValue() ? "True"sv : "False"sv);
+			}
+
+			bool Equal(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
+				if (lhs.TryAs<Bool>() && rhs.TryAs<Bool>()) {
+					return lhs.TryAs<Bool>()->GetValue() == rhs.TryAs<Bool>()->GetValue();
+				}
+				if (lhs.TryAs<Number>() && rhs.TryAs<Number>()) {
+					return lhs.TryAs<Number>()->GetValue() == rhs.TryAs<Number>()->GetValue();
+				}
+				if (lhs.TryAs<String>() && rhs.TryAs<String>()) {
+					return lhs.TryAs<String>()->GetValue() == rhs.TryAs<String>()->GetValue();
+				}
+				const string EQ_METHOD = "__eq__"s;
+				if (lhs.TryAs<ClassInstance>() && lhs.TryAs<ClassInstance>()->HasMethod(EQ_METHOD, 1)) {
+					return lhs.TryAs<ClassInstance>()->Call(EQ_METHOD, vector<ObjectHolder>(1, rhs), context).TryAs<Bool>()->GetValue();
+				}
+				if (!lhs.operator bool() && !rhs.operator bool()) {
+					return true;
+				}
+				throw std::runtime_error("Cannot compare objects for equality"s);
+			}
+
+			bool Less(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
+				if (lhs.TryAs<Bool>() && rhs.TryAs<Bool>()) {
+					return lhs.TryAs<Bool>()->GetValue() < rhs.TryAs<Bool>()->GetValue();
+				}
+				if (lhs.TryAs<Number>() && rhs.TryAs<Number>()) {
+					return lhs.TryAs<Number>()->GetValue() < rhs.TryAs<Number>()->GetValue();
+				}
+				if (lhs.TryAs<String>() && rhs.TryAs<String>()) {
+					return lhs.TryAs<String>()->GetValue() < rhs.TryAs<String>()->GetValue();
+				}
+				const string LT_METHOD = "__lt__"s;
+				if (lhs.TryAs<ClassInstance>() && lhs.TryAs<ClassInstance>()->HasMethod(LT_METHOD, 1)) {
+					return lhs.TryAs<ClassInstance>()->Call(LT_METHOD, vector<ObjectHolder>(1, rhs), context).TryAs<Bool>()->GetValue();
+				}
+				throw std::runtime_error("Cannot compare objects for less"s);
+			}
+
+			bool NotEqual(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
+				return !Equal(lhs, rhs, context);
+			}
+
+			bool Greater(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
+				return !Less(lhs, rhs, context) && NotEqual(lhs, rhs, context);
+			}
+
+			bool LessOrEqual(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
+				return !Greater(lhs, rhs, context);
+			}
+
+			bool GreaterOrEqual(const ObjectHolder & lhs, const ObjectHolder & rhs, Context & context) {
+				return !Less(lhs, rhs, context);
+			}
+
 	}  // namespace runtime
\ No newline at end of file
@@ -1,241 +1,443 @@
-#pragma once
-
-#include <memory>
-#include <sstream>
-#include <string>
-#include <unordered_map>
-#include <vector>
-
-namespace runtime {
-
-    //    Mython
-    class Context {
-    public:
-        //      print
-        virtual std::ostream& GetOutputStream() = 0;
-
-    protected:
-        ~Context() = default;
-    };
-
-    //       Mython
-    class Object {
-    public:
-        virtual ~Object() = default;
-        //   os     
-        virtual void Print(std::ostream& os, Context& context) = 0;
-    };
-
-    //  -,      Mython-
-    class ObjectHolder {
-    public:
-        //   
-        ObjectHolder() = default;
-
-        //  ObjectHolder,    T
-        //  T -  - Object.
-        // object     
-        template <typename T>
-        [[nodiscard]] static ObjectHolder Own(T&& object) {
-            return ObjectHolder(std::make_shared<T>(std::forward<T>(object)));
-        }
-
-        //  ObjectHolder,    (  )
-        [[nodiscard]] static ObjectHolder Share(Object& object);
-        //   ObjectHolder,   None
-        [[nodiscard]] static ObjectHolder None();
-
-        //    Object  ObjectHolder.
-        // ObjectHolder   
-        Object& operator*() const;
-
-        Object* operator->() const;
-
-        [[nodiscard]] Object* Get() const;
-
-        //      T  nullptr,   ObjectHolder  
-        //   
-        template <typename T>
-        [[nodiscard]] T* TryAs() const {
-            return dynamic_cast<T*>(this->Get());
-        }
-
-        //  true,  ObjectHolder  
-        explicit operator bool() const;
-
-    private:
-        explicit ObjectHolder(std::shared_ptr<Object> data);
-        void AssertIsValid() const;
-
-        std::shared_ptr<Object> data_;
-    };
-
-    // -,    T
-    template <typename T>
-    class ValueObject : public Object {
-    public:
-        ValueObject(T v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
-            : value_(v) {
-        }
-
-        void Print(std::ostream& os, [[maybe_unused]] Context& context) override {
-            os << value_;
-        }
-
-        [[nodiscard]] const T& GetValue() const {
-            return value_;
-        }
-
-    private:
-        T value_;
-    };
-
-    //  ,      
-    using Closure = std::unordered_map<std::string, ObjectHolder>;
-
-    // ,    object ,   True
-    //     , True     true.    - false.
-    bool IsTrue(const ObjectHolder& object);
-
-    //       Mython
-    class Executable {
-    public:
-        virtual ~Executable() = default;
-        //      closure,  context
-        //     None
-        virtual ObjectHolder Execute(Closure& closure, Context& context) = 0;
-    };
-
-    //  
-    using String = ValueObject<std::string>;
-    //  
-    using Number = ValueObject<int>;
-
-    //  
-    class Bool : public ValueObject<bool> {
-    public:
-        using ValueObject<bool>::ValueObject;
-
-        void Print(std::ostream& os, Context& context) override;
-    };
-
-    //  
-    struct Method {
-        //  
-        std::string name;
-        //    
-        std::vector<std::string> formal_params;
-        //  
-        std::unique_ptr<Executable> body;
-    };
-
-    // 
-    class Class : public Object {
-    public:
-        //     name    methods,    parent
-        //  parent  nullptr,    
-        explicit Class(std::string name, std::vector<Method> methods, const Class* parent);
-
-        //     name  nullptr,      
-        [[nodiscard]] const Method* GetMethod(const std::string& name) const;
-
-        //   
-        [[nodiscard]] const std::string& GetName() const;
-
-        //   os  "Class < >",  "Class cat"
-        void Print(std::ostream& os, Context& context) override;
-
-    private:
-        std::string name_;
-        std::vector<Method> methods_;
-        const Class* parent_;
-        std::unordered_map<std::string_view, size_t> methods_map_;
-    };
-
-    //  
-    class ClassInstance : public Object {
-    public:
-        explicit ClassInstance(const Class& cls);
-
-        /*
-         *      __str__,   os ,   .
-         *     os   .
-         */
-        void Print(std::ostream& os, Context& context) override;
-
-        /*
-         *     method,   actual_args .
-         *  context     .
-         *    ,       method,   
-         * runtime_error
-         */
-        ObjectHolder Call(const std::string& method, const std::vector<ObjectHolder>& actual_args,
-            Context& context);
-
-        //  true,     method,  argument_count 
-        [[nodiscard]] bool HasMethod(const std::string& method, size_t argument_count) const;
-
-        //    Closure,   
-        [[nodiscard]] Closure& Fields();
-        //     Closure,   
-        [[nodiscard]] const Closure& Fields() const;
-
-    private:
-        const Class& cls_;
-        Closure closure_;
-    };
-
-    /*
-     *  true,  lhs  rhs   ,     Bool.
-     *  lhs -    __eq__,     lhs.__eq__(rhs),
-     *    Bool.  lhs  rhs   None,   true.
-     *       runtime_error.
-     *
-     *  context      __eq__
-     */
-    bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
-
-    /*
-     *  lhs  rhs - ,    bool,     
-     *  <.
-     *  lhs -    __lt__,    lhs.__lt__(rhs),
-     *    bool.       runtime_error.
-     *
-     *  context      __lt__
-     */
-    bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
-    //  ,  Equal(lhs, rhs, context)
-    bool NotEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
-    //   lhs>rhs,   Equal  Less
-    bool Greater(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
-    //   lhs<=rhs,   Equal  Less
-    bool LessOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
-    //  ,  Less(lhs, rhs, context)
-    bool GreaterOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
-
-    // -,   .
-    //           output
-    struct DummyContext : Context {
-        std::ostream& GetOutputStream() override {
-            return output;
-        }
-
-        std::ostringstream output;
-    };
-
-    //  ,       output,   
-    class SimpleContext : public runtime::Context {
-    public:
-        explicit SimpleContext(std::ostream& output)
-            : output_(output) {
-        }
-
-        std::ostream& GetOutputStream() override {
-            return output_;
-        }
-
-    private:
-        std::ostream& output_;
-    };
-
-}  // namespace runtime
+#pragma once
+
+#include "heap_census.h"
+#include "hooks.h"
+#include "stats.h"
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace runtime {
+
+    // Контекст исполнения инструкций Mython
+    class Context {
+    public:
+        // Возвращает поток вывода для команд print
+        virtual std::ostream& GetOutputStream() = 0;
+
+    protected:
+        ~Context() = default;
+    };
+
+    // Базовый класс для всех объектов языка Mython. Объект, созданный ObjectHolder::Own, может
+    // получить владеющую ссылку на себя, что позволяет сохранять невладеющие ссылки (см. Retain)
+    class Object : public std::enable_shared_from_this<Object> {
+    public:
+        virtual ~Object() {
+            if (HeapCensus::IsEnabled()) {
+                HeapCensus::Untrack(this);
+            }
+        }
+        // выводит в os своё представление в виде строки
+        virtual void Print(std::ostream& os, Context& context) = 0;
+    };
+
+    // Специальный класс-обёртка, предназначенный для хранения объекта в Mython-программе
+    class ObjectHolder {
+    public:
+        // Создаёт пустое значение
+        ObjectHolder() = default;
+
+        ObjectHolder(const ObjectHolder& other)
+            : data_(other.data_) {
+            ++Stats::Get().holder_copies;
+        }
+
+        ObjectHolder& operator=(const ObjectHolder& other) {
+            ++Stats::Get().holder_copies;
+            data_ = other.data_;
+            return *this;
+        }
+
+        ObjectHolder(ObjectHolder&&) = default;
+        ObjectHolder& operator=(ObjectHolder&&) = default;
+
+        // Возвращает ObjectHolder, владеющий объектом типа T
+        // Тип T - конкретный класс-наследник Object.
+        // object копируется или перемещается в кучу
+        template <typename T>
+        [[nodiscard]] static ObjectHolder Own(T&& object) {
+            constexpr ObjectKind kind = ObjectKindOf<std::decay_t<T>>::value;
+            ++Stats::Get().objects_allocated[static_cast<size_t>(kind)];
+            auto data = std::make_shared<T>(std::forward<T>(object));
+            if (HeapCensus::IsEnabled()) {
+                HeapCensus::Track(*data, kind);
+            }
+            ExecutionHooks::OnAlloc(*data, kind);
+            return ObjectHolder(std::move(data));
+        }
+
+        // Создаёт ObjectHolder, не владеющий объектом (аналог слабой ссылки).
+        // Создание и копирование такого ObjectHolder не выделяет память и не меняет счётчик ссылок
+        [[nodiscard]] static ObjectHolder Share(Object& object);
+        // Создаёт пустой ObjectHolder, соответствующий значению None
+        [[nodiscard]] static ObjectHolder None();
+
+        // Возвращает ссылку на Object внутри ObjectHolder.
+        // ObjectHolder должен быть непустым
+        Object& operator*() const;
+
+        Object* operator->() const;
+
+        [[nodiscard]] Object* Get() const;
+
+        // Возвращает указатель на объект типа T либо nullptr, если внутри ObjectHolder не хранится
+        // объект данного типа
+        template <typename T>
+        [[nodiscard]] T* TryAs() const {
+            return dynamic_cast<T*>(this->Get());
+        }
+
+        // Возвращает true, если ObjectHolder не пуст
+        explicit operator bool() const;
+
+        // Возвращает true, если это единственный владеющий ObjectHolder объекта
+        [[nodiscard]] bool IsUnique() const;
+
+        // Делает невладеющий ObjectHolder владеющим, если объект создан ObjectHolder::Own.
+        // Вызывается при сохранении значения в переменной или поле и при возврате из метода:
+        // сохранённая или возвращённая ссылка на self не должна пережить объект
+        void Retain();
+
+    private:
+        explicit ObjectHolder(std::shared_ptr<Object> data);
+        void AssertIsValid() const;
+
+        std::shared_ptr<Object> data_;
+    };
+
+    // Объект-значение, хранящий значение типа T
+    template <typename T>
+    class ValueObject : public Object {
+    public:
+        ValueObject(T v)  // NOLINT(google-explicit-constructor,hicpp-explicit-conversions)
+            : value_(v) {
+        }
+
+        void Print(std::ostream& os, [[maybe_unused]] Context& context) override {
+            os << value_;
+        }
+
+        [[nodiscard]] const T& GetValue() const {
+            return value_;
+        }
+
+    private:
+        T value_;
+    };
+
+    /*
+     * Таблица символов, связывающая имя объекта с его значением.
+     * Значения хранятся в узлах unordered_map и не перемещаются при добавлении других имён, поэтому
+     * узлы AST запоминают адрес найденного значения (ячейку) вместе с поколением таблицы. Поколение -
+     * глобально уникальный номер, который таблица получает при создании и заново при удалении имён
+     * (erase, clear, присваивание). Пока поколение не изменилось, запомненная ячейка действительна.
+     * Таблица наследует unordered_map закрыто: доступны только операции, не удаляющие узлы, а удаление
+     * всегда проходит через методы таблицы, обновляющие поколение.
+     */
+    class Closure : private std::unordered_map<std::string, ObjectHolder> {
+        using Base = std::unordered_map<std::string, ObjectHolder>;
+
+    public:
+        using Base::Base;
+
+        using typename Base::key_type;
+        using typename Base::mapped_type;
+        using typename Base::value_type;
+        using typename Base::size_type;
+        using typename Base::iterator;
+        using typename Base::const_iterator;
+
+        using Base::begin;
+        using Base::end;
+        using Base::cbegin;
+        using Base::cend;
+        using Base::empty;
+        using Base::size;
+        using Base::bucket_count;
+        using Base::find;
+        using Base::count;
+        using Base::at;
+        using Base::operator[];
+        using Base::insert;
+        using Base::insert_or_assign;
+        using Base::emplace;
+        using Base::try_emplace;
+        using Base::reserve;
+
+        Closure() = default;
+        Closure(const Closure& other)
+            : Base(other) {
+        }
+        Closure(Closure&& other) noexcept
+            : Base(std::move(other)) {
+            other.Renew();
+        }
+
+        Closure& operator=(const Closure& other) {
+            Base::operator=(other);
+            Renew();
+            return *this;
+        }
+        Closure& operator=(Closure&& other) noexcept {
+            Base::operator=(std::move(other));
+            Renew();
+            other.Renew();
+            return *this;
+        }
+
+        template <typename Key>
+        auto erase(Key&& key) -> decltype(Base::erase(std::forward<Key>(key))) {
+            Renew();
+            return Base::erase(std::forward<Key>(key));
+        }
+
+        iterator erase(const_iterator first, const_iterator last) {
+            Renew();
+            return Base::erase(first, last);
+        }
+
+        void clear() noexcept {
+            Renew();
+            Base::clear();
+        }
+
+        [[nodiscard]] uint64_t GetGeneration() const {
+            return generation_;
+        }
+
+    private:
+        void Renew() {
+            generation_ = ++last_generation_;
+        }
+
+        inline static uint64_t last_generation_ = 0;
+        uint64_t generation_ = ++last_generation_;
+    };
+
+    // Проверяет, содержится ли в object значение, приводимое к True
+    // Для отличных от нуля чисел, True и непустых строк возвращается true. В остальных случаях - false.
+    bool IsTrue(const ObjectHolder& object);
+
+    // Интерфейс для выполнения действий над объектами Mython
+    class Executable {
+    public:
+        virtual ~Executable() = default;
+        // Выполняет действие над объектами внутри closure, используя context
+        // Возвращает результирующее значение либо None
+        virtual ObjectHolder Execute(Closure& closure, Context& context) = 0;
+    };
+
+    // Строковое значение
+    using String = ValueObject<std::string>;
+    // Числовое значение
+    using Number = ValueObject<std::int64_t>;
+
+    // Логическое значение
+    class Bool : public ValueObject<bool> {
+    public:
+        using ValueObject<bool>::ValueObject;
+
+        void Print(std::ostream& os, Context& context) override;
+    };
+
+    // Метод класса
+    struct Method {
+        // Имя метода
+        std::string name;
+        // Имена формальных параметров метода
+        std::vector<std::string> formal_params;
+        // Тело метода
+        std::unique_ptr<Executable> body;
+    };
+
+    // Класс
+    class Class : public Object {
+    public:
+        // Создаёт класс с именем name и набором методов methods, унаследованный от класса parent
+        // Если parent равен nullptr, то создаётся базовый класс
+        explicit Class(std::string name, std::vector<Method> methods, const Class* parent);
+
+        // Возвращает указатель на метод name или nullptr, если метод с таким именем отсутствует
+        [[nodiscard]] const Method* GetMethod(const std::string& name) const;
+
+        // Возвращает имя класса
+        [[nodiscard]] const std::string& GetName() const;
+
+        // Возвращает методы, объявленные в самом классе (без унаследованных)
+        [[nodiscard]] const std::vector<Method>& GetMethods() const;
+
+        // Возвращает родительский класс или nullptr
+        [[nodiscard]] const Class* GetParent() const;
+
+        // Выводит в os строку "Class <имя класса>", например "Class cat"
+        void Print(std::ostream& os, Context& context) override;
+
+    private:
+        std::string name_;
+        std::vector<Method> methods_;
+        const Class* parent_;
+        std::unordered_map<std::string_view, size_t> methods_map_;
+    };
+
+    // Экземпляр класса
+    struct StrCacheEntry;
+
+    class ClassInstance : public Object {
+    public:
+        explicit ClassInstance(const Class& cls);
+        /*
+         * Создаёт копию объекта other без вызова __init__. Копия разделяет поля с other,
+         * пока один из объектов не изменит их (см. Fields)
+         */
+        ClassInstance(const ClassInstance& other);
+        ClassInstance(ClassInstance&& other) noexcept;
+        ~ClassInstance() override;
+
+        /*
+         * Если у объекта есть метод __str__, выводит в os результат, возвращённый этим методом.
+         * В противном случае в os выводится адрес объекта.
+         */
+        void Print(std::ostream& os, Context& context) override;
+
+        /*
+         * Вызывает у объекта метод method, передавая ему actual_args параметров.
+         * Параметр context задаёт контекст для выполнения метода.
+         * Если ни сам класс, ни его родители не содержат метод method, метод выбрасывает исключение
+         * runtime_error
+         */
+        ObjectHolder Call(const std::string& method, const std::vector<ObjectHolder>& actual_args,
+            Context& context);
+
+        // Вызывает у объекта метод method класса объекта или его родителя, не ища его по имени.
+        // Количество actual_args должно совпадать с количеством параметров метода
+        ObjectHolder Call(const Method& method, const std::vector<ObjectHolder>& actual_args, Context& context);
+
+        // Возвращает класс объекта
+        [[nodiscard]] const Class& GetClass() const;
+
+        // Возвращает true, если объект имеет метод method, принимающий argument_count параметров
+        [[nodiscard]] bool HasMethod(const std::string& method, size_t argument_count) const;
+
+        /*
+         * Возвращает ссылку на Closure, содержащий поля объекта, для изменения. Если поля
+         * разделяются с копией объекта, предварительно создаёт собственный Closure объекта
+         */
+        [[nodiscard]] Closure& Fields();
+        // Возвращает константную ссылку на Closure, содержащую поля объекта
+        [[nodiscard]] const Closure& Fields() const;
+
+        // Возвращает версию полей объекта. Версия увеличивается при каждом присваивании полю
+        [[nodiscard]] uint64_t GetFieldVersion() const {
+            return field_version_;
+        }
+
+        // Удаляет все поля объекта
+        void ResetFields();
+
+        // Отмечает изменение полей объекта
+        void BumpFieldVersion() {
+            ++field_version_;
+            if (str_cache_) {
+                ResetStrCache();
+            }
+        }
+
+        // Результат __str__, сохранённый StrCache, либо nullptr
+        [[nodiscard]] StrCacheEntry* GetStrCache() const {
+            return str_cache_.get();
+        }
+        void SetStrCache(StrCacheEntry entry);
+        void ResetStrCache();
+
+    private:
+        const Class& cls_;
+        // Поля объекта. Копии объекта разделяют их до первого изменения
+        std::shared_ptr<Closure> closure_;
+        uint64_t field_version_ = 0;
+        std::unique_ptr<StrCacheEntry> str_cache_;
+    };
+
+    template <>
+    struct ObjectKindOf<Number> {
+        static constexpr ObjectKind value = ObjectKind::NUMBER;
+    };
+
+    template <>
+    struct ObjectKindOf<String> {
+        static constexpr ObjectKind value = ObjectKind::STRING;
+    };
+
+    template <>
+    struct ObjectKindOf<Bool> {
+        static constexpr ObjectKind value = ObjectKind::BOOL;
+    };
+
+    template <>
+    struct ObjectKindOf<Class> {
+        static constexpr ObjectKind value = ObjectKind::CLASS;
+    };
+
+    template <>
+    struct ObjectKindOf<ClassInstance> {
+        static constexpr ObjectKind value = ObjectKind::CLASS_INSTANCE;
+    };
+
+    /*
+     * Возвращает true, если lhs и rhs содержат одинаковые числа, строки или значения типа Bool.
+     * Если lhs - объект с методом __eq__, функция возвращает результат вызова lhs.__eq__(rhs),
+     * приведённый к типу Bool. Если lhs и rhs имеют значение None, функция возвращает true.
+     * В остальных случаях функция выбрасывает исключение runtime_error.
+     *
+     * Параметр context задаёт контекст для выполнения метода __eq__
+     */
+    bool Equal(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
+
+    /*
+     * Если lhs и rhs - числа, строки или значения bool, функция возвращает результат их сравнения
+     * оператором <.
+     * Если lhs - объект с методом __lt__, возвращает результат вызова lhs.__lt__(rhs),
+     * приведённый к типу bool. В остальных случаях функция выбрасывает исключение runtime_error.
+     *
+     * Параметр context задаёт контекст для выполнения метода __lt__
+     */
+    bool Less(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
+    // Возвращает значение, противоположное Equal(lhs, rhs, context)
+    bool NotEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
+    // Возвращает значение lhs>rhs, используя функции Equal и Less
+    bool Greater(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
+    // Возвращает значение lhs<=rhs, используя функции Equal и Less
+    bool LessOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
+    // Возвращает значение, противоположное Less(lhs, rhs, context)
+    bool GreaterOrEqual(const ObjectHolder& lhs, const ObjectHolder& rhs, Context& context);
+
+    // Контекст-заглушка, применяется в тестах.
+    // В этом контексте весь вывод перенаправляется в строковый поток вывода output
+    struct DummyContext : Context {
+        std::ostream& GetOutputStream() override {
+            return output;
+        }
+
+        std::ostringstream output;
+    };
+
+    // Простой контекст, в нём вывод происходит в поток output, переданный в конструктор
+    class SimpleContext : public runtime::Context {
+    public:
+        explicit SimpleContext(std::ostream& output)
+            : output_(output) {
+        }
+
+        std::ostream& GetOutputStream() override {
+            return output_;
+        }
+
+    private:
+        std::ostream& output_;
+    };
+
+}  // namespace runtime
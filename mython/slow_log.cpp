@@ -0,0 +1,119 @@
+#include "slow_log.h"
+
+#include "call_stack.h"
+#include "hooks.h"
+#include "runtime.h"
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace runtime {
+
+	namespace {
+		double ToMilliseconds(chrono::nanoseconds duration) {
+			return chrono::duration<double, milli>(duration).count();
+		}
+
+		class SlowCallListener : public ExecutionListener {
+		public:
+			void Start(chrono::nanoseconds threshold, ostream& out) {
+				threshold_ = threshold;
+				output_ = &out;
+				calls_.clear();
+				statement_ = nullptr;
+			}
+
+			void Stop() {
+				output_ = nullptr;
+			}
+
+			[[nodiscard]] bool IsStarted() const {
+				return output_ != nullptr;
+			}
+
+			void OnCall(const ClassInstance& /*self*/, const Method& /*method*/, const vector<ObjectHolder>& args) override {
+				calls_.push_back({ chrono::steady_clock::now(), &args });
+			}
+
+			void OnReturn(const ClassInstance& self, const Method& method) override {
+				// Вызов начался до включения журнала
+				if (calls_.empty()) {
+					return;
+				}
+				const Call call = calls_.back();
+				calls_.pop_back();
+				const auto duration = chrono::steady_clock::now() - call.start;
+				if (duration <= threshold_) {
+					return;
+				}
+				Frame frame;
+				frame.cls = &self.GetClass();
+				frame.method = &method;
+				frame.args = call.args;
+				*output_ << "slow call: "sv << CallStack::DescribeCall(frame) << " depth "sv << CallStack::GetDepth()
+					<< ' ' << ToMilliseconds(duration) << " ms\n"sv;
+			}
+
+			// Учитывается инструкция верхнего уровня программы, не вложенная в другую учитываемую инструкцию
+			void OnStatement(const Executable& statement, size_t /*line*/) override {
+				if (statement_ == nullptr && CallStack::GetDepth() == 0) {
+					statement_ = &statement;
+					statement_start_ = chrono::steady_clock::now();
+				}
+			}
+
+			void OnStatementEnd(const Executable& statement, size_t line) override {
+				if (&statement != statement_) {
+					return;
+				}
+				statement_ = nullptr;
+				const auto duration = chrono::steady_clock::now() - statement_start_;
+				if (duration > threshold_) {
+					*output_ << "slow statement: line "sv << line << " depth 0 "sv << ToMilliseconds(duration) << " ms\n"sv;
+				}
+			}
+
+		private:
+			struct Call {
+				chrono::steady_clock::time_point start;
+				const vector<ObjectHolder>* args;
+			};
+
+			ostream* output_ = nullptr;
+			chrono::nanoseconds threshold_{ 0 };
+			// Начатые вызовы методов, последний - самый глубокий
+			vector<Call> calls_;
+			const Executable* statement_ = nullptr;
+			chrono::steady_clock::time_point statement_start_;
+		};
+
+		SlowCallListener& GetListener() {
+			static SlowCallListener listener;
+			return listener;
+		}
+	}  // namespace
+
+	void SlowCallLog::Enable(chrono::nanoseconds threshold, ostream& out) {
+		SlowCallListener& listener = GetListener();
+		if (!listener.IsStarted()) {
+			ExecutionHooks::AddListener(listener);
+		}
+		listener.Start(threshold, out);
+	}
+
+	void SlowCallLog::Disable() {
+		SlowCallListener& listener = GetListener();
+		if (listener.IsStarted()) {
+			ExecutionHooks::RemoveListener(listener);
+			listener.Stop();
+		}
+	}
+
+	bool SlowCallLog::IsEnabled() {
+		return GetListener().IsStarted();
+	}
+
+}  // namespace runtime
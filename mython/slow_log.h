@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+#include <iosfwd>
+
+namespace runtime {
+
+    /*
+     * Журнал медленных вызовов. Пока журнал включён, вызовы методов и инструкции верхнего уровня
+     * программы, исполнявшиеся дольше порога, записываются в журнал вместе с именем метода,
+     * параметрами вызова, глубиной стека вызовов и длительностью.
+     *
+     * Журнал получает вызовы и инструкции как получатель событий исполнения (см. hooks.h), поэтому
+     * выключенный журнал не стоит ничего, а быстрые вызовы обходятся чтением часов в начале и в конце.
+     * В сборке с NoHooks журнал пуст
+     */
+    class SlowCallLog {
+    public:
+        static void Enable(std::chrono::nanoseconds threshold, std::ostream& out);
+        static void Disable();
+
+        [[nodiscard]] static bool IsEnabled();
+    };
+
+}  // namespace runtime
@@ -0,0 +1,88 @@
+#include "stack_dump.h"
+
+#include "call_stack.h"
+#include "hooks.h"
+#include "stats.h"
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace runtime {
+
+	namespace {
+		void HandleDumpSignal(int /*signal*/) {
+			StackDump::Request();
+		}
+
+		// Устанавливает обработчик SIGUSR1 так же, как профилировщик - SIGPROF: обработчик не сбрасывается
+		// после первого сигнала, а прерванные сигналом системные вызовы продолжаются
+		void SetDumpSignalHandler(void (*handler)(int), struct sigaction* previous) {
+			struct sigaction action {};
+			action.sa_handler = handler;
+			action.sa_flags = SA_RESTART;
+			sigemptyset(&action.sa_mask);
+			sigaction(SIGUSR1, &action, previous);
+		}
+
+		// Выводит запрошенный дамп на границе инструкций
+		class DumpRequestListener : public ExecutionListener {
+		public:
+			void OnStatement(const Executable& /*statement*/, size_t /*line*/) override {
+				StackDump::PollRequest();
+			}
+		};
+
+		DumpRequestListener dump_request_listener;
+		bool handler_installed = false;
+		// Обработчик SIGUSR1, действовавший до InstallSignalHandler
+		struct sigaction previous_action {};
+	}  // namespace
+
+	void StackDump::InstallSignalHandler(ostream& out) {
+		output_ = &out;
+		start_ = chrono::steady_clock::now();
+		if (!handler_installed) {
+			ExecutionHooks::AddListener(dump_request_listener);
+			SetDumpSignalHandler(&HandleDumpSignal, &previous_action);
+			handler_installed = true;
+		}
+	}
+
+	void StackDump::RemoveSignalHandler() {
+		if (handler_installed) {
+			sigaction(SIGUSR1, &previous_action, nullptr);
+			ExecutionHooks::RemoveListener(dump_request_listener);
+			handler_installed = false;
+		}
+		output_ = nullptr;
+		requested_ = 0;
+	}
+
+	void StackDump::Write(ostream& out) {
+		const auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start_);
+		out << "mython stack dump after "sv << elapsed.count() << " ms, depth "sv << CallStack::GetDepth() << ":\n"sv;
+
+		vector<Frame> frames(CallStack::MAX_DEPTH);
+		frames.resize(CallStack::Snapshot(frames.data(), frames.size()));
+		// Верхний кадр выводится первым
+		for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+			out << "  "sv << CallStack::DescribeFrame(*it) << '\n';
+		}
+		if (CallStack::GetDepth() + 1 > frames.size()) {
+			out << "  ... "sv << CallStack::GetDepth() + 1 - frames.size() << " frames not recorded\n"sv;
+		}
+		Stats::WriteText(out);
+	}
+
+	void StackDump::WriteRequested() {
+		requested_ = 0;
+		if (output_) {
+			Write(*output_);
+			output_->flush();
+		}
+	}
+
+}  // namespace runtime
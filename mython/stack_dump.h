@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <csignal>
+#include <iosfwd>
+
+namespace runtime {
+
+    /*
+     * Вывод стека вызовов Mython по запросу. По сигналу SIGUSR1 интерпретатор, не прерывая работы,
+     * на ближайшей границе инструкций выводит теневой стек вызовов (см. CallStack) с параметрами
+     * вызовов, текущие счётчики интерпретатора и время, прошедшее с запуска программы.
+     * Границы инструкций дамп получает как получатель событий исполнения (см. hooks.h)
+     */
+    class StackDump {
+    public:
+        // Устанавливает обработчик SIGUSR1, по которому дамп выводится в out,
+        // и начинает отсчёт времени работы программы
+        static void InstallSignalHandler(std::ostream& out);
+        // Восстанавливает обработчик SIGUSR1, действовавший до InstallSignalHandler
+        static void RemoveSignalHandler();
+
+        // Выводит дамп в out
+        static void Write(std::ostream& out);
+
+        // Запрашивает вывод дампа. Безопасна для вызова из обработчика сигнала
+        static void Request() {
+            requested_ = 1;
+        }
+
+        // Выводит дамп, если он был запрошен сигналом
+        static void PollRequest() {
+            if (requested_) {
+                WriteRequested();
+            }
+        }
+
+    private:
+        static void WriteRequested();
+
+        inline static volatile std::sig_atomic_t requested_ = 0;
+        inline static std::ostream* output_ = nullptr;
+        inline static std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+    };
+
+}  // namespace runtime
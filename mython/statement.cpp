@@ -1,337 +1,865 @@
-#include "statement.h"
-
-#include <iostream>
-#include <sstream>
-
-using namespace std;
-
-namespace ast {
-
-	using runtime::Closure;
-	using runtime::Context;
-	using runtime::ObjectHolder;
-
-	namespace {
-		const string ADD_METHOD = "__add__"s;
-		const string INIT_METHOD = "__init__"s;
-	}  // namespace
-
-	ObjectHolder Assignment::Execute(Closure& closure, Context& context) {
-		closure[name_] = rv_->Execute(closure, context);
-		return closure.at(name_);
-	}
-
-	Assignment::Assignment(std::string var, std::unique_ptr<Statement> rv)
-		:name_(move(var)), rv_(move(rv))
-	{
-	}
-
-	VariableValue::VariableValue(const std::string& var_name)
-		:name_(var_name)
-	{
-	}
-
-	VariableValue::VariableValue(std::vector<std::string> dotted_ids)
-		:dotted_ids_(move(dotted_ids))
-	{
-	}
-
-	ObjectHolder VariableValue::Execute(Closure& closure, [[maybe_unused]] Context& context) {
-		ObjectHolder res;
-
-		if (!name_.empty()) {
-			if (closure.count(name_)) res = closure.at(name_);
-			else throw runtime_error("Unknown variable " + name_);
-		}
-		else if (!dotted_ids_.empty()) {
-			Closure* next_closure = &closure;
-			for (size_t i = 0; i < dotted_ids_.size() - 1; ++i) {
-				if (!next_closure->count(dotted_ids_[i])) throw runtime_error("Unknown variable " + dotted_ids_[i]);
-				res = next_closure->at(dotted_ids_[i]);
-				if (res.TryAs<runtime::ClassInstance>()) {
-					next_closure = &res.TryAs<runtime::ClassInstance>()->Fields();
-				}
-				else {
-					throw runtime_error("Instance is not a class");
-				}
-			}
-			if (!next_closure->count(dotted_ids_.back())) throw runtime_error("Unknown variable " + dotted_ids_.back());
-			res = next_closure->at(dotted_ids_.back());
-		}
-		else {
-			throw runtime_error("Unknown variable");
-		}
-		return res;
-	}
-
-	unique_ptr<Print> Print::Variable(const std::string& name) {
-		unique_ptr<Statement> arg = make_unique<VariableValue>(name);
-		return make_unique<Print>(move(arg));
-	}
-
-	Print::Print(unique_ptr<Statement> argument)
-	{
-		args_.push_back(move(argument));
-	}
-
-	Print::Print(vector<unique_ptr<Statement>> args)
-		:args_(move(args))
-	{
-	}
-
-	ObjectHolder Print::Execute(Closure& closure, Context& context) {
-
-		for (size_t i = 0; i < args_.size(); ++i) {
-			ObjectHolder obj = args_[i]->Execute(closure, context);
-			if (obj) {
-				obj->Print(context.GetOutputStream(), context);
-			}
-			else {
-				context.GetOutputStream() << "None"s;
-			}
-			if (i != args_.size() - 1) context.GetOutputStream() << ' ';
-		}
-		context.GetOutputStream() << '\n';
-		return {};
-	}
-
-	MethodCall::MethodCall(std::unique_ptr<Statement> object, std::string method,
-		std::vector<std::unique_ptr<Statement>> args)
-		:object_(move(object)), method_(move(method)), args_(move(args))
-	{
-	}
-
-	ObjectHolder MethodCall::Execute(Closure& closure, Context& context) {
-		runtime::ClassInstance* class_obj = object_->Execute(closure, context).TryAs<runtime::ClassInstance>();
-		if (class_obj && class_obj->HasMethod(method_, args_.size())) {
-
-			vector<ObjectHolder> args_executed(args_.size());
-			auto it = args_.begin();
-			for (ObjectHolder& arg_obj : args_executed) {
-				arg_obj = move((*it)->Execute(closure, context));
-				++it;
-			}
-			return class_obj->Call(method_, args_executed, context);
-		}
-		else {
-			return {};
-		}
-	}
-
-	ObjectHolder Stringify::Execute(Closure& closure, Context& context) {
-		ObjectHolder res = arg_->Execute(closure, context);
-		stringstream temp_stream;
-		if (res) {
-			res->Print(temp_stream, context);
-		}
-		else {
-			temp_stream << "None";
-		}
-		return ObjectHolder::Own(runtime::String(temp_stream.str()));
-	}
-
-	ObjectHolder Add::Execute(Closure& closure, Context& context) {
-		ObjectHolder lhs_obj = lhs_->Execute(closure, context);
-		ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-		auto lhs_str = lhs_obj.TryAs<runtime::String>();
-		auto rhs_str = rhs_obj.TryAs<runtime::String>();
-		if (lhs_str && rhs_str) {
-			return ObjectHolder::Own(runtime::String{ lhs_str->GetValue() + rhs_str->GetValue() });
-		}
-
-		auto lhs_num = lhs_obj.TryAs<runtime::Number>();
-		auto rhs_num = rhs_obj.TryAs<runtime::Number>();
-		if (lhs_num && rhs_num) {
-			return ObjectHolder::Own(runtime::Number{ lhs_num->GetValue() + rhs_num->GetValue() });
-		}
-
-		auto lhs_class = lhs_obj.TryAs<runtime::ClassInstance>();
-		if (lhs_class && lhs_class->HasMethod(ADD_METHOD, 1)) {
-			return lhs_class->Call(ADD_METHOD, { rhs_obj }, context);
-		}
-
-		throw runtime_error("Addition is not implemented for these operands");
-	}
-
-	ObjectHolder Sub::Execute(Closure& closure, Context& context) {
-		ObjectHolder lhs_obj = lhs_->Execute(closure, context);
-		ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-		auto lhs_num = lhs_obj.TryAs<runtime::Number>();
-		auto rhs_num = rhs_obj.TryAs<runtime::Number>();
-		if (lhs_num && rhs_num) {
-			return ObjectHolder::Own(runtime::Number{ lhs_num->GetValue() - rhs_num->GetValue() });
-		}
-
-		throw runtime_error("Subtraction is not implemented for these operands");
-	}
-
-	ObjectHolder Mult::Execute(Closure& closure, Context& context) {
-		ObjectHolder lhs_obj = lhs_->Execute(closure, context);
-		ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-		auto lhs_num = lhs_obj.TryAs<runtime::Number>();
-		auto rhs_num = rhs_obj.TryAs<runtime::Number>();
-		if (lhs_num && rhs_num) {
-			return ObjectHolder::Own(runtime::Number{ lhs_num->GetValue() * rhs_num->GetValue() });
-		}
-
-		throw runtime_error("Multiplication is not implemented for these operands");
-	}
-
-	ObjectHolder Div::Execute(Closure& closure, Context& context) {
-		ObjectHolder lhs_obj = lhs_->Execute(closure, context);
-		ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-		auto lhs_num = lhs_obj.TryAs<runtime::Number>();
-		auto rhs_num = rhs_obj.TryAs<runtime::Number>();
-		if (lhs_num && rhs_num && rhs_num->GetValue() != 0) {
-			return ObjectHolder::Own(runtime::Number{ lhs_num->GetValue() / rhs_num->GetValue() });
-		}
-
-		throw runtime_error("Division is not implemented for these operands");
-	}
-
-	ObjectHolder Compound::Execute(Closure& closure, Context& context) {
-		for (auto& stmt : args_) {
-			stmt->Execute(closure, context);
-		}
-		return ObjectHolder::None();
-	}
-
-	ObjectHolder Return::Execute(Closure& closure, Context& context) {
-		ObjectHolder res_obj = statement_->Execute(closure, context);
-		throw ExeptionWithObject(res_obj);
-	}
-
-	ClassDefinition::ClassDefinition(ObjectHolder cls)
-		:cls_(move(cls))
-	{
-	}
-
-	ObjectHolder ClassDefinition::Execute(Closure& closure, Context&) {
-		string name = cls_.TryAs<runtime::Class>()->GetName();
-		closure[name] = cls_;
-		return cls_;
-	}
-
-	FieldAssignment::FieldAssignment(VariableValue object, std::string field_name,
-		std::unique_ptr<Statement> rv)
-		:object_(move(object)), field_name_(move(field_name)), rv_(move(rv))
-	{
-	}
-
-	ObjectHolder FieldAssignment::Execute(Closure& closure, Context& context) {
-		ObjectHolder obj = object_.Execute(closure, context);
-		Closure& fields_closure = obj.TryAs<runtime::ClassInstance>()->Fields();
-		fields_closure[field_name_] = rv_->Execute(closure, context);
-		return fields_closure.at(field_name_);
-	}
-
-	IfElse::IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
-		std::unique_ptr<Statement> else_body)
-		:condition_(move(condition)), if_body_(move(if_body)), else_body_(move(else_body))
-	{
-	}
-
-	ObjectHolder IfElse::Execute(Closure& closure, Context& context) {
-		ObjectHolder condition_obj = condition_->Execute(closure, context);
-		if (IsTrue(condition_obj)) {
-			return if_body_->Execute(closure, context);
-		}
-		else if (else_body_) {
-			return else_body_->Execute(closure, context);
-		}
-		else {
-			return ObjectHolder::None();
-		}
-	}
-
-	ObjectHolder Or::Execute(Closure& closure, Context& context) {
-		ObjectHolder lhs_obj = lhs_->Execute(closure, context);
-		ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-		if (lhs_obj && rhs_obj) {
-			return ObjectHolder::Own(runtime::Bool{ IsTrue(lhs_obj) || IsTrue(rhs_obj) });
-		}
-
-		throw runtime_error("'Or' is not implemented for these operands");
-	}
-
-	ObjectHolder And::Execute(Closure& closure, Context& context) {
-		ObjectHolder lhs_obj = lhs_->Execute(closure, context);
-		ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-
-		if (lhs_obj && rhs_obj) {
-			return ObjectHolder::Own(runtime::Bool{ IsTrue(lhs_obj) && IsTrue(rhs_obj) });
-		}
-
-		throw runtime_error("'And' is not implemented for these operands");
-	}
-
-	ObjectHolder Not::Execute(Closure& closure, Context& context) {
-		ObjectHolder obj = arg_->Execute(closure, context);
-
-		if (obj) {
-			return ObjectHolder::Own(runtime::Bool{ !IsTrue(obj) });
-		}
-
-		throw runtime_error("'Not' is not implemented for this argument");
-	}
-
-	Comparison::Comparison(Comparator cmp, unique_ptr<Statement> lhs, unique_ptr<Statement> rhs)
-		: BinaryOperation(std::move(lhs), std::move(rhs)), cmp_(move(cmp)) {
-	}
-
-	ObjectHolder Comparison::Execute(Closure& closure, Context& context) {
-		ObjectHolder lhs_obj = lhs_->Execute(closure, context);
-		ObjectHolder rhs_obj = rhs_->Execute(closure, context);
-		return ObjectHolder::Own(runtime::Bool{ cmp_(lhs_obj, rhs_obj, context) });
-	}
-
-	NewInstance::NewInstance(const runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args)
-		:id_(NewInstanceId()), class__(class_), args_(move(args))
-	{
-	}
-
-	NewInstance::NewInstance(const runtime::Class& class_)
-		:id_(NewInstanceId()), class__(class_)
-	{
-	}
-
-	ObjectHolder NewInstance::Execute(Closure& closure, Context& context) {
-		string name = to_string(NewInstanceId()) + '_' + class__.GetName();
-
-		runtime::ClassInstance class_instance(class__);
-		closure[name] = ObjectHolder::Own(std::move(class_instance));
-
-		auto* class_inst = const_cast<runtime::ClassInstance*>(closure.at(name).TryAs<runtime::ClassInstance>());
-		if (class_inst->HasMethod(INIT_METHOD, args_.size())) {
-			vector<ObjectHolder> args_executed(args_.size());
-			auto it = args_.begin();
-			for (ObjectHolder& arg_obj : args_executed) {
-				arg_obj = move((*it)->Execute(closure, context));
-				++it;
-			}
-			class_inst->Call(INIT_METHOD, args_executed, context);
-		}
-		return closure.at(name);
-	}
-
-	MethodBody::MethodBody(std::unique_ptr<Statement>&& body)
-		:body_(move(body))
-	{
-	}
-
-	ObjectHolder MethodBody::Execute(Closure& closure, Context& context) {
-		try {
-			ObjectHolder result = body_->Execute(closure, context);
-		}
-		catch (ExeptionWithObject& exeption_with_obj) {
-			return exeption_with_obj.obj_;
-		}
-		return ObjectHolder::None();
-	}
-
+#include "statement.h"
+
+#include "call_stack.h"
+#include "hotspots.h"
+#include "module_cache.h"
+#include "str_cache.h"
+
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+namespace ast {
+
+	using runtime::Closure;
+	using runtime::Context;
+	using runtime::ObjectHolder;
+
+	namespace {
+		const string ADD_METHOD = "__add__"s;
+		const string INIT_METHOD = "__init__"s;
+
+		// Создаёт объект, запоминая узел site как место его создания
+		template <typename T>
+		ObjectHolder Allocate(const char* node, const Statement& site, T&& object) {
+			if (runtime::HeapCensus::IsEnabled()) {
+				runtime::HeapCensus::SetSite(node, site.GetLine());
+			}
+			return ObjectHolder::Own(std::forward<T>(object));
+		}
+
+		/*
+		 * Значение операнда. Если операнд только читает переменную, поле или константу,
+		 * значение заимствуется без копирования ObjectHolder (см. Statement::Borrow).
+		 * Заимствовать можно, только пока вычисление других выражений не может изменить переменную
+		 * или поле, из которых прочитано значение, поэтому may_borrow ложно, если после операнда
+		 * вычисляется выражение, исполняющее код программы
+		 */
+		class Operand {
+		public:
+			Operand(Statement& statement, Closure& closure, Context& context, bool may_borrow = true) {
+				if (may_borrow && statement.CanBorrow()) {
+					value_ = statement.Borrow(closure);
+				}
+				else {
+					owned_ = statement.Execute(closure, context);
+				}
+			}
+
+			Operand(const Operand&) = delete;
+			Operand& operator=(const Operand&) = delete;
+
+			[[nodiscard]] const ObjectHolder& Get() const {
+				return *value_;
+			}
+
+			// Копирует заимствованное значение перед вызовом метода объекта: метод может изменить
+			// переменную или поле, хранящие единственную ссылку на объект
+			const ObjectHolder& Pin() {
+				if (value_ != &owned_) {
+					owned_ = *value_;
+					value_ = &owned_;
+				}
+				return owned_;
+			}
+
+			// Закрепляет значение, если это объект класса, методы которого могут быть вызваны
+			const ObjectHolder& PinInstance() {
+				return value_->TryAs<runtime::ClassInstance>() ? Pin() : *value_;
+			}
+
+		private:
+			ObjectHolder owned_;
+			const ObjectHolder* value_ = &owned_;
+		};
+
+		// Возвращает ячейку имени name в closure, по возможности не выполняя поиск. nullptr - имени нет
+		const ObjectHolder* FindCell(const Closure& closure, const string& name, CachedCell& cell) {
+			runtime::Counters& counters = runtime::Stats::Get();
+			if (cell.generation == closure.GetGeneration()) {
+				++counters.closure_cache_hits;
+				return cell.value;
+			}
+			++counters.closure_lookups;
+			auto it = closure.find(name);
+			if (it == closure.end()) {
+				return nullptr;
+			}
+			cell = { closure.GetGeneration(), &it->second };
+			return cell.value;
+		}
+
+		// Возвращает ячейку имени name в closure, добавляя имя при необходимости
+		ObjectHolder& InsertCell(Closure& closure, const string& name, CachedCell& cell) {
+			++runtime::Stats::Get().closure_inserts;
+			if (cell.generation == closure.GetGeneration()) {
+				++runtime::Stats::Get().closure_cache_hits;
+				// Ячейка принадлежит closure, доступному для изменения
+				return const_cast<ObjectHolder&>(*cell.value);
+			}
+			ObjectHolder& value = closure[name];
+			cell = { closure.GetGeneration(), &value };
+			return value;
+		}
+
+		// Имена узлов операций FusedArithmetic для переписи объектов, в порядке FusedArithmetic::Term::Kind
+		const char* const ARITHMETIC_NODES[] = { "FusedArithmetic", "Add", "Sub", "Mult", "Div" };
+
+		// Операции узлов Add, Sub, Mult и Div над вычисленными операндами. node - узел, выполняющий операцию
+		ObjectHolder AddValues(const ObjectHolder& lhs, const ObjectHolder& rhs, const Statement& node, Context& context) {
+			auto lhs_str = lhs.TryAs<runtime::String>();
+			auto rhs_str = rhs.TryAs<runtime::String>();
+			if (lhs_str && rhs_str) {
+				return Allocate("Add", node, runtime::String{ lhs_str->GetValue() + rhs_str->GetValue() });
+			}
+
+			auto lhs_num = lhs.TryAs<runtime::Number>();
+			auto rhs_num = rhs.TryAs<runtime::Number>();
+			if (lhs_num && rhs_num) {
+				return Allocate("Add", node, runtime::Number{ lhs_num->GetValue() + rhs_num->GetValue() });
+			}
+
+			auto lhs_class = lhs.TryAs<runtime::ClassInstance>();
+			if (lhs_class && lhs_class->HasMethod(ADD_METHOD, 1)) {
+				return lhs_class->Call(ADD_METHOD, vector<ObjectHolder>(1, rhs), context);
+			}
+
+			throw runtime_error("Addition is not implemented for these operands");
+		}
+
+		ObjectHolder SubValues(const ObjectHolder& lhs, const ObjectHolder& rhs, const Statement& node) {
+			auto lhs_num = lhs.TryAs<runtime::Number>();
+			auto rhs_num = rhs.TryAs<runtime::Number>();
+			if (lhs_num && rhs_num) {
+				return Allocate("Sub", node, runtime::Number{ lhs_num->GetValue() - rhs_num->GetValue() });
+			}
+
+			throw runtime_error("Subtraction is not implemented for these operands");
+		}
+
+		ObjectHolder MultValues(const ObjectHolder& lhs, const ObjectHolder& rhs, const Statement& node) {
+			auto lhs_num = lhs.TryAs<runtime::Number>();
+			auto rhs_num = rhs.TryAs<runtime::Number>();
+			if (lhs_num && rhs_num) {
+				return Allocate("Mult", node, runtime::Number{ lhs_num->GetValue() * rhs_num->GetValue() });
+			}
+
+			throw runtime_error("Multiplication is not implemented for these operands");
+		}
+
+		ObjectHolder DivValues(const ObjectHolder& lhs, const ObjectHolder& rhs, const Statement& node) {
+			auto lhs_num = lhs.TryAs<runtime::Number>();
+			auto rhs_num = rhs.TryAs<runtime::Number>();
+			if (lhs_num && rhs_num && rhs_num->GetValue() != 0) {
+				return Allocate("Div", node, runtime::Number{ lhs_num->GetValue() / rhs_num->GetValue() });
+			}
+
+			throw runtime_error("Division is not implemented for these operands");
+		}
+
+		// Вычисляет значение выражения, которое сохраняется или передаётся за пределы узла
+		ObjectHolder Evaluate(Statement& statement, Closure& closure, Context& context) {
+			if (statement.CanBorrow()) {
+				return *statement.Borrow(closure);
+			}
+			return statement.Execute(closure, context);
+		}
+	}  // namespace
+
+	ObjectHolder Assignment::Execute(Closure& closure, Context& context) {
+		ObjectHolder value = Evaluate(*rv_, closure, context);
+		value.Retain();
+		return InsertCell(closure, name_, cell_) = move(value);
+	}
+
+	void Assignment::ForEachChild(const std::function<void(Statement&)>& visit) {
+		visit(*rv_);
+	}
+
+	Assignment::Assignment(std::string var, std::unique_ptr<Statement> rv)
+		:name_(move(var)), rv_(move(rv))
+	{
+	}
+
+	void ForEachNode(Statement& root, const std::function<void(Statement&)>& visit) {
+		visit(root);
+		root.ForEachChild([&visit](Statement& child) {
+			ForEachNode(child, visit);
+		});
+	}
+
+	VariableValue::VariableValue(const std::string& var_name)
+		:name_(var_name), cells_(1)
+	{
+	}
+
+	VariableValue::VariableValue(std::vector<std::string> dotted_ids)
+		:dotted_ids_(move(dotted_ids)), cells_(dotted_ids_.size())
+	{
+	}
+
+	ObjectHolder VariableValue::Execute(Closure& closure, [[maybe_unused]] Context& context) {
+		return *Borrow(closure);
+	}
+
+	const ObjectHolder* VariableValue::Borrow(Closure& closure) {
+		if (!name_.empty()) {
+			const ObjectHolder* value = FindCell(closure, name_, cells_.front());
+			if (value == nullptr) {
+				throw runtime_error("Unknown variable " + name_);
+			}
+			return value;
+		}
+		if (dotted_ids_.empty()) {
+			throw runtime_error("Unknown variable");
+		}
+		// Поля читаются через константную ссылку, чтобы не копировать поля, разделяемые копиями объекта
+		const Closure* next_closure = &closure;
+		for (size_t i = 0; i < dotted_ids_.size(); ++i) {
+			const ObjectHolder* value = FindCell(*next_closure, dotted_ids_[i], cells_[i]);
+			if (value == nullptr) {
+				throw runtime_error("Unknown variable " + dotted_ids_[i]);
+			}
+			if (i > 0) {
+				runtime::StrCache::RecordFieldRead(*value);
+			}
+			if (i + 1 == dotted_ids_.size()) {
+				return value;
+			}
+			const auto* instance = value->TryAs<runtime::ClassInstance>();
+			if (instance == nullptr) {
+				throw runtime_error("Instance is not a class");
+			}
+			next_closure = &instance->Fields();
+		}
+		return nullptr;
+	}
+
+	unique_ptr<Print> Print::Variable(const std::string& name) {
+		unique_ptr<Statement> arg = make_unique<VariableValue>(name);
+		return make_unique<Print>(move(arg));
+	}
+
+	Print::Print(unique_ptr<Statement> argument)
+	{
+		args_.push_back(move(argument));
+	}
+
+	Print::Print(vector<unique_ptr<Statement>> args)
+		:args_(move(args))
+	{
+	}
+
+	ObjectHolder Print::Execute(Closure& closure, Context& context) {
+
+		for (size_t i = 0; i < args_.size(); ++i) {
+			Operand arg(*args_[i], closure, context);
+			if (const ObjectHolder& obj = arg.PinInstance()) {
+				obj->Print(context.GetOutputStream(), context);
+			}
+			else {
+				context.GetOutputStream() << "None"s;
+			}
+			if (i != args_.size() - 1) context.GetOutputStream() << ' ';
+		}
+		context.GetOutputStream() << '\n';
+		runtime::StrCache::MarkUncacheable();
+		runtime::ExecutionHooks::OnPrint();
+		return {};
+	}
+
+	void Print::ForEachChild(const std::function<void(Statement&)>& visit) {
+		for (auto& arg : args_) {
+			visit(*arg);
+		}
+	}
+
+	MethodCall::MethodCall(std::unique_ptr<Statement> object, std::string method,
+		std::vector<std::unique_ptr<Statement>> args)
+		:object_(move(object)), method_(move(method)), args_(move(args))
+	{
+	}
+
+	ObjectHolder MethodCall::Execute(Closure& closure, Context& context) {
+		HotSpots::Scope hot_spot(*this);
+		// Объект и параметры копируются: они передаются вызываемому методу
+		const ObjectHolder object = Evaluate(*object_, closure, context);
+		runtime::ClassInstance* class_obj = object.TryAs<runtime::ClassInstance>();
+		// Связывание доказано анализом иерархии классов при разборе. Класс объекта всё равно проверяется:
+		// если анализ ошибся, метод ищется по имени, как у несвязанного вызова
+		if (bound_method_ != nullptr && IsBoundFor(class_obj)) {
+			++runtime::Stats::Get().bound_method_calls;
+			return class_obj->Call(*bound_method_, EvaluateArgs(closure, context), context);
+		}
+		if (class_obj && class_obj->HasMethod(method_, args_.size())) {
+			return class_obj->Call(method_, EvaluateArgs(closure, context), context);
+		}
+		else {
+			return {};
+		}
+	}
+
+	bool MethodCall::IsBoundFor(const runtime::ClassInstance* object) const {
+		if (object == nullptr) {
+			return false;
+		}
+		const runtime::Class* cls = &object->GetClass();
+		if (cls == bound_class_) {
+			return true;
+		}
+		if (!bound_with_subclasses_) {
+			return false;
+		}
+		// Все классы программы известны при разборе, и анализ проверил, что ни один наследник
+		// bound_class_ не переопределяет метод, поэтому достаточно проверить наследование
+		for (cls = cls->GetParent(); cls != nullptr; cls = cls->GetParent()) {
+			if (cls == bound_class_) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	vector<ObjectHolder> MethodCall::EvaluateArgs(Closure& closure, Context& context) {
+		vector<ObjectHolder> args_executed;
+		args_executed.reserve(args_.size());
+		for (auto& arg : args_) {
+			args_executed.push_back(Evaluate(*arg, closure, context));
+		}
+		return args_executed;
+	}
+
+	void MethodCall::ForEachChild(const std::function<void(Statement&)>& visit) {
+		visit(*object_);
+		for (auto& arg : args_) {
+			visit(*arg);
+		}
+	}
+
+	ObjectHolder Stringify::Execute(Closure& closure, Context& context) {
+		Operand arg(*arg_, closure, context);
+		stringstream temp_stream;
+		if (const ObjectHolder& res = arg.PinInstance()) {
+			res->Print(temp_stream, context);
+		}
+		else {
+			temp_stream << "None";
+		}
+		return Allocate("Stringify", *this, runtime::String(temp_stream.str()));
+	}
+
+	ObjectHolder Copy::Execute(Closure& closure, Context& context) {
+		ObjectHolder value = arg_->Execute(closure, context);
+		if (const auto* instance = value.TryAs<runtime::ClassInstance>()) {
+			return Allocate("Copy", *this, runtime::ClassInstance(*instance));
+		}
+		return value;
+	}
+
+	namespace {
+		// Вычисляет имя счётчика или таймера, переданное встроенной функции function
+		const string& EvaluateName(Statement& name, const char* function, Closure& closure, Context& context,
+			ObjectHolder& holder) {
+			holder = name.Execute(closure, context);
+			const auto* str = holder.TryAs<runtime::String>();
+			if (str == nullptr) {
+				throw runtime_error(function + " expects a string name"s);
+			}
+			return str->GetValue();
+		}
+	}  // namespace
+
+	ObjectHolder ClockNs::Execute(Closure& /*closure*/, Context& /*context*/) {
+		runtime::StrCache::MarkUncacheable();
+		const auto now = chrono::steady_clock::now().time_since_epoch();
+		return Allocate("ClockNs", *this, runtime::Number(chrono::duration_cast<chrono::nanoseconds>(now).count()));
+	}
+
+	ObjectHolder CounterAdd::Execute(Closure& closure, Context& context) {
+		ObjectHolder name_holder;
+		const string& name = EvaluateName(*name_, "counter_add", closure, context, name_holder);
+		ObjectHolder value = value_->Execute(closure, context);
+		const auto* number = value.TryAs<runtime::Number>();
+		if (number == nullptr) {
+			throw runtime_error("counter_add expects a number value"s);
+		}
+		runtime::Stats::GetUserCounter(name) += number->GetValue();
+		runtime::StrCache::MarkUncacheable();
+		return ObjectHolder::None();
+	}
+
+	ObjectHolder TimerStart::Execute(Closure& closure, Context& context) {
+		ObjectHolder name_holder;
+		const string& name = EvaluateName(*arg_, "timer_start", closure, context, name_holder);
+		runtime::Stats::GetUserTimer(name).started.push_back(chrono::steady_clock::now());
+		runtime::StrCache::MarkUncacheable();
+		return ObjectHolder::None();
+	}
+
+	ObjectHolder TimerStop::Execute(Closure& closure, Context& context) {
+		const auto now = chrono::steady_clock::now();
+		ObjectHolder name_holder;
+		const string& name = EvaluateName(*arg_, "timer_stop", closure, context, name_holder);
+		runtime::UserTimer& timer = runtime::Stats::GetUserTimer(name);
+		if (timer.started.empty()) {
+			throw runtime_error("timer_stop('"s + name + "') without timer_start"s);
+		}
+		const auto duration = chrono::duration_cast<chrono::nanoseconds>(now - timer.started.back());
+		timer.started.pop_back();
+		timer.total += duration;
+		++timer.count;
+		runtime::StrCache::MarkUncacheable();
+		return Allocate("TimerStop", *this, runtime::Number(duration.count()));
+	}
+
+	ObjectHolder Add::Execute(Closure& closure, Context& context) {
+		Operand lhs(*lhs_, closure, context, rhs_->CanBorrow());
+		Operand rhs(*rhs_, closure, context);
+		return AddValues(lhs.PinInstance(), rhs.Get(), *this, context);
+	}
+
+	ObjectHolder Sub::Execute(Closure& closure, Context& context) {
+		Operand lhs(*lhs_, closure, context, rhs_->CanBorrow());
+		Operand rhs(*rhs_, closure, context);
+		return SubValues(lhs.Get(), rhs.Get(), *this);
+	}
+
+	ObjectHolder Mult::Execute(Closure& closure, Context& context) {
+		Operand lhs(*lhs_, closure, context, rhs_->CanBorrow());
+		Operand rhs(*rhs_, closure, context);
+		return MultValues(lhs.Get(), rhs.Get(), *this);
+	}
+
+	ObjectHolder Div::Execute(Closure& closure, Context& context) {
+		Operand lhs(*lhs_, closure, context, rhs_->CanBorrow());
+		Operand rhs(*rhs_, closure, context);
+		return DivValues(lhs.Get(), rhs.Get(), *this);
+	}
+
+	// Значение операнда или промежуточного результата FusedArithmetic
+	struct FusedArithmetic::Value {
+		// Ложно, если значение - число, хранящееся в number
+		bool boxed = false;
+		int64_t number = 0;
+		ObjectHolder object;
+	};
+
+	unique_ptr<Statement> FusedArithmetic::Fuse(unique_ptr<Statement> expression) {
+		auto fused = make_unique<FusedArithmetic>(move(expression));
+		// Операций в выражении вдвое меньше, чем остальных элементов
+		if (fused->terms_.size() < 5) {
+			// Не больше одной операции: промежуточных результатов нет
+			return move(fused->expression_);
+		}
+		return fused;
+	}
+
+	FusedArithmetic::FusedArithmetic(unique_ptr<Statement> expression)
+		:expression_(move(expression))
+	{
+		SetLine(expression_->GetLine());
+		Compile(*expression_);
+	}
+
+	void FusedArithmetic::Compile(Statement& node) {
+		if (auto* fused = dynamic_cast<FusedArithmetic*>(&node)) {
+			Compile(*fused->expression_);
+			return;
+		}
+		Term term{ Term::Kind::LEAF, &node };
+		auto* operation = dynamic_cast<BinaryOperation*>(&node);
+		if (dynamic_cast<Add*>(&node)) {
+			term.kind = Term::Kind::ADD;
+		}
+		else if (dynamic_cast<Sub*>(&node)) {
+			term.kind = Term::Kind::SUB;
+		}
+		else if (dynamic_cast<Mult*>(&node)) {
+			term.kind = Term::Kind::MULT;
+		}
+		else if (dynamic_cast<Div*>(&node)) {
+			term.kind = Term::Kind::DIV;
+		}
+		if (term.kind != Term::Kind::LEAF) {
+			Compile(*operation->lhs_);
+			term.lhs = terms_.size() - 1;
+			Compile(*operation->rhs_);
+		}
+		terms_.push_back(term);
+	}
+
+	ObjectHolder FusedArithmetic::Execute(Closure& closure, Context& context) {
+		Value result = EvaluateTerm(terms_.size() - 1, closure, context);
+		if (result.boxed) {
+			return move(result.object);
+		}
+		const Term& root = terms_.back();
+		return Allocate(ARITHMETIC_NODES[static_cast<size_t>(root.kind)], *root.node, runtime::Number(result.number));
+	}
+
+	void FusedArithmetic::ForEachChild(const std::function<void(Statement&)>& visit) {
+		visit(*expression_);
+	}
+
+	FusedArithmetic::Value FusedArithmetic::EvaluateTerm(size_t index, Closure& closure, Context& context) {
+		const Term& term = terms_[index];
+		if (term.kind == Term::Kind::LEAF) {
+			Value value;
+			if (term.node->CanBorrow()) {
+				const ObjectHolder* object = term.node->Borrow(closure);
+				if (const auto* number = object->TryAs<runtime::Number>()) {
+					value.number = number->GetValue();
+					return value;
+				}
+				// Не число копируется: вычисление следующих операндов может изменить переменную
+				value.object = *object;
+			}
+			else {
+				value.object = term.node->Execute(closure, context);
+				if (const auto* number = value.object.TryAs<runtime::Number>()) {
+					value.number = number->GetValue();
+					value.object = ObjectHolder::None();
+					return value;
+				}
+			}
+			value.boxed = true;
+			return value;
+		}
+
+		Value lhs = EvaluateTerm(term.lhs, closure, context);
+		Value rhs = EvaluateTerm(index - 1, closure, context);
+		if (!lhs.boxed && !rhs.boxed) {
+			switch (term.kind) {
+			case Term::Kind::ADD:
+				lhs.number += rhs.number;
+				return lhs;
+			case Term::Kind::SUB:
+				lhs.number -= rhs.number;
+				return lhs;
+			case Term::Kind::MULT:
+				lhs.number *= rhs.number;
+				return lhs;
+			case Term::Kind::DIV:
+				if (rhs.number != 0) {
+					lhs.number /= rhs.number;
+					return lhs;
+				}
+				break;
+			case Term::Kind::LEAF:
+				break;
+			}
+		}
+
+		// Операнд не число: операция выполняется так же, как узлом Add, Sub, Mult или Div
+		const char* node_name = ARITHMETIC_NODES[static_cast<size_t>(term.kind)];
+		for (Value* value : { &lhs, &rhs }) {
+			if (!value->boxed) {
+				value->object = Allocate(node_name, *term.node, runtime::Number(value->number));
+			}
+		}
+		Value result;
+		result.boxed = true;
+		switch (term.kind) {
+		case Term::Kind::ADD:
+			result.object = AddValues(lhs.object, rhs.object, *term.node, context);
+			break;
+		case Term::Kind::SUB:
+			result.object = SubValues(lhs.object, rhs.object, *term.node);
+			break;
+		case Term::Kind::MULT:
+			result.object = MultValues(lhs.object, rhs.object, *term.node);
+			break;
+		case Term::Kind::DIV:
+			result.object = DivValues(lhs.object, rhs.object, *term.node);
+			break;
+		case Term::Kind::LEAF:
+			break;
+		}
+		return result;
+	}
+
+	ObjectHolder Compound::Execute(Closure& closure, Context& context) {
+		for (auto& stmt : args_) {
+			runtime::CallStack::SetLine(stmt->GetLine());
+			runtime::StatementHooksScope<runtime::ExecutionHooks> hooks(*stmt, stmt->GetLine());
+			HotSpots::Scope hot_spot(*stmt);
+			stmt->Execute(closure, context);
+		}
+		return ObjectHolder::None();
+	}
+
+	void Compound::ForEachChild(const std::function<void(Statement&)>& visit) {
+		for (auto& stmt : args_) {
+			visit(*stmt);
+		}
+	}
+
+	ObjectHolder Return::Execute(Closure& closure, Context& context) {
+		ObjectHolder res_obj = Evaluate(*statement_, closure, context);
+		res_obj.Retain();
+		++runtime::Stats::Get().returns;
+		throw ExeptionWithObject(res_obj);
+	}
+
+	void Return::ForEachChild(const std::function<void(Statement&)>& visit) {
+		visit(*statement_);
+	}
+
+	ClassDefinition::ClassDefinition(ObjectHolder cls)
+		:cls_(move(cls))
+	{
+	}
+
+	ObjectHolder ClassDefinition::Execute(Closure& closure, Context&) {
+		string name = cls_.TryAs<runtime::Class>()->GetName();
+		++runtime::Stats::Get().closure_inserts;
+		closure[name] = cls_;
+		return cls_;
+	}
+
+	void ClassDefinition::ForEachChild(const std::function<void(Statement&)>& visit) {
+		for (const runtime::Method& method : cls_.TryAs<runtime::Class>()->GetMethods()) {
+			if (auto* body = dynamic_cast<Statement*>(method.body.get())) {
+				visit(*body);
+			}
+		}
+	}
+
+	const runtime::Class& ClassDefinition::GetClass() const {
+		return *cls_.TryAs<runtime::Class>();
+	}
+
+	Import::Import(shared_ptr<const parse::Module> module)
+		:module_(move(module))
+	{
+	}
+
+	ObjectHolder Import::Execute(Closure& closure, Context&) {
+		for (const ObjectHolder& cls : module_->classes) {
+			closure[cls.TryAs<runtime::Class>()->GetName()] = cls;
+		}
+		runtime::Stats::Get().closure_inserts += module_->classes.size();
+		return ObjectHolder::None();
+	}
+
+	FieldAssignment::FieldAssignment(VariableValue object, std::string field_name,
+		std::unique_ptr<Statement> rv)
+		:object_(move(object)), field_name_(move(field_name)), rv_(move(rv))
+	{
+	}
+
+	ObjectHolder FieldAssignment::Execute(Closure& closure, Context& context) {
+		// Значение вычисляется раньше объекта, как в Python: тогда объект можно заимствовать
+		ObjectHolder value = Evaluate(*rv_, closure, context);
+		value.Retain();
+		runtime::ClassInstance* instance = object_.Borrow(closure)->TryAs<runtime::ClassInstance>();
+		if (instance == nullptr) {
+			throw runtime_error("Instance is not a class");
+		}
+		ObjectHolder& field = InsertCell(instance->Fields(), field_name_, field_cell_);
+		field = move(value);
+		instance->BumpFieldVersion();
+		runtime::StrCache::MarkUncacheable();
+		return field;
+	}
+
+	void FieldAssignment::ForEachChild(const std::function<void(Statement&)>& visit) {
+		visit(object_);
+		visit(*rv_);
+	}
+
+	IfElse::IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
+		std::unique_ptr<Statement> else_body)
+		:condition_(move(condition)), if_body_(move(if_body)), else_body_(move(else_body))
+	{
+	}
+
+	ObjectHolder IfElse::Execute(Closure& closure, Context& context) {
+		Operand condition(*condition_, closure, context);
+		if (IsTrue(condition.Get())) {
+			if (HotSpots::IsEnabled()) {
+				++taken_;
+			}
+			return if_body_->Execute(closure, context);
+		}
+		if (HotSpots::IsEnabled()) {
+			++not_taken_;
+		}
+		if (else_body_) {
+			return else_body_->Execute(closure, context);
+		}
+		else {
+			return ObjectHolder::None();
+		}
+	}
+
+	void IfElse::ForEachChild(const std::function<void(Statement&)>& visit) {
+		visit(*condition_);
+		visit(*if_body_);
+		if (else_body_) {
+			visit(*else_body_);
+		}
+	}
+
+	ObjectHolder Or::Execute(Closure& closure, Context& context) {
+		// Левый операнд используется до вычисления правого, поэтому его можно заимствовать
+		Operand lhs(*lhs_, closure, context);
+		const bool lhs_present = static_cast<bool>(lhs.Get());
+		const bool lhs_true = IsTrue(lhs.Get());
+		Operand rhs(*rhs_, closure, context);
+		const ObjectHolder& rhs_obj = rhs.Get();
+
+		if (lhs_present && rhs_obj) {
+			return Allocate("Or", *this, runtime::Bool{ lhs_true || IsTrue(rhs_obj) });
+		}
+
+		throw runtime_error("'Or' is not implemented for these operands");
+	}
+
+	ObjectHolder And::Execute(Closure& closure, Context& context) {
+		// Левый операнд используется до вычисления правого, поэтому его можно заимствовать
+		Operand lhs(*lhs_, closure, context);
+		const bool lhs_present = static_cast<bool>(lhs.Get());
+		const bool lhs_true = IsTrue(lhs.Get());
+		Operand rhs(*rhs_, closure, context);
+		const ObjectHolder& rhs_obj = rhs.Get();
+
+		if (lhs_present && rhs_obj) {
+			return Allocate("And", *this, runtime::Bool{ lhs_true && IsTrue(rhs_obj) });
+		}
+
+		throw runtime_error("'And' is not implemented for these operands");
+	}
+
+	ObjectHolder Not::Execute(Closure& closure, Context& context) {
+		Operand arg(*arg_, closure, context);
+		const ObjectHolder& obj = arg.Get();
+
+		if (obj) {
+			return Allocate("Not", *this, runtime::Bool{ !IsTrue(obj) });
+		}
+
+		throw runtime_error("'Not' is not implemented for this argument");
+	}
+
+	Comparison::Comparison(Comparator cmp, unique_ptr<Statement> lhs, unique_ptr<Statement> rhs)
+		: BinaryOperation(std::move(lhs), std::move(rhs)), cmp_(move(cmp)) {
+	}
+
+	ObjectHolder Comparison::Execute(Closure& closure, Context& context) {
+		Operand lhs(*lhs_, closure, context, rhs_->CanBorrow());
+		Operand rhs(*rhs_, closure, context);
+		// Сравнение объектов классов вызывает их методы __eq__ и __lt__
+		return Allocate("Comparison", *this, runtime::Bool{ cmp_(lhs.PinInstance(), rhs.PinInstance(), context) });
+	}
+
+	NewInstance::NewInstance(const runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args)
+		:id_(NewInstanceId()), class__(class_), args_(move(args))
+	{
+	}
+
+	NewInstance::NewInstance(const runtime::Class& class_)
+		:id_(NewInstanceId()), class__(class_)
+	{
+	}
+
+	ObjectHolder NewInstance::Execute(Closure& closure, Context& context) {
+		ObjectHolder instance = frame_slots_enabled_
+			? AcquireFrameSlot()
+			: Allocate("NewInstance", *this, runtime::ClassInstance(class__));
+
+		auto* class_inst = instance.TryAs<runtime::ClassInstance>();
+		if (class_inst->HasMethod(INIT_METHOD, args_.size())) {
+			vector<ObjectHolder> args_executed;
+			args_executed.reserve(args_.size());
+			for (auto& arg : args_) {
+				args_executed.push_back(Evaluate(*arg, closure, context));
+			}
+			class_inst->Call(INIT_METHOD, args_executed, context);
+		}
+		return instance;
+	}
+
+	ObjectHolder NewInstance::AcquireFrameSlot() {
+		for (const ObjectHolder& slot : frame_slots_) {
+			// Экземпляр не покидает метод, поэтому после выхода из метода на него ссылается только слот
+			if (slot.IsUnique()) {
+				++runtime::Stats::Get().frame_slot_reuses;
+				slot.TryAs<runtime::ClassInstance>()->ResetFields();
+				return slot;
+			}
+		}
+		ObjectHolder instance = Allocate("NewInstance", *this, runtime::ClassInstance(class__));
+		if (frame_slots_.size() < MAX_FRAME_SLOTS) {
+			frame_slots_.push_back(instance);
+			if (runtime::HeapCensus::IsEnabled()) {
+				runtime::HeapCensus::MarkFrameSlot(*instance);
+			}
+		}
+		return instance;
+	}
+
+	void NewInstance::ReleaseFrameSlots() {
+		for (const ObjectHolder& slot : frame_slots_) {
+			auto* instance = slot.TryAs<runtime::ClassInstance>();
+			if (slot.IsUnique() && !instance->Fields().empty()) {
+				instance->ResetFields();
+			}
+		}
+	}
+
+	void NewInstance::ForEachChild(const std::function<void(Statement&)>& visit) {
+		for (auto& arg : args_) {
+			visit(*arg);
+		}
+	}
+
+	MethodBody::MethodBody(std::unique_ptr<Statement>&& body)
+		:body_(move(body))
+	{
+	}
+
+	ObjectHolder MethodBody::Execute(Closure& closure, Context& context) {
+		// Освобождает слоты кадров тела при любом выходе из метода, в том числе по исключению
+		class FrameSlotsRelease {
+		public:
+			FrameSlotsRelease(const vector<NewInstance*>& instances, Closure& locals)
+				: instances_(instances), locals_(locals) {
+			}
+
+			FrameSlotsRelease(const FrameSlotsRelease&) = delete;
+			FrameSlotsRelease& operator=(const FrameSlotsRelease&) = delete;
+
+			~FrameSlotsRelease() {
+				if (instances_.empty()) {
+					return;
+				}
+				// Локальные переменные метода после выхода из него не читаются. Пока они ссылаются
+				// на экземпляры слотов, слот не единственный владелец и не может очистить поля
+				locals_.clear();
+				for (NewInstance* instance : instances_) {
+					instance->ReleaseFrameSlots();
+				}
+			}
+
+		private:
+			const vector<NewInstance*>& instances_;
+			Closure& locals_;
+		};
+		FrameSlotsRelease release(frame_slots_, closure);
+
+		try {
+			ObjectHolder result = body_->Execute(closure, context);
+		}
+		catch (ExeptionWithObject& exeption_with_obj) {
+			return exeption_with_obj.obj_;
+		}
+		return ObjectHolder::None();
+	}
+
+	void MethodBody::ForEachChild(const std::function<void(Statement&)>& visit) {
+		visit(*body_);
+	}
+
 }  // namespace ast
\ No newline at end of file
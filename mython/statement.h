@@ -1,363 +1,771 @@
-#pragma once
-
-#include "runtime.h"
-
-#include <functional>
-#include <utility>
-
-namespace ast {
-
-	using Statement = runtime::Executable;
-
-	// ,    T,
-	//      
-	template <typename T>
-	class ValueStatement : public Statement {
-	public:
-		explicit ValueStatement(T v)
-			: value_(std::move(v)) {
-		}
-
-		runtime::ObjectHolder Execute([[maybe_unused]] runtime::Closure& closure,
-			runtime::Context&) override {
-			return runtime::ObjectHolder::Share(value_);
-		}
-
-	private:
-		T value_;
-	};
-
-	using NumericConst = ValueStatement<runtime::Number>;
-	using StringConst = ValueStatement<runtime::String>;
-	using BoolConst = ValueStatement<runtime::Bool>;
-
-	/*
-	        id1.id2.id3.
-	,  circle.center.x -      :
-	x = circle.center.x
-	*/
-	class VariableValue : public Statement {
-	public:
-		explicit VariableValue(const std::string& var_name);
-		explicit VariableValue(std::vector<std::string> dotted_ids);
-
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		std::string name_;
-		std::vector<std::string> dotted_ids_;
-	};
-
-	//  ,      var,   rv
-	class Assignment : public Statement {
-	public:
-		Assignment(std::string var, std::unique_ptr<Statement> rv);
-
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		std::string name_;
-		std::unique_ptr<Statement> rv_;
-	};
-
-	//   object.field_name   rv
-	class FieldAssignment : public Statement {
-	public:
-		FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv);
-
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		VariableValue object_;
-		std::string field_name_;
-		std::unique_ptr<Statement> rv_;
-	};
-
-	//  None
-	class None : public Statement {
-	public:
-		runtime::ObjectHolder Execute([[maybe_unused]] runtime::Closure& closure,
-			[[maybe_unused]] runtime::Context& context) override {
-			return {};
-		}
-	};
-
-	//  print
-	class Print : public Statement {
-	public:
-		//   print     argument
-		explicit Print(std::unique_ptr<Statement> argument);
-		//   print     args
-		explicit Print(std::vector<std::unique_ptr<Statement>> args);
-
-		//   print     name
-		static std::unique_ptr<Print> Variable(const std::string& name);
-
-		//     print     ,  
-		// context.GetOutputStream()
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		std::vector<std::unique_ptr<Statement>> args_;
-	};
-
-	//   object.method    args
-	class MethodCall : public Statement {
-	public:
-		MethodCall(std::unique_ptr<Statement> object, std::string method,
-			std::vector<std::unique_ptr<Statement>> args);
-
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		std::unique_ptr<Statement> object_;
-		std::string method_;
-		std::vector<std::unique_ptr<Statement>> args_;
-	};
-
-	/*
-	    class_,      args.
-	     __init__    ,
-	       (    ):
-
-	class Person:
-	  def set_name(name):
-		self.name = name
-
-	p = Person()
-	#  name        set_name
-	p.set_name("Ivan")
-	*/
-	class NewInstance : public Statement {
-	public:
-		explicit NewInstance(const runtime::Class& class_);
-		NewInstance(const runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args);
-		//  ,    ClassInstance
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		static size_t NewInstanceId() {
-			return ++instance_count_;
-		}
-
-		inline static size_t instance_count_;
-		size_t id_;
-		const runtime::Class& class__;
-		std::vector<std::unique_ptr<Statement>> args_;
-	};
-
-	//     
-	class UnaryOperation : public Statement {
-	public:
-		explicit UnaryOperation(std::unique_ptr<Statement> argument)
-			:arg_(std::move(argument))
-		{
-		}
-
-		std::unique_ptr<Statement> arg_;
-	};
-
-	//  str,     
-	class Stringify : public UnaryOperation {
-	public:
-		using UnaryOperation::UnaryOperation;
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-	};
-
-	//       lhs  rhs
-	class BinaryOperation : public Statement {
-	public:
-		BinaryOperation(std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs)
-			:lhs_(std::move(lhs)), rhs_(std::move(rhs))
-		{
-		}
-
-		std::unique_ptr<Statement> lhs_;
-		std::unique_ptr<Statement> rhs_;
-	};
-
-	//    +   lhs  rhs
-	class Add : public BinaryOperation {
-	public:
-		using BinaryOperation::BinaryOperation;
-
-		//  :
-		//   + 
-		//   + 
-		//  1 + 2,   1 -     _add__(rhs)
-		//       runtime_error
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-	};
-
-	//     lhs  rhs
-	class Sub : public BinaryOperation {
-	public:
-		using BinaryOperation::BinaryOperation;
-
-		//  :
-		//   - 
-		//  lhs  rhs -  ,   runtime_error
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-	};
-
-	//     lhs  rhs
-	class Mult : public BinaryOperation {
-	public:
-		using BinaryOperation::BinaryOperation;
-
-		//  :
-		//   * 
-		//  lhs  rhs -  ,   runtime_error
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-	};
-
-	//    lhs  rhs
-	class Div : public BinaryOperation {
-	public:
-		using BinaryOperation::BinaryOperation;
-
-		//  :
-		//   / 
-		//  lhs  rhs -  ,   runtime_error
-		//  rhs  0,   runtime_error
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-	};
-
-	//      or  lhs  rhs
-	class Or : public BinaryOperation {
-	public:
-		using BinaryOperation::BinaryOperation;
-		//   rhs ,    lhs
-		//    Bool  False
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-	};
-
-	//      and  lhs  rhs
-	class And : public BinaryOperation {
-	public:
-		using BinaryOperation::BinaryOperation;
-		//   rhs ,    lhs
-		//    Bool  True
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-	};
-
-	//      not    
-	class Not : public UnaryOperation {
-	public:
-		using UnaryOperation::UnaryOperation;
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-	};
-
-	//   (:  ,   if,  else)
-	class Compound : public Statement {
-	public:
-		template<typename T, typename... Ts>
-		void UnpackArgs(T& first_arg, Ts &&... args) {
-			AddStatement(std::forward<T>(first_arg));
-			if constexpr(sizeof...(args) != 0) UnpackArgs(args...);
-		}
-
-		template<typename... Args>
-		explicit Compound(Args &&... args) {
-			if constexpr (sizeof...(args) != 0) UnpackArgs(args...);
-		}
-
-		//       
-		void AddStatement(std::unique_ptr<Statement> stmt) {
-			args_.push_back(std::move(stmt));
-		}
-
-		//    .  None
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		std::vector<std::unique_ptr<Statement>> args_;
-	};
-
-	//  .  ,   
-	class MethodBody : public Statement {
-	public:
-		explicit MethodBody(std::unique_ptr<Statement>&& body);
-
-		//  ,    body.
-		//   body    return,   return
-		//     None
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		std::unique_ptr<Statement> body_;
-	};
-
-	//   return   statement
-	class Return : public Statement {
-	public:
-		explicit Return(std::unique_ptr<Statement> statement)
-			:statement_(move(statement))
-		{
-		}
-
-		//    .    return ,
-		//     ,      statement.
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		std::unique_ptr<Statement> statement_;
-	};
-
-	//  
-	class ClassDefinition : public Statement {
-	public:
-		// ,  ObjectHolder    runtime::Class
-		explicit ClassDefinition(runtime::ObjectHolder cls);
-
-		//   closure  ,      ,  
-		// 
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		runtime::ObjectHolder cls_;
-	};
-
-	//  if <condition> <if_body> else <else_body>
-	class IfElse : public Statement {
-	public:
-		//  else_body    nullptr
-		IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
-			std::unique_ptr<Statement> else_body);
-
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		std::unique_ptr<Statement> condition_;
-		std::unique_ptr<Statement> if_body_;
-		std::unique_ptr<Statement> else_body_;
-	};
-
-	//  
-	class Comparison : public BinaryOperation {
-	public:
-		// Comparator  ,    
-		using Comparator = std::function<bool(const runtime::ObjectHolder&,
-			const runtime::ObjectHolder&, runtime::Context&)>;
-
-		Comparison(Comparator cmp, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs);
-
-		//    lhs  rhs     comparator,
-		//    runtime::Bool
-		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
-
-	private:
-		Comparator cmp_;
-	};
-
-	class ExeptionWithObject : public std::exception {
-	public:
-		explicit ExeptionWithObject(runtime::ObjectHolder object)
-			:obj_(std::move(object))
-		{
-		}
-
-		runtime::ObjectHolder obj_;
-	};
-
+#pragma once
+
+#include "runtime.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace parse {
+	struct Module;
+}  // namespace parse
+
+namespace ast {
+
+	// Узел синтаксического дерева. Помнит номер строки исходного текста, из которой он получен
+	class Statement : public runtime::Executable {
+	public:
+		Statement() {
+			++runtime::Stats::Get().ast_nodes;
+		}
+
+		// Память узлов учитывается в GetLiveBytes
+		static void* operator new(size_t size) {
+			live_bytes_ += size;
+			return ::operator new(size);
+		}
+
+		static void operator delete(void* ptr, size_t size) noexcept {
+			live_bytes_ -= size;
+			::operator delete(ptr);
+		}
+
+		// Возвращает память, занимаемую существующими узлами (без строк и векторов внутри узлов)
+		[[nodiscard]] static size_t GetLiveBytes() {
+			return live_bytes_;
+		}
+
+		void SetLine(size_t line) {
+			line_ = line;
+		}
+
+		[[nodiscard]] size_t GetLine() const {
+			return line_;
+		}
+
+		// Вызывает visit для каждого непосредственного дочернего узла
+		virtual void ForEachChild([[maybe_unused]] const std::function<void(Statement&)>& visit) {
+		}
+
+		// Возвращает true, если выражение только читает значение: переменную, поле объекта
+		// или константу - и не исполняет код программы
+		[[nodiscard]] virtual bool CanBorrow() const {
+			return false;
+		}
+
+		// Для выражения, у которого CanBorrow() истинно, возвращает указатель на значение, хранящееся
+		// в Closure, поле объекта или самом узле, не копируя ObjectHolder. Значение действительно,
+		// пока не изменятся переменные и поля, из которых оно прочитано. Для остальных выражений nullptr
+		[[nodiscard]] virtual const runtime::ObjectHolder* Borrow([[maybe_unused]] runtime::Closure& closure) {
+			return nullptr;
+		}
+
+		// Количество исполнений узла и суммарное время исполнения (вместе с вложенными вызовами).
+		// Заполняются, только пока включён сбор горячих точек (HotSpots)
+		struct ExecutionCounters {
+			uint64_t count = 0;
+			std::chrono::nanoseconds time{ 0 };
+		};
+
+		[[nodiscard]] const ExecutionCounters& GetExecutionCounters() const {
+			return counters_;
+		}
+
+		[[nodiscard]] ExecutionCounters& GetExecutionCounters() {
+			return counters_;
+		}
+
+	private:
+		inline static size_t live_bytes_ = 0;
+		size_t line_ = 0;
+		ExecutionCounters counters_;
+	};
+
+	// Вызывает visit для узла root и всех узлов его поддерева
+	void ForEachNode(Statement& root, const std::function<void(Statement&)>& visit);
+
+	// Ячейка Closure, найденная узлом при предыдущем исполнении (см. runtime::Closure)
+	struct CachedCell {
+		uint64_t generation = 0;
+		const runtime::ObjectHolder* value = nullptr;
+	};
+
+	// Выражение, возвращающее значение типа T,
+	// используется как основа для создания констант
+	template <typename T>
+	class ValueStatement : public Statement {
+	public:
+		explicit ValueStatement(T v)
+			: value_(std::move(v)) {
+		}
+
+		runtime::ObjectHolder Execute([[maybe_unused]] runtime::Closure& closure,
+			runtime::Context&) override {
+			return runtime::ObjectHolder::Share(value_);
+		}
+
+		[[nodiscard]] bool CanBorrow() const override {
+			return true;
+		}
+
+		[[nodiscard]] const runtime::ObjectHolder* Borrow([[maybe_unused]] runtime::Closure& closure) override {
+			return &holder_;
+		}
+
+	private:
+		T value_;
+		runtime::ObjectHolder holder_ = runtime::ObjectHolder::Share(value_);
+	};
+
+	using NumericConst = ValueStatement<runtime::Number>;
+	using StringConst = ValueStatement<runtime::String>;
+	using BoolConst = ValueStatement<runtime::Bool>;
+
+	/*
+	Вычисляет значение переменной либо цепочки вызовов полей объектов id1.id2.id3.
+	Например, выражение circle.center.x - цепочка вызовов полей объектов в инструкции:
+	x = circle.center.x
+	*/
+	class VariableValue : public Statement {
+	public:
+		explicit VariableValue(const std::string& var_name);
+		explicit VariableValue(std::vector<std::string> dotted_ids);
+
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+		[[nodiscard]] bool CanBorrow() const override {
+			return true;
+		}
+
+		// Находит значение, не копируя ObjectHolder ни в конце, ни на промежуточных полях цепочки
+		[[nodiscard]] const runtime::ObjectHolder* Borrow(runtime::Closure& closure) override;
+
+		// Возвращает имена переменной и полей цепочки
+		[[nodiscard]] std::vector<std::string> GetIds() const {
+			return name_.empty() ? dotted_ids_ : std::vector<std::string>{ name_ };
+		}
+
+	private:
+		std::string name_;
+		std::vector<std::string> dotted_ids_;
+		// Ячейки имени name_ либо каждого имени цепочки dotted_ids_
+		std::vector<CachedCell> cells_;
+	};
+
+	// Присваивает переменной, имя которой задано в параметре var, значение выражения rv
+	class Assignment : public Statement {
+	public:
+		Assignment(std::string var, std::unique_ptr<Statement> rv);
+
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+		[[nodiscard]] const std::string& GetName() const {
+			return name_;
+		}
+
+		[[nodiscard]] Statement& GetValue() const {
+			return *rv_;
+		}
+
+	private:
+		std::string name_;
+		std::unique_ptr<Statement> rv_;
+		CachedCell cell_;
+	};
+
+	// Присваивает полю object.field_name значение выражения rv
+	class FieldAssignment : public Statement {
+	public:
+		FieldAssignment(VariableValue object, std::string field_name, std::unique_ptr<Statement> rv);
+
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+		[[nodiscard]] const VariableValue& GetObject() const {
+			return object_;
+		}
+
+		[[nodiscard]] const std::string& GetFieldName() const {
+			return field_name_;
+		}
+
+		[[nodiscard]] Statement& GetValue() const {
+			return *rv_;
+		}
+
+	private:
+		VariableValue object_;
+		std::string field_name_;
+		std::unique_ptr<Statement> rv_;
+		CachedCell field_cell_;
+	};
+
+	// Значение None
+	class None : public Statement {
+	public:
+		runtime::ObjectHolder Execute([[maybe_unused]] runtime::Closure& closure,
+			[[maybe_unused]] runtime::Context& context) override {
+			return {};
+		}
+
+		[[nodiscard]] bool CanBorrow() const override {
+			return true;
+		}
+
+		[[nodiscard]] const runtime::ObjectHolder* Borrow([[maybe_unused]] runtime::Closure& closure) override {
+			static const runtime::ObjectHolder none;
+			return &none;
+		}
+	};
+
+	// Команда print
+	class Print : public Statement {
+	public:
+		// Инициализирует команду print для вывода значения выражения argument
+		explicit Print(std::unique_ptr<Statement> argument);
+		// Инициализирует команду print для вывода списка значений args
+		explicit Print(std::vector<std::unique_ptr<Statement>> args);
+
+		// Инициализирует команду print для вывода значения переменной name
+		static std::unique_ptr<Print> Variable(const std::string& name);
+
+		// Во время выполнения команды print вывод должен осуществляться в поток, возвращаемый из
+		// context.GetOutputStream()
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+	private:
+		std::vector<std::unique_ptr<Statement>> args_;
+	};
+
+	// Вызывает метод object.method со списком параметров args
+	class MethodCall : public Statement {
+	public:
+		MethodCall(std::unique_ptr<Statement> object, std::string method,
+			std::vector<std::unique_ptr<Statement>> args);
+
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+		[[nodiscard]] const std::string& GetMethodName() const {
+			return method_;
+		}
+
+		[[nodiscard]] Statement& GetObject() const {
+			return *object_;
+		}
+
+		[[nodiscard]] const std::vector<std::unique_ptr<Statement>>& GetArgs() const {
+			return args_;
+		}
+
+		// Связывает вызов с методом method, который вызывается у объекта при любом исполнении узла
+		// (см. class_hierarchy.h): объект - экземпляр класса cls, а если with_subclasses, то и наследника cls,
+		// не переопределяющего метод. Связанный вызов не ищет метод по имени
+		void BindMethod(const runtime::Class& cls, const runtime::Method& method, bool with_subclasses) {
+			bound_class_ = &cls;
+			bound_method_ = &method;
+			bound_with_subclasses_ = with_subclasses;
+		}
+
+		// Возвращает метод, с которым связан вызов, или nullptr, если метод ищется при исполнении
+		[[nodiscard]] const runtime::Method* GetBoundMethod() const {
+			return bound_method_;
+		}
+
+	private:
+		std::vector<runtime::ObjectHolder> EvaluateArgs(runtime::Closure& closure, runtime::Context& context);
+		// Объект имеет класс, для которого связан вызов
+		[[nodiscard]] bool IsBoundFor(const runtime::ClassInstance* object) const;
+
+		std::unique_ptr<Statement> object_;
+		std::string method_;
+		std::vector<std::unique_ptr<Statement>> args_;
+		const runtime::Class* bound_class_ = nullptr;
+		const runtime::Method* bound_method_ = nullptr;
+		bool bound_with_subclasses_ = false;
+	};
+
+	/*
+	Создаёт новый экземпляр класса class_, передавая его конструктору набор параметров args.
+	Если в классе отсутствует метод __init__ с заданным количеством аргументов,
+	то экземпляр класса создаётся без вызова конструктора (поля объекта не будут проинициализированы):
+
+	class Person:
+	  def set_name(name):
+		self.name = name
+
+	p = Person()
+	# Поле name будет иметь значение только после вызова метода set_name
+	p.set_name("Ivan")
+	*/
+	class NewInstance : public Statement {
+	public:
+		explicit NewInstance(const runtime::Class& class_);
+		NewInstance(const runtime::Class& class_, std::vector<std::unique_ptr<Statement>> args);
+		// Возвращает объект, содержащий значение типа ClassInstance
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+		[[nodiscard]] const runtime::Class& GetClass() const {
+			return class__;
+		}
+
+		[[nodiscard]] size_t GetArgCount() const {
+			return args_.size();
+		}
+
+		/*
+		 * Включает слоты кадров для экземпляров, которые не покидают вызов метода (см. escape_analysis.h).
+		 * Узел сохраняет созданные экземпляры и, когда на экземпляр больше не ссылается ни один кадр,
+		 * выдаёт его снова с очищенными полями вместо создания нового объекта в куче
+		 */
+		void EnableFrameSlots() {
+			frame_slots_enabled_ = true;
+		}
+
+		[[nodiscard]] bool HasFrameSlots() const {
+			return frame_slots_enabled_;
+		}
+
+		// Очищает поля экземпляров слотов, на которые больше не ссылается ни один кадр.
+		// Вызывается при выходе из метода, чтобы слоты не удерживали значения полей до следующего вызова
+		void ReleaseFrameSlots();
+
+	private:
+		static size_t NewInstanceId() {
+			return ++instance_count_;
+		}
+
+		runtime::ObjectHolder AcquireFrameSlot();
+
+		// Число слотов ограничивает глубину рекурсии, на которой экземпляры ещё не создаются в куче
+		static constexpr size_t MAX_FRAME_SLOTS = 16;
+
+		inline static size_t instance_count_;
+		size_t id_;
+		const runtime::Class& class__;
+		std::vector<std::unique_ptr<Statement>> args_;
+		bool frame_slots_enabled_ = false;
+		std::vector<runtime::ObjectHolder> frame_slots_;
+	};
+
+	// Базовый класс для унарных операций
+	class UnaryOperation : public Statement {
+	public:
+		explicit UnaryOperation(std::unique_ptr<Statement> argument)
+			:arg_(std::move(argument))
+		{
+		}
+
+		void ForEachChild(const std::function<void(Statement&)>& visit) override {
+			visit(*arg_);
+		}
+
+		std::unique_ptr<Statement> arg_;
+	};
+
+	// Операция str, возвращающая строковое значение своего аргумента
+	class Stringify : public UnaryOperation {
+	public:
+		using UnaryOperation::UnaryOperation;
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	/*
+	 * Встроенная функция copy(obj), возвращающая копию объекта класса без вызова __init__.
+	 * Копия разделяет поля с оригиналом, пока один из них не присвоит полю, поэтому копирование
+	 * не зависит от числа полей. Значения других типов неизменяемы и возвращаются как есть
+	 */
+	class Copy : public UnaryOperation {
+	public:
+		using UnaryOperation::UnaryOperation;
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	// Встроенная функция clock_ns(), возвращающая показания монотонных часов в наносекундах
+	class ClockNs : public Statement {
+	public:
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	// Встроенная функция counter_add(name, value), прибавляющая число value
+	// к счётчику статистики интерпретатора с именем name. Возвращает None
+	class CounterAdd : public Statement {
+	public:
+		CounterAdd(std::unique_ptr<Statement> name, std::unique_ptr<Statement> value)
+			:name_(std::move(name)), value_(std::move(value))
+		{
+		}
+
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+		void ForEachChild(const std::function<void(Statement&)>& visit) override {
+			visit(*name_);
+			visit(*value_);
+		}
+
+	private:
+		std::unique_ptr<Statement> name_;
+		std::unique_ptr<Statement> value_;
+	};
+
+	// Встроенная функция timer_start(name), начинающая замер времени таймером статистики
+	// интерпретатора с именем name. Возвращает None
+	class TimerStart : public UnaryOperation {
+	public:
+		using UnaryOperation::UnaryOperation;
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	// Встроенная функция timer_stop(name), завершающая последний начатый замер таймера name
+	// и возвращающая его длительность в наносекундах
+	class TimerStop : public UnaryOperation {
+	public:
+		using UnaryOperation::UnaryOperation;
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	// Родительский класс Бинарная операция с аргументами lhs и rhs
+	class BinaryOperation : public Statement {
+	public:
+		BinaryOperation(std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs)
+			:lhs_(std::move(lhs)), rhs_(std::move(rhs))
+		{
+		}
+
+		void ForEachChild(const std::function<void(Statement&)>& visit) override {
+			visit(*lhs_);
+			visit(*rhs_);
+		}
+
+		std::unique_ptr<Statement> lhs_;
+		std::unique_ptr<Statement> rhs_;
+	};
+
+	// Возвращает результат операции + над аргументами lhs и rhs
+	class Add : public BinaryOperation {
+	public:
+		using BinaryOperation::BinaryOperation;
+
+		// Поддерживается сложение:
+		//  число + число
+		//  строка + строка
+		//  объект1 + объект2, если у объект1 - пользовательский класс с методом _add__(rhs)
+		// В противном случае при вычислении выбрасывается runtime_error
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	// Возвращает результат вычитания аргументов lhs и rhs
+	class Sub : public BinaryOperation {
+	public:
+		using BinaryOperation::BinaryOperation;
+
+		// Поддерживается вычитание:
+		//  число - число
+		// Если lhs и rhs - не числа, выбрасывается исключение runtime_error
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	// Возвращает результат умножения аргументов lhs и rhs
+	class Mult : public BinaryOperation {
+	public:
+		using BinaryOperation::BinaryOperation;
+
+		// Поддерживается умножение:
+		//  число * число
+		// Если lhs и rhs - не числа, выбрасывается исключение runtime_error
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	// Возвращает результат деления lhs и rhs
+	class Div : public BinaryOperation {
+	public:
+		using BinaryOperation::BinaryOperation;
+
+		// Поддерживается деление:
+		//  число / число
+		// Если lhs и rhs - не числа, выбрасывается исключение runtime_error
+		// Если rhs равен 0, выбрасывается исключение runtime_error
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	/*
+	 * Арифметическое выражение из нескольких операций +, -, *, /, вычисляемое целиком.
+	 * Промежуточные результаты над числами хранятся в int64_t, как значение Number, в куче создаётся только итоговый Number.
+	 * Если операнд не число, операции над ним выполняются как узлами Add, Sub, Mult и Div:
+	 * складываются строки, вызывается __add__, выбрасываются те же исключения.
+	 * Операнды и операции вычисляются в том же порядке, что и без объединения
+	 */
+	class FusedArithmetic : public Statement {
+	public:
+		// Возвращает FusedArithmetic, если в expression больше одной арифметической операции, иначе expression
+		static std::unique_ptr<Statement> Fuse(std::unique_ptr<Statement> expression);
+
+		explicit FusedArithmetic(std::unique_ptr<Statement> expression);
+
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+		// Возвращает исходное дерево операций
+		[[nodiscard]] Statement& GetExpression() const {
+			return *expression_;
+		}
+
+	private:
+		// Операция или операнд выражения. Операнды операции - предыдущий элемент и элемент lhs
+		struct Term {
+			enum class Kind {
+				LEAF,
+				ADD,
+				SUB,
+				MULT,
+				DIV
+			};
+
+			Kind kind = Kind::LEAF;
+			Statement* node = nullptr;
+			size_t lhs = 0;
+		};
+		struct Value;
+
+		// Раскладывает дерево операций в terms_ в обратной польской записи
+		void Compile(Statement& node);
+		Value EvaluateTerm(size_t index, runtime::Closure& closure, runtime::Context& context);
+
+		std::unique_ptr<Statement> expression_;
+		std::vector<Term> terms_;
+	};
+
+	// Возвращает результат вычисления логической операции or над lhs и rhs
+	class Or : public BinaryOperation {
+	public:
+		using BinaryOperation::BinaryOperation;
+		// Значение аргумента rhs вычисляется, только если значение lhs
+		// после приведения к Bool равно False
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	// Возвращает результат вычисления логической операции and над lhs и rhs
+	class And : public BinaryOperation {
+	public:
+		using BinaryOperation::BinaryOperation;
+		// Значение аргумента rhs вычисляется, только если значение lhs
+		// после приведения к Bool равно True
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	// Возвращает результат вычисления логической операции not над единственным аргументом операции
+	class Not : public UnaryOperation {
+	public:
+		using UnaryOperation::UnaryOperation;
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+	};
+
+	// Составная инструкция (например: тело метода, содержимое ветки if, либо else)
+	class Compound : public Statement {
+	public:
+		template<typename T, typename... Ts>
+		void UnpackArgs(T& first_arg, Ts &&... args) {
+			AddStatement(std::forward<T>(first_arg));
+			if constexpr(sizeof...(args) != 0) UnpackArgs(args...);
+		}
+
+		template<typename... Args>
+		explicit Compound(Args &&... args) {
+			if constexpr (sizeof...(args) != 0) UnpackArgs(args...);
+		}
+
+		// Добавляет очередную инструкцию в конец составной инструкции
+		void AddStatement(std::unique_ptr<Statement> stmt) {
+			args_.push_back(std::move(stmt));
+		}
+
+		// Последовательно выполняет добавленные инструкции. Возвращает None
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+	private:
+		std::vector<std::unique_ptr<Statement>> args_;
+	};
+
+	// Тело метода. Как правило, содержит составную инструкцию
+	class MethodBody : public Statement {
+	public:
+		explicit MethodBody(std::unique_ptr<Statement>&& body);
+
+		// Вычисляет инструкцию, переданную в качестве body.
+		// Если внутри body была выполнена инструкция return, возвращает результат return
+		// В противном случае возвращает None
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+		// Запоминает узел тела со слотами кадров: при выходе из метода локальные переменные
+		// в closure очищаются, и слоты освобождаются
+		void AddFrameSlots(NewInstance& instance) {
+			frame_slots_.push_back(&instance);
+		}
+
+	private:
+		std::unique_ptr<Statement> body_;
+		std::vector<NewInstance*> frame_slots_;
+	};
+
+	// Выполняет инструкцию return с выражением statement
+	class Return : public Statement {
+	public:
+		explicit Return(std::unique_ptr<Statement> statement)
+			:statement_(move(statement))
+		{
+		}
+
+		// Останавливает выполнение текущего метода. После выполнения инструкции return метод,
+		// внутри которого она была исполнена, должен вернуть результат вычисления выражения statement.
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+		[[nodiscard]] Statement& GetValue() const {
+			return *statement_;
+		}
+
+	private:
+		std::unique_ptr<Statement> statement_;
+	};
+
+	// Объявляет класс
+	class ClassDefinition : public Statement {
+	public:
+		// Гарантируется, что ObjectHolder содержит объект типа runtime::Class
+		explicit ClassDefinition(runtime::ObjectHolder cls);
+
+		// Создаёт внутри closure новый объект, совпадающий с именем класса и значением, переданным в
+		// конструктор
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		// Дочерние узлы определения класса - тела его методов
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+		[[nodiscard]] const runtime::Class& GetClass() const;
+
+		[[nodiscard]] const runtime::ObjectHolder& GetClassHolder() const {
+			return cls_;
+		}
+
+	private:
+		runtime::ObjectHolder cls_;
+	};
+
+	// Инструкция import module. Определяет в closure классы разобранного модуля (см. parse::ModuleCache)
+	class Import : public Statement {
+	public:
+		explicit Import(std::shared_ptr<const parse::Module> module);
+
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+		[[nodiscard]] const parse::Module& GetModule() const {
+			return *module_;
+		}
+
+	private:
+		// Модуль владеет классами и телами их методов, поэтому живёт, пока живёт программа
+		std::shared_ptr<const parse::Module> module_;
+	};
+
+	// Инструкция if <condition> <if_body> else <else_body>
+	class IfElse : public Statement {
+	public:
+		// Параметр else_body может быть равен nullptr
+		IfElse(std::unique_ptr<Statement> condition, std::unique_ptr<Statement> if_body,
+			std::unique_ptr<Statement> else_body);
+
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+		void ForEachChild(const std::function<void(Statement&)>& visit) override;
+
+		// Возвращает, сколько раз выполнялась ветка if и сколько раз - нет
+		[[nodiscard]] uint64_t GetTakenCount() const {
+			return taken_;
+		}
+
+		[[nodiscard]] uint64_t GetNotTakenCount() const {
+			return not_taken_;
+		}
+
+	private:
+		std::unique_ptr<Statement> condition_;
+		std::unique_ptr<Statement> if_body_;
+		std::unique_ptr<Statement> else_body_;
+		uint64_t taken_ = 0;
+		uint64_t not_taken_ = 0;
+	};
+
+	// Операция сравнения
+	class Comparison : public BinaryOperation {
+	public:
+		// Comparator задаёт функцию, выполняющую сравнение значений аргументов
+		using Comparator = std::function<bool(const runtime::ObjectHolder&,
+			const runtime::ObjectHolder&, runtime::Context&)>;
+
+		Comparison(Comparator cmp, std::unique_ptr<Statement> lhs, std::unique_ptr<Statement> rhs);
+
+		// Вычисляет значение выражений lhs и rhs и возвращает результат работы comparator,
+		// приведённый к типу runtime::Bool
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override;
+
+		[[nodiscard]] const Comparator& GetComparator() const {
+			return cmp_;
+		}
+
+	private:
+		Comparator cmp_;
+	};
+
+	/*
+	 * Ссылка на поддерево, которым владеет другое место программы с тем же текстом (см. ParserOptions).
+	 * Исполнение и заимствование значения передаются поддереву. Поддерево живёт, пока живёт программа,
+	 * поэтому ссылка им не владеет. Счётчики исполнения и номера строк поддерева относятся
+	 * к месту, которое им владеет
+	 */
+	class SharedNode : public Statement {
+	public:
+		explicit SharedNode(Statement& target)
+			: target_(target) {
+		}
+
+		runtime::ObjectHolder Execute(runtime::Closure& closure, runtime::Context& context) override {
+			return target_.Execute(closure, context);
+		}
+
+		// Дочерний узел - само поддерево, чтобы анализ видел его в каждом месте, где оно исполняется
+		void ForEachChild(const std::function<void(Statement&)>& visit) override {
+			visit(target_);
+		}
+
+		[[nodiscard]] bool CanBorrow() const override {
+			return target_.CanBorrow();
+		}
+
+		[[nodiscard]] const runtime::ObjectHolder* Borrow(runtime::Closure& closure) override {
+			return target_.Borrow(closure);
+		}
+
+		[[nodiscard]] Statement& GetTarget() const {
+			return target_;
+		}
+
+	private:
+		Statement& target_;
+	};
+
+	class ExeptionWithObject : public std::exception {
+	public:
+		explicit ExeptionWithObject(runtime::ObjectHolder object)
+			:obj_(std::move(object))
+		{
+		}
+
+		runtime::ObjectHolder obj_;
+	};
+
 }  // namespace ast
\ No newline at end of file
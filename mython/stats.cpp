@@ -0,0 +1,191 @@
+#include "stats.h"
+
+#include <map>
+#include <ostream>
+#include <string_view>
+
+#include <sys/resource.h>
+
+using namespace std;
+
+namespace runtime {
+
+	namespace {
+		struct CounterField {
+			const char* name;
+			uint64_t Counters::* field;
+		};
+
+		const CounterField COUNTER_FIELDS[] = {
+			{ "holder_copies", &Counters::holder_copies },
+			{ "closure_lookups", &Counters::closure_lookups },
+			{ "closure_cache_hits", &Counters::closure_cache_hits },
+			{ "closure_inserts", &Counters::closure_inserts },
+			{ "frame_slot_reuses", &Counters::frame_slot_reuses },
+			{ "field_copies", &Counters::field_copies },
+			{ "method_lookups", &Counters::method_lookups },
+			{ "method_lookup_hops", &Counters::method_lookup_hops },
+			{ "method_calls", &Counters::method_calls },
+			{ "bound_method_calls", &Counters::bound_method_calls },
+			{ "returns", &Counters::returns },
+			{ "tokens_lexed", &Counters::tokens_lexed },
+			{ "ast_nodes", &Counters::ast_nodes },
+			{ "ast_shared_subtrees", &Counters::ast_shared_subtrees },
+			{ "ast_bytes_saved", &Counters::ast_bytes_saved },
+			{ "modules_parsed", &Counters::modules_parsed },
+			{ "module_cache_hits", &Counters::module_cache_hits },
+			{ "str_cache_hits", &Counters::str_cache_hits },
+			{ "str_cache_misses", &Counters::str_cache_misses },
+			{ "addresses_printed", &Counters::addresses_printed },
+		};
+
+		double ToMilliseconds(chrono::nanoseconds duration) {
+			return chrono::duration<double, milli>(duration).count();
+		}
+
+		// Возвращает элементы таблицы, упорядоченные по имени
+		template <typename Value>
+		map<string_view, const Value*> SortByName(const unordered_map<string, Value>& table) {
+			map<string_view, const Value*> result;
+			for (const auto& [name, value] : table) {
+				result.emplace(name, &value);
+			}
+			return result;
+		}
+	}  // namespace
+
+	const char* ObjectKindName(ObjectKind kind) {
+		switch (kind) {
+		case ObjectKind::NUMBER:
+			return "Number";
+		case ObjectKind::STRING:
+			return "String";
+		case ObjectKind::BOOL:
+			return "Bool";
+		case ObjectKind::CLASS:
+			return "Class";
+		case ObjectKind::CLASS_INSTANCE:
+			return "ClassInstance";
+		default:
+			return "Other";
+		}
+	}
+
+	const char* PhaseName(Phase phase) {
+		switch (phase) {
+		case Phase::LEX:
+			return "lex";
+		case Phase::PARSE:
+			return "parse";
+		default:
+			return "execute";
+		}
+	}
+
+	void Stats::Reset() {
+		counters_ = Counters{};
+		for (auto& time : phase_times_) {
+			time = chrono::nanoseconds{ 0 };
+		}
+		user_counters_.clear();
+		user_timers_.clear();
+	}
+
+	void Stats::AddPhaseTime(Phase phase, chrono::nanoseconds duration) {
+		phase_times_[static_cast<size_t>(phase)] += duration;
+	}
+
+	chrono::nanoseconds Stats::GetPhaseTime(Phase phase) {
+		return phase_times_[static_cast<size_t>(phase)];
+	}
+
+	long Stats::GetPeakRssKb() {
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		return usage.ru_maxrss;
+	}
+
+	void Stats::WriteText(ostream& out) {
+		out << "objects allocated:\n"sv;
+		for (size_t i = 0; i < static_cast<size_t>(ObjectKind::COUNT); ++i) {
+			out << "  "sv << ObjectKindName(static_cast<ObjectKind>(i)) << ": "sv
+				<< counters_.objects_allocated[i] << '\n';
+		}
+		for (const auto& [name, field] : COUNTER_FIELDS) {
+			out << name << ": "sv << counters_.*field << '\n';
+		}
+		out << "phase times (ms):\n"sv;
+		for (size_t i = 0; i < static_cast<size_t>(Phase::COUNT); ++i) {
+			out << "  "sv << PhaseName(static_cast<Phase>(i)) << ": "sv
+				<< ToMilliseconds(phase_times_[i]) << '\n';
+		}
+		out << "peak_rss_kb: "sv << GetPeakRssKb() << '\n';
+		if (!user_counters_.empty()) {
+			out << "user counters:\n"sv;
+			for (const auto& [name, value] : SortByName(user_counters_)) {
+				out << "  "sv << name << ": "sv << *value << '\n';
+			}
+		}
+		if (!user_timers_.empty()) {
+			out << "user timers (ms):\n"sv;
+			for (const auto& [name, timer] : SortByName(user_timers_)) {
+				out << "  "sv << name << ": "sv << ToMilliseconds(timer->total) << " in "sv << timer->count << " runs\n"sv;
+			}
+		}
+	}
+
+	void Stats::WriteJson(ostream& out) {
+		out << "{\"objects_allocated\":{"sv;
+		for (size_t i = 0; i < static_cast<size_t>(ObjectKind::COUNT); ++i) {
+			out << (i == 0 ? "" : ",") << '"' << ObjectKindName(static_cast<ObjectKind>(i)) << "\":"sv
+				<< counters_.objects_allocated[i];
+		}
+		out << '}';
+		for (const auto& [name, field] : COUNTER_FIELDS) {
+			out << ",\""sv << name << "\":"sv << counters_.*field;
+		}
+		out << ",\"phase_ms\":{"sv;
+		for (size_t i = 0; i < static_cast<size_t>(Phase::COUNT); ++i) {
+			out << (i == 0 ? "" : ",") << '"' << PhaseName(static_cast<Phase>(i)) << "\":"sv
+				<< ToMilliseconds(phase_times_[i]);
+		}
+		out << "},\"peak_rss_kb\":"sv << GetPeakRssKb() << ",\"user_counters\":{"sv;
+		bool first = true;
+		for (const auto& [name, value] : SortByName(user_counters_)) {
+			out << (first ? "" : ",");
+			WriteJsonString(out, name);
+			out << ':' << *value;
+			first = false;
+		}
+		out << "},\"user_timers\":{"sv;
+		first = true;
+		for (const auto& [name, timer] : SortByName(user_timers_)) {
+			out << (first ? "" : ",");
+			WriteJsonString(out, name);
+			out << ":{\"ms\":"sv << ToMilliseconds(timer->total) << ",\"count\":"sv << timer->count << '}';
+			first = false;
+		}
+		out << "}}\n"sv;
+	}
+
+	void WriteJsonString(ostream& out, string_view str) {
+		out << '"';
+		for (char c : str) {
+			switch (c) {
+			case '"':
+				out << "\\\""sv;
+				break;
+			case '\\':
+				out << "\\\\"sv;
+				break;
+			case '\n':
+				out << "\\n"sv;
+				break;
+			default:
+				out << c;
+			}
+		}
+		out << '"';
+	}
+
+}  // namespace runtime
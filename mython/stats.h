@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace runtime {
+
+    // Виды объектов Mython, для которых считается количество созданных экземпляров
+    enum class ObjectKind {
+        NUMBER,
+        STRING,
+        BOOL,
+        CLASS,
+        CLASS_INSTANCE,
+        OTHER,
+        COUNT
+    };
+
+    const char* ObjectKindName(ObjectKind kind);
+
+    // Счётчики дорогих операций интерпретатора. Увеличиваются всегда: каждый стоит одно сложение
+    struct Counters {
+        uint64_t objects_allocated[static_cast<size_t>(ObjectKind::COUNT)] = {};
+        uint64_t holder_copies = 0;
+        uint64_t closure_lookups = 0;
+        // Обращения к переменным, ячейки которых взяты из кэша узла вместо поиска в Closure
+        uint64_t closure_cache_hits = 0;
+        uint64_t closure_inserts = 0;
+        // Экземпляры, не покидающие метод, взятые из слотов узла NewInstance вместо создания в куче
+        uint64_t frame_slot_reuses = 0;
+        // Копирования полей объекта, разделяемых с его копией, при первом изменении
+        uint64_t field_copies = 0;
+        uint64_t method_lookups = 0;
+        // Переходы к родительскому классу при поиске метода
+        uint64_t method_lookup_hops = 0;
+        uint64_t method_calls = 0;
+        // Вызовы, связанные с методом при разборе (см. class_hierarchy.h)
+        uint64_t bound_method_calls = 0;
+        uint64_t returns = 0;
+        uint64_t tokens_lexed = 0;
+        uint64_t ast_nodes = 0;
+        // Поддеревья, заменённые ссылкой на совпадающее поддерево (ast::SharedNode),
+        // и память узлов этих поддеревьев за вычетом ссылок
+        uint64_t ast_shared_subtrees = 0;
+        uint64_t ast_bytes_saved = 0;
+        // Модули, разобранные инструкцией import, и повторные импорты, взятые из кэша модулей
+        uint64_t modules_parsed = 0;
+        uint64_t module_cache_hits = 0;
+        // Вызовы __str__, результат которых взят из кэша StrCache либо вычислен заново
+        uint64_t str_cache_hits = 0;
+        uint64_t str_cache_misses = 0;
+        // Выводы экземпляров классов без __str__: выводится адрес объекта, разный в разных запусках
+        uint64_t addresses_printed = 0;
+    };
+
+    // Фазы работы интерпретатора, для которых замеряется время
+    enum class Phase {
+        LEX,
+        PARSE,
+        EXECUTE,
+        COUNT
+    };
+
+    const char* PhaseName(Phase phase);
+
+    // Таймер, которым программа Mython замеряет время своих участков (timer_start/timer_stop)
+    struct UserTimer {
+        std::chrono::nanoseconds total{ 0 };
+        // Количество завершённых замеров
+        uint64_t count = 0;
+        // Моменты начала незавершённых замеров. Вложенные замеры одного таймера учитываются каждый отдельно
+        std::vector<std::chrono::steady_clock::time_point> started;
+    };
+
+    // Выводит str в виде строкового литерала JSON
+    void WriteJsonString(std::ostream& out, std::string_view str);
+
+    class Stats {
+    public:
+        [[nodiscard]] static Counters& Get() {
+            return counters_;
+        }
+
+        // Обнуляет счётчики и замеры времени, удаляет счётчики и таймеры программы
+        static void Reset();
+
+        // Возвращает счётчик программы Mython с именем name (counter_add), создавая его при необходимости
+        [[nodiscard]] static int64_t& GetUserCounter(const std::string& name) {
+            return user_counters_[name];
+        }
+
+        // Возвращает таймер программы Mython с именем name, создавая его при необходимости
+        [[nodiscard]] static UserTimer& GetUserTimer(const std::string& name) {
+            return user_timers_[name];
+        }
+
+        static void AddPhaseTime(Phase phase, std::chrono::nanoseconds duration);
+        [[nodiscard]] static std::chrono::nanoseconds GetPhaseTime(Phase phase);
+
+        // Возвращает пиковый объём резидентной памяти процесса в килобайтах
+        [[nodiscard]] static long GetPeakRssKb();
+
+        static void WriteText(std::ostream& out);
+        static void WriteJson(std::ostream& out);
+
+        // Прибавляет время своей жизни ко времени фазы phase
+        class PhaseTimer {
+        public:
+            explicit PhaseTimer(Phase phase)
+                : phase_(phase), start_(std::chrono::steady_clock::now()) {
+            }
+
+            PhaseTimer(const PhaseTimer&) = delete;
+            PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+            ~PhaseTimer() {
+                AddPhaseTime(phase_, std::chrono::steady_clock::now() - start_);
+            }
+
+        private:
+            Phase phase_;
+            std::chrono::steady_clock::time_point start_;
+        };
+
+    private:
+        inline static Counters counters_;
+        inline static std::chrono::nanoseconds phase_times_[static_cast<size_t>(Phase::COUNT)] = {};
+        inline static std::unordered_map<std::string, int64_t> user_counters_;
+        inline static std::unordered_map<std::string, UserTimer> user_timers_;
+    };
+
+    // Вид объекта типа T для счётчика созданных объектов
+    template <typename T>
+    struct ObjectKindOf {
+        static constexpr ObjectKind value = ObjectKind::OTHER;
+    };
+
+}  // namespace runtime
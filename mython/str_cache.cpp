@@ -0,0 +1,98 @@
+#include "str_cache.h"
+
+#include "stats.h"
+
+#include <sstream>
+
+using namespace std;
+
+namespace runtime {
+
+	namespace {
+		bool IsValid(const ClassInstance& instance, const StrCacheEntry& entry) {
+			if (instance.GetFieldVersion() != entry.version) {
+				return false;
+			}
+			for (const StrCacheDependency& dependency : entry.dependencies) {
+				// Разрушенный объект был удалён из поля, то есть поле изменилось
+				const shared_ptr<Object> object = dependency.object.lock();
+				if (!object || static_cast<const ClassInstance&>(*object).GetFieldVersion() != dependency.version) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool IsSameObject(const weak_ptr<Object>& lhs, const weak_ptr<Object>& rhs) {
+			return !lhs.owner_before(rhs) && !rhs.owner_before(lhs);
+		}
+	}  // namespace
+
+	void StrCache::Enable() {
+		enabled_ = true;
+	}
+
+	void StrCache::Disable() {
+		enabled_ = false;
+	}
+
+	void StrCache::RecordDependency(const weak_ptr<Object>& object, const Object* address, uint64_t version) {
+		// Версию полей самого объекта кэш проверяет отдельно
+		if (address != nullptr && address == recording_->self) {
+			return;
+		}
+		auto& dependencies = recording_->dependencies;
+		if (dependencies.empty() || !IsSameObject(dependencies.back().object, object)) {
+			dependencies.push_back({ object, version });
+		}
+	}
+
+	void StrCache::RecordDependencies(const vector<StrCacheDependency>& dependencies) {
+		for (const StrCacheDependency& dependency : dependencies) {
+			RecordDependency(dependency.object, dependency.object.lock().get(), dependency.version);
+		}
+	}
+
+	void StrCache::Print(ClassInstance& instance, ostream& os, Context& context) {
+		Counters& counters = Stats::Get();
+		StrCacheEntry* entry = instance.GetStrCache();
+		if (entry != nullptr && IsValid(instance, *entry)) {
+			++counters.str_cache_hits;
+			if (recording_ != nullptr) {
+				RecordDependencies(entry->dependencies);
+			}
+			os << entry->text;
+			return;
+		}
+		++counters.str_cache_misses;
+
+		Recording recording;
+		recording.self = &instance;
+		recording.parent = recording_;
+		const uint64_t version = instance.GetFieldVersion();
+		ostringstream text;
+		recording_ = &recording;
+		try {
+			instance.Call("__str__"s, {}, context)->Print(text, context);
+		}
+		catch (...) {
+			recording_ = recording.parent;
+			throw;
+		}
+		recording_ = recording.parent;
+
+		if (recording_ != nullptr) {
+			recording_->cacheable = recording_->cacheable && recording.cacheable;
+			RecordDependencies(recording.dependencies);
+		}
+		if (recording.cacheable) {
+			instance.SetStrCache(StrCacheEntry{ text.str(), version, move(recording.dependencies) });
+			os << instance.GetStrCache()->text;
+		}
+		else {
+			instance.ResetStrCache();
+			os << text.str();
+		}
+	}
+
+}  // namespace runtime
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "runtime.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace runtime {
+
+    // Объект, поля которого прочитал метод __str__, и версия его полей на момент чтения
+    struct StrCacheDependency {
+        // Слабая ссылка: объекты, __str__ которых читают поля друг друга, не удерживают друг друга в памяти
+        std::weak_ptr<Object> object;
+        uint64_t version = 0;
+    };
+
+    // Результат __str__ объекта, сохранённый кэшем StrCache
+    struct StrCacheEntry {
+        std::string text;
+        // Версия полей объекта, при которой вычислен text
+        uint64_t version = 0;
+        // Другие объекты, поля которых прочитаны при вычислении text
+        std::vector<StrCacheDependency> dependencies;
+    };
+
+    /*
+     * Кэш результатов метода __str__. Пока кэш включён, ClassInstance::Print вызывает __str__ только
+     * если с предыдущего вызова изменились поля самого объекта или полученных через поля объектов,
+     * которые __str__ прочитал, в том числе во вложенных вызовах __str__ и других методов.
+     * Изменения полей отслеживаются по версии, которую увеличивает FieldAssignment.
+     *
+     * Результат не кэшируется, если __str__ выводит текст, присваивает полям, читает часы
+     * или изменяет счётчики и таймеры программы.
+     */
+    class StrCache {
+    public:
+        static void Enable();
+        static void Disable();
+
+        [[nodiscard]] static bool IsEnabled() {
+            return enabled_;
+        }
+
+        // Выводит в os результат метода __str__ объекта instance, по возможности из кэша
+        static void Print(ClassInstance& instance, std::ostream& os, Context& context);
+
+        // Учитывает объект instance, полученный из поля объекта вычисляемым сейчас методом __str__
+        static void RecordFieldRead(const ObjectHolder& instance) {
+            if (recording_ != nullptr) {
+                if (auto* class_instance = instance.TryAs<ClassInstance>()) {
+                    RecordDependency(class_instance->weak_from_this(), class_instance, class_instance->GetFieldVersion());
+                }
+            }
+        }
+
+        // Отмечает, что результат вычисляемого сейчас метода __str__ нельзя кэшировать
+        static void MarkUncacheable() {
+            if (recording_ != nullptr) {
+                recording_->cacheable = false;
+            }
+        }
+
+    private:
+        // Зависимости вычисляемого метода __str__
+        struct Recording {
+            const ClassInstance* self = nullptr;
+            std::vector<StrCacheDependency> dependencies;
+            bool cacheable = true;
+            Recording* parent = nullptr;
+        };
+
+        // Учитывает объект по слабой ссылке object. address - адрес объекта, если он ещё жив
+        static void RecordDependency(const std::weak_ptr<Object>& object, const Object* address, uint64_t version);
+        // Учитывает зависимости вложенного вызова __str__ либо результата из кэша
+        static void RecordDependencies(const std::vector<StrCacheDependency>& dependencies);
+
+        inline static bool enabled_ = false;
+        inline static Recording* recording_ = nullptr;
+    };
+
+}  // namespace runtime
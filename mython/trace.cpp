@@ -0,0 +1,143 @@
+#include "trace.h"
+
+#include "runtime.h"
+
+#include <iomanip>
+#include <ostream>
+#include <string_view>
+
+using namespace std;
+
+namespace runtime {
+
+	namespace {
+		void WriteEventName(ostream& out, const TraceEvent& event) {
+			if (event.cls && event.method) {
+				WriteJsonString(out, event.cls->GetName() + '.' + event.method->name);
+			}
+			else if (event.cls) {
+				WriteJsonString(out, event.cls->GetName());
+			}
+			else {
+				WriteJsonString(out, event.name);
+			}
+		}
+	}  // namespace
+
+	TraceRecorder::TraceRecorder(size_t capacity)
+		:events_(capacity == 0 ? 1 : capacity), start_(chrono::steady_clock::now())
+	{
+	}
+
+	TraceRecorder::~TraceRecorder() {
+		Deactivate();
+	}
+
+	void TraceRecorder::Activate() {
+		if (active_ == this) {
+			return;
+		}
+		if (active_) {
+			active_->Deactivate();
+		}
+		active_ = this;
+		ExecutionHooks::AddListener(*this);
+	}
+
+	void TraceRecorder::Deactivate() {
+		if (active_ == this) {
+			active_ = nullptr;
+			ExecutionHooks::RemoveListener(*this);
+		}
+	}
+
+	void TraceRecorder::Record(TraceEvent event) {
+		event.time = chrono::steady_clock::now();
+		events_[recorded_ % events_.size()] = event;
+		++recorded_;
+	}
+
+	void TraceRecorder::BeginCall(const Class& cls, const Method& method) {
+		Record({ 'B', "call", "", &cls, &method, {} });
+	}
+
+	void TraceRecorder::EndCall(const Class& cls, const Method& method) {
+		Record({ 'E', "call", "", &cls, &method, {} });
+	}
+
+	void TraceRecorder::NewInstance(const Class& cls) {
+		Record({ 'i', "alloc", "", &cls, nullptr, {} });
+	}
+
+	void TraceRecorder::PrintFlush() {
+		Record({ 'i', "io", "print", nullptr, nullptr, {} });
+	}
+
+	void TraceRecorder::BeginPhase(const char* name) {
+		Record({ 'B', "phase", name, nullptr, nullptr, {} });
+	}
+
+	void TraceRecorder::EndPhase(const char* name) {
+		Record({ 'E', "phase", name, nullptr, nullptr, {} });
+	}
+
+	void TraceRecorder::OnCall(const ClassInstance& self, const Method& method, const std::vector<ObjectHolder>& /*args*/) {
+		BeginCall(self.GetClass(), method);
+	}
+
+	void TraceRecorder::OnReturn(const ClassInstance& self, const Method& method) {
+		EndCall(self.GetClass(), method);
+	}
+
+	void TraceRecorder::OnAlloc(const Object& object, ObjectKind kind) {
+		if (kind == ObjectKind::CLASS_INSTANCE) {
+			NewInstance(static_cast<const ClassInstance&>(object).GetClass());
+		}
+	}
+
+	void TraceRecorder::OnPrint() {
+		PrintFlush();
+	}
+
+	uint64_t TraceRecorder::GetDroppedCount() const {
+		return recorded_ > events_.size() ? recorded_ - events_.size() : 0;
+	}
+
+	void TraceRecorder::WriteJson(std::ostream& out) const {
+		const uint64_t first = GetDroppedCount();
+		// Концы интервалов, начала которых вытеснены из буфера, пропускаются
+		size_t open_intervals = 0;
+		bool first_written = true;
+
+		out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":["sv;
+		for (uint64_t i = first; i < recorded_; ++i) {
+			const TraceEvent& event = events_[i % events_.size()];
+			if (event.phase == 'B') {
+				++open_intervals;
+			}
+			else if (event.phase == 'E') {
+				if (open_intervals == 0) {
+					continue;
+				}
+				--open_intervals;
+			}
+
+			if (!first_written) {
+				out << ',';
+			}
+			first_written = false;
+
+			const auto ts = chrono::duration<double, micro>(event.time - start_).count();
+			out << "\n{\"name\":"sv;
+			WriteEventName(out, event);
+			out << ",\"cat\":\""sv << event.category << "\",\"ph\":\""sv << event.phase
+				<< "\",\"ts\":"sv << fixed << setprecision(3) << ts << ",\"pid\":1,\"tid\":1"sv;
+			if (event.phase == 'i') {
+				out << ",\"s\":\"t\""sv;
+			}
+			out << '}';
+		}
+		out << "\n]}\n"sv;
+	}
+
+}  // namespace runtime
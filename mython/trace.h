@@ -0,0 +1,105 @@
+#pragma once
+
+#include "hooks.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+namespace runtime {
+
+    class Class;
+    struct Method;
+
+    // Событие временной шкалы исполнения программы
+    struct TraceEvent {
+        // Фаза события в терминах формата Chrome trace-event: 'B' - начало, 'E' - конец, 'i' - момент
+        char phase = 'i';
+        // Категория события: "call", "alloc", "io" или "phase"
+        const char* category = "";
+        // Имя события, если оно не задаётся классом и методом
+        const char* name = "";
+        const Class* cls = nullptr;
+        const Method* method = nullptr;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    /*
+     * Записывает события исполнения программы в кольцевой буфер фиксированного размера:
+     * при переполнении остаются последние capacity событий.
+     * Записанная шкала выводится в формате Chrome trace-event JSON (chrome://tracing, Perfetto).
+     * События пишутся только в активный (установленный через Activate) экземпляр, который
+     * получает события исполнения через ExecutionHooks. При сборке с NoHooks записываются только фазы.
+     */
+    class TraceRecorder : public ExecutionListener {
+    public:
+        explicit TraceRecorder(size_t capacity = size_t{ 1 } << 20);
+
+        TraceRecorder(const TraceRecorder&) = delete;
+        TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+        ~TraceRecorder() override;
+
+        // Делает экземпляр активным. Предыдущий активный экземпляр перестаёт получать события
+        void Activate();
+        void Deactivate();
+
+        // Возвращает активный экземпляр либо nullptr
+        [[nodiscard]] static TraceRecorder* Active() {
+            return active_;
+        }
+
+        void BeginCall(const Class& cls, const Method& method);
+        void EndCall(const Class& cls, const Method& method);
+        void NewInstance(const Class& cls);
+        void PrintFlush();
+        void BeginPhase(const char* name);
+        void EndPhase(const char* name);
+
+        // Возвращает количество событий, вытесненных из буфера
+        [[nodiscard]] uint64_t GetDroppedCount() const;
+
+        void WriteJson(std::ostream& out) const;
+
+        void OnCall(const ClassInstance& self, const Method& method, const std::vector<ObjectHolder>& args) override;
+        void OnReturn(const ClassInstance& self, const Method& method) override;
+        void OnAlloc(const Object& object, ObjectKind kind) override;
+        void OnPrint() override;
+
+        // Отмечает начало и конец фазы работы интерпретатора в активном экземпляре
+        class PhaseScope {
+        public:
+            explicit PhaseScope(const char* name)
+                : recorder_(Active()), name_(name) {
+                if (recorder_) {
+                    recorder_->BeginPhase(name_);
+                }
+            }
+
+            PhaseScope(const PhaseScope&) = delete;
+            PhaseScope& operator=(const PhaseScope&) = delete;
+
+            ~PhaseScope() {
+                if (recorder_ && recorder_ == Active()) {
+                    recorder_->EndPhase(name_);
+                }
+            }
+
+        private:
+            TraceRecorder* recorder_;
+            const char* name_;
+        };
+
+    private:
+        void Record(TraceEvent event);
+
+        inline static TraceRecorder* active_ = nullptr;
+
+        std::vector<TraceEvent> events_;
+        // Общее количество записанных событий, включая вытесненные
+        uint64_t recorded_ = 0;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+}  // namespace runtime